@@ -12186,8 +12186,9 @@ static void test_update_subresource(void)
     struct resource_readback rb;
     ID3D11Texture2D *texture;
     ID3D11PixelShader *ps;
+    BYTE converted_bitmap[64];
     ID3D11Device *device;
-    unsigned int i, j;
+    unsigned int i, j, k;
     D3D11_BOX box;
     DWORD color;
     HRESULT hr;
@@ -12234,6 +12235,30 @@ static void test_update_subresource(void)
         0xffffff00, 0xffff0000, 0xffff00ff, 0x00000000,
         0xff000000, 0xff7f7f7f, 0xffffffff, 0x00000000,
     };
+    /* Wine converts these formats before the upload when the driver doesn't
+     * support them natively, each on a different set of drivers. */
+    static const WORD r8g8_snorm_data[] = {0x007f, 0x7f00, 0x7f7f, 0x8181};
+    static const DWORD r16g16_snorm_data[] = {0x00007fff, 0x7fff0000, 0x7fff7fff, 0x80018001};
+    static const DWORD r8g8b8a8_snorm_data[] = {0x7f00007f, 0x7f007f00, 0x7f7f0000, 0x81818181};
+    static const DWORD r16g16_unorm_data[] = {0x0000ffff, 0xffff0000, 0xffffffff, 0x00000000};
+    static const struct
+    {
+        DXGI_FORMAT format;
+        const void *data;
+        unsigned int texel_size;
+        DWORD expected_colors[4];
+    }
+    converted_tests[] =
+    {
+        {DXGI_FORMAT_R8G8_SNORM,     r8g8_snorm_data,     sizeof(*r8g8_snorm_data),
+                {0xff0000ff, 0xff00ff00, 0xff00ffff, 0xff000000}},
+        {DXGI_FORMAT_R16G16_SNORM,   r16g16_snorm_data,   sizeof(*r16g16_snorm_data),
+                {0xff0000ff, 0xff00ff00, 0xff00ffff, 0xff000000}},
+        {DXGI_FORMAT_R8G8B8A8_SNORM, r8g8b8a8_snorm_data, sizeof(*r8g8b8a8_snorm_data),
+                {0xff0000ff, 0xff00ff00, 0xffff0000, 0x00000000}},
+        {DXGI_FORMAT_R16G16_UNORM,   r16g16_unorm_data,   sizeof(*r16g16_unorm_data),
+                {0xff0000ff, 0xff00ff00, 0xff00ffff, 0xff000000}},
+    };
 
     if (!init_test_context(&test_context, NULL))
         return;
@@ -12341,10 +12366,46 @@ static void test_update_subresource(void)
     }
     release_resource_readback(&rb);
 
-    ID3D11PixelShader_Release(ps);
-    ID3D11SamplerState_Release(sampler_state);
     ID3D11ShaderResourceView_Release(ps_srv);
     ID3D11Texture2D_Release(texture);
+
+    for (k = 0; k < ARRAY_SIZE(converted_tests); ++k)
+    {
+        texture_desc.Format = converted_tests[k].format;
+        hr = ID3D11Device_CreateTexture2D(device, &texture_desc, &resource_data, &texture);
+        ok(SUCCEEDED(hr), "Test %u: Failed to create 2d texture, hr %#x.\n", k, hr);
+        hr = ID3D11Device_CreateShaderResourceView(device, (ID3D11Resource *)texture, NULL, &ps_srv);
+        ok(SUCCEEDED(hr), "Test %u: Failed to create shader resource view, hr %#x.\n", k, hr);
+        ID3D11DeviceContext_PSSetShaderResources(context, 0, 1, &ps_srv);
+
+        /* Draw right after the update, the draw has to see the new data. */
+        for (i = 0; i < 4; ++i)
+        {
+            memcpy(&converted_bitmap[i * 4 * converted_tests[k].texel_size],
+                    converted_tests[k].data, 4 * converted_tests[k].texel_size);
+        }
+        ID3D11DeviceContext_UpdateSubresource(context, (ID3D11Resource *)texture, 0, NULL,
+                converted_bitmap, 4 * converted_tests[k].texel_size, 0);
+        draw_quad(&test_context);
+        get_texture_readback(test_context.backbuffer, 0, &rb);
+        for (i = 0; i < 4; ++i)
+        {
+            for (j = 0; j < 4; ++j)
+            {
+                color = get_readback_color(&rb, 80 + j * 160, 60 + i * 120, 0);
+                ok(compare_color(color, converted_tests[k].expected_colors[j], 1),
+                        "Test %u: Got color 0x%08x at (%u, %u), expected 0x%08x.\n",
+                        k, color, j, i, converted_tests[k].expected_colors[j]);
+            }
+        }
+        release_resource_readback(&rb);
+
+        ID3D11ShaderResourceView_Release(ps_srv);
+        ID3D11Texture2D_Release(texture);
+    }
+
+    ID3D11PixelShader_Release(ps);
+    ID3D11SamplerState_Release(sampler_state);
     release_test_context(&test_context);
 }
 
@@ -29,6 +29,7 @@
  */
 
 #include <math.h>
+#include <stdio.h>
 
 #define COBJMACROS
 #include <d3d9.h>
@@ -24084,6 +24085,130 @@ done:
     DestroyWindow(window);
 }
 
+static void test_dynamic_buffer_rename(void)
+{
+    LARGE_INTEGER frequency, start, end;
+    IDirect3DVertexBuffer9 *buffer;
+    IDirect3DDevice9 *device;
+    unsigned int i, x;
+    IDirect3D9 *d3d;
+    D3DCOLOR colour;
+    ULONG refcount;
+    HWND window;
+    HRESULT hr;
+
+    static const D3DCOLOR colours[] =
+    {
+        0xffff0000, 0xff00ff00, 0xff0000ff, 0xffffff00,
+        0xffff00ff, 0xff00ffff, 0xffffffff, 0xff000000,
+    };
+    struct quad
+    {
+        struct
+        {
+            struct vec3 position;
+            DWORD diffuse;
+        } strip[4];
+    } *quads;
+
+    window = create_window();
+    d3d = Direct3DCreate9(D3D_SDK_VERSION);
+    ok(!!d3d, "Failed to create a D3D object.\n");
+    if (!(device = create_device(d3d, window, window, TRUE)))
+    {
+        skip("Failed to create a D3D device, skipping tests.\n");
+        IDirect3D9_Release(d3d);
+        DestroyWindow(window);
+        return;
+    }
+
+    hr = IDirect3DDevice9_CreateVertexBuffer(device, 2 * sizeof(*quads),
+            D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, 0, D3DPOOL_DEFAULT, &buffer, NULL);
+    ok(SUCCEEDED(hr), "Failed to create vertex buffer, hr %#x.\n", hr);
+
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_LIGHTING, FALSE);
+    ok(SUCCEEDED(hr), "Failed to set render state, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetFVF(device, D3DFVF_XYZ | D3DFVF_DIFFUSE);
+    ok(SUCCEEDED(hr), "Failed to set FVF, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetStreamSource(device, 0, buffer, 0, sizeof(*quads->strip));
+    ok(SUCCEEDED(hr), "Failed to set stream source, hr %#x.\n", hr);
+
+    hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0xff808080, 0.0f, 0);
+    ok(SUCCEEDED(hr), "Failed to clear, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(SUCCEEDED(hr), "Failed to begin scene, hr %#x.\n", hr);
+    /* Draw each strip from freshly discarded contents, without waiting for
+     * the previous draws, and append every other one with NOOVERWRITE. The
+     * earlier draws have to keep seeing the data they were issued with. */
+    for (i = 0; i < ARRAY_SIZE(colours); ++i)
+    {
+        float left = -1.0f + i * 2.0f / ARRAY_SIZE(colours);
+        float right = left + 2.0f / ARRAY_SIZE(colours);
+        unsigned int offset = i & 1 ? sizeof(*quads) : 0;
+
+        hr = IDirect3DVertexBuffer9_Lock(buffer, offset, sizeof(*quads), (void **)&quads,
+                i & 1 ? D3DLOCK_NOOVERWRITE : D3DLOCK_DISCARD);
+        ok(SUCCEEDED(hr), "Failed to lock vertex buffer, hr %#x.\n", hr);
+        quads->strip[0].position.x = left;
+        quads->strip[0].position.y = -1.0f;
+        quads->strip[1].position.x = left;
+        quads->strip[1].position.y = 1.0f;
+        quads->strip[2].position.x = right;
+        quads->strip[2].position.y = -1.0f;
+        quads->strip[3].position.x = right;
+        quads->strip[3].position.y = 1.0f;
+        for (x = 0; x < ARRAY_SIZE(quads->strip); ++x)
+        {
+            quads->strip[x].position.z = 0.0f;
+            quads->strip[x].diffuse = colours[i];
+        }
+        hr = IDirect3DVertexBuffer9_Unlock(buffer);
+        ok(SUCCEEDED(hr), "Failed to unlock vertex buffer, hr %#x.\n", hr);
+
+        hr = IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLESTRIP, i & 1 ? 4 : 0, 2);
+        ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    }
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(SUCCEEDED(hr), "Failed to end scene, hr %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(colours); ++i)
+    {
+        x = (2 * i + 1) * 640 / (2 * ARRAY_SIZE(colours));
+        colour = getPixelColor(device, x, 240);
+        ok(color_match(colour, colours[i] & 0x00ffffff, 1),
+                "Strip %u: got unexpected colour 0x%08x.\n", i, colour);
+    }
+
+    /* Not a pass/fail criterion; this is the map pattern of a typical
+     * streaming vertex buffer, so keep an eye on how long it takes. */
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(SUCCEEDED(hr), "Failed to begin scene, hr %#x.\n", hr);
+    for (i = 0; i < 0x1000; ++i)
+    {
+        hr = IDirect3DVertexBuffer9_Lock(buffer, 0, sizeof(*quads), (void **)&quads, D3DLOCK_DISCARD);
+        ok(SUCCEEDED(hr), "Failed to lock vertex buffer, hr %#x.\n", hr);
+        quads->strip[0].diffuse = colours[i % ARRAY_SIZE(colours)];
+        hr = IDirect3DVertexBuffer9_Unlock(buffer);
+        ok(SUCCEEDED(hr), "Failed to unlock vertex buffer, hr %#x.\n", hr);
+        hr = IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLESTRIP, 0, 2);
+        ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    }
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(SUCCEEDED(hr), "Failed to end scene, hr %#x.\n", hr);
+    getPixelColor(device, 0, 240);
+    QueryPerformanceCounter(&end);
+    trace("%u discarding maps and draws took %u us.\n", i,
+            (unsigned int)((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart));
+
+    IDirect3DVertexBuffer9_Release(buffer);
+    refcount = IDirect3DDevice9_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+    IDirect3D9_Release(d3d);
+    DestroyWindow(window);
+}
+
 static void test_color_vertex(void)
 {
     IDirect3DDevice9 *device;
@@ -24363,11 +24488,228 @@ static void test_sysmem_draw(void)
     DestroyWindow(window);
 }
 
+static void test_shader_cache_child(void)
+{
+    IDirect3DVertexShader9 *vs;
+    IDirect3DPixelShader9 *ps;
+    IDirect3DDevice9 *device;
+    IDirect3D9 *d3d;
+    ULONG refcount;
+    D3DCOLOR color;
+    HWND window;
+    HRESULT hr;
+    D3DCAPS9 caps;
+
+    static const DWORD vs_code[] =
+    {
+        0xfffe0101,                                                             /* vs_1_1                     */
+        0x0000001f, 0x80000000, 0x900f0000,                                     /* dcl_position v0            */
+        0x00000001, 0xc00f0000, 0x90e40000,                                     /* mov oPos, v0               */
+        0x0000ffff                                                              /* end                        */
+    };
+    static const DWORD ps_code[] =
+    {
+        0xffff0200,                                                             /* ps_2_0                     */
+        0x05000051, 0xa00f0000, 0x00000000, 0x3f800000, 0x00000000, 0x3f800000, /* def c0, 0.0, 1.0, 0.0, 1.0 */
+        0x02000001, 0x800f0800, 0xa0e40000,                                     /* mov oC0, c0                */
+        0x0000ffff                                                              /* end                        */
+    };
+    static const struct vec3 quad[] =
+    {
+        {-1.0f, -1.0f, 0.0f},
+        {-1.0f,  1.0f, 0.0f},
+        { 1.0f, -1.0f, 0.0f},
+        { 1.0f,  1.0f, 0.0f},
+    };
+
+    window = create_window();
+    d3d = Direct3DCreate9(D3D_SDK_VERSION);
+    ok(!!d3d, "Failed to create a D3D object.\n");
+    if (!(device = create_device(d3d, window, window, TRUE)))
+    {
+        skip("Failed to create a D3D device, skipping tests.\n");
+        goto done;
+    }
+
+    hr = IDirect3DDevice9_GetDeviceCaps(device, &caps);
+    ok(SUCCEEDED(hr), "Failed to get device caps, hr %#x.\n", hr);
+    if (caps.PixelShaderVersion < D3DPS_VERSION(2, 0))
+    {
+        skip("No ps_2_0 support, skipping tests.\n");
+        IDirect3DDevice9_Release(device);
+        goto done;
+    }
+
+    hr = IDirect3DDevice9_CreateVertexShader(device, vs_code, &vs);
+    ok(SUCCEEDED(hr), "Failed to create vertex shader, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_CreatePixelShader(device, ps_code, &ps);
+    ok(SUCCEEDED(hr), "Failed to create pixel shader, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetVertexShader(device, vs);
+    ok(SUCCEEDED(hr), "Failed to set vertex shader, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetPixelShader(device, ps);
+    ok(SUCCEEDED(hr), "Failed to set pixel shader, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetFVF(device, D3DFVF_XYZ);
+    ok(SUCCEEDED(hr), "Failed to set FVF, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_ZENABLE, D3DZB_FALSE);
+    ok(SUCCEEDED(hr), "Failed to disable depth test, hr %#x.\n", hr);
+
+    hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0xffff0000, 1.0f, 0);
+    ok(SUCCEEDED(hr), "Failed to clear, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(SUCCEEDED(hr), "Failed to begin scene, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLESTRIP, 2, quad, sizeof(*quad));
+    ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(SUCCEEDED(hr), "Failed to end scene, hr %#x.\n", hr);
+    color = getPixelColor(device, 320, 240);
+    ok(color_match(color, 0x0000ff00, 1), "Got unexpected color 0x%08x.\n", color);
+
+    IDirect3DVertexShader9_Release(vs);
+    IDirect3DPixelShader9_Release(ps);
+    refcount = IDirect3DDevice9_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+done:
+    IDirect3D9_Release(d3d);
+    DestroyWindow(window);
+}
+
+static unsigned int shader_cache_files(const char *path, BOOL corrupt)
+{
+    char pattern[MAX_PATH], filename[MAX_PATH];
+    WIN32_FIND_DATAA data;
+    unsigned int count = 0;
+    HANDLE find, file;
+
+    sprintf(pattern, "%s\\*.bin", path);
+    if ((find = FindFirstFileA(pattern, &data)) == INVALID_HANDLE_VALUE)
+        return 0;
+    do
+    {
+        ++count;
+        if (!corrupt)
+            continue;
+        /* Cut the binary short; the next run has to notice and relink. */
+        sprintf(filename, "%s\\%s", path, data.cFileName);
+        file = CreateFileA(filename, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        ok(file != INVALID_HANDLE_VALUE, "Failed to open %s, error %u.\n", filename, GetLastError());
+        SetFilePointer(file, data.nFileSizeLow / 2, NULL, FILE_BEGIN);
+        ok(SetEndOfFile(file), "Failed to truncate %s, error %u.\n", filename, GetLastError());
+        CloseHandle(file);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+
+    return count;
+}
+
+static void run_shader_cache_child(const char *argv0)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char cmd[MAX_PATH];
+
+    sprintf(cmd, "%s visual shader_cache", argv0);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    ok(CreateProcessA(NULL, cmd, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info),
+            "Failed to create process, error %u.\n", GetLastError());
+    winetest_wait_child_process(info.hProcess);
+    CloseHandle(info.hProcess);
+    CloseHandle(info.hThread);
+}
+
+static void test_shader_cache(const char *argv0)
+{
+    char module[MAX_PATH], key_name[MAX_PATH], path[MAX_PATH], filename[MAX_PATH];
+    DWORD app_disposition, d3d_disposition;
+    unsigned int count, warm_count;
+    WIN32_FIND_DATAA data;
+    HKEY app_key, d3d_key;
+    const char *name;
+    HANDLE find;
+    LONG ret;
+
+    /* Wine only reads the shader cache settings at process start, and looks
+     * them up per executable, so the actual drawing happens in child
+     * processes that share a private cache directory. */
+    GetModuleFileNameA(NULL, module, sizeof(module));
+    name = (name = strrchr(module, '\\')) ? name + 1 : module;
+    sprintf(key_name, "Software\\Wine\\AppDefaults\\%s", name);
+    ret = RegCreateKeyExA(HKEY_CURRENT_USER, key_name, 0, NULL, 0, KEY_ALL_ACCESS,
+            NULL, &app_key, &app_disposition);
+    if (ret)
+    {
+        skip("Failed to create the application key, error %d.\n", ret);
+        return;
+    }
+    ret = RegCreateKeyExA(app_key, "Direct3D", 0, NULL, 0, KEY_ALL_ACCESS, NULL, &d3d_key, &d3d_disposition);
+    ok(!ret, "Failed to create the Direct3D key, error %d.\n", ret);
+
+    GetTempPathA(sizeof(path), path);
+    strcat(path, "wine_d3d9_shader_cache");
+    CreateDirectoryA(path, NULL);
+    ret = RegSetValueExA(d3d_key, "ShaderCache", 0, REG_SZ, (const BYTE *)"enabled", sizeof("enabled"));
+    ok(!ret, "Failed to set ShaderCache, error %d.\n", ret);
+    ret = RegSetValueExA(d3d_key, "ShaderCachePath", 0, REG_SZ, (const BYTE *)path, strlen(path) + 1);
+    ok(!ret, "Failed to set ShaderCachePath, error %d.\n", ret);
+
+    run_shader_cache_child(argv0);
+    if (!(count = shader_cache_files(path, FALSE)))
+    {
+        skip("No programs were cached.\n");
+        goto done;
+    }
+
+    /* A warm start has to render the same thing from the cached binaries,
+     * without adding new ones. */
+    run_shader_cache_child(argv0);
+    warm_count = shader_cache_files(path, FALSE);
+    ok(warm_count == count, "Got %u cached programs, expected %u.\n", warm_count, count);
+
+    /* Damaged entries are discarded and replaced. */
+    shader_cache_files(path, TRUE);
+    run_shader_cache_child(argv0);
+    warm_count = shader_cache_files(path, FALSE);
+    ok(warm_count == count, "Got %u cached programs, expected %u.\n", warm_count, count);
+
+done:
+    sprintf(filename, "%s\\*", path);
+    if ((find = FindFirstFileA(filename, &data)) != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                continue;
+            sprintf(filename, "%s\\%s", path, data.cFileName);
+            DeleteFileA(filename);
+        } while (FindNextFileA(find, &data));
+        FindClose(find);
+    }
+    RemoveDirectoryA(path);
+
+    RegDeleteValueA(d3d_key, "ShaderCache");
+    RegDeleteValueA(d3d_key, "ShaderCachePath");
+    RegCloseKey(d3d_key);
+    if (d3d_disposition == REG_CREATED_NEW_KEY)
+        RegDeleteKeyA(app_key, "Direct3D");
+    RegCloseKey(app_key);
+    if (app_disposition == REG_CREATED_NEW_KEY)
+        RegDeleteKeyA(HKEY_CURRENT_USER, key_name);
+}
+
 START_TEST(visual)
 {
     D3DADAPTER_IDENTIFIER9 identifier;
     IDirect3D9 *d3d;
+    char **argv;
     HRESULT hr;
+    int argc;
+
+    argc = winetest_get_mainargs(&argv);
+    if (argc >= 3 && !strcmp(argv[2], "shader_cache"))
+    {
+        test_shader_cache_child();
+        return;
+    }
 
     if (!(d3d = Direct3DCreate9(D3D_SDK_VERSION)))
     {
@@ -24500,6 +24842,8 @@ START_TEST(visual)
     test_mvp_software_vertex_shaders();
     test_null_format();
     test_map_synchronisation();
+    test_dynamic_buffer_rename();
     test_color_vertex();
     test_sysmem_draw();
+    test_shader_cache(argv[0]);
 }
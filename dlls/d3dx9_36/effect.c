@@ -3141,10 +3141,21 @@ static HRESULT d3dx9_apply_pass_states(struct ID3DXEffectImpl *effect, struct d3
     unsigned int i;
     HRESULT ret;
     HRESULT hr;
-    ULONG64 new_update_version = next_effect_update_version(&effect->base_effect);
+    ULONG64 new_update_version;
 
     TRACE("effect %p, pass %p, state_count %u.\n", effect, pass, pass->state_count);
 
+    /* Every parameter change and every evaluation bumps the version counter,
+     * so if it didn't move since the pass was last applied, none of its
+     * states can be dirty and there is no need to walk them. */
+    if (!update_all && *get_version_counter_ptr(&effect->base_effect) == pass->update_version)
+    {
+        TRACE("No parameters changed since the last update.\n");
+        return D3D_OK;
+    }
+
+    new_update_version = next_effect_update_version(&effect->base_effect);
+
     ret = D3D_OK;
     for (i = 0; i < pass->state_count; ++i)
     {
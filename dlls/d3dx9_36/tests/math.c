@@ -2413,6 +2413,15 @@ static void test_D3DXVec_Array(void)
             (D3DXVECTOR3 *)inp_vec, sizeof(*inp_vec), &mat, ARRAY_SIZE(inp_vec));
     expect_vec4_array(ARRAY_SIZE(exp_vec), exp_vec, out_vec, 1);
 
+    /* In place. */
+    for (i = 0; i < ARRAY_SIZE(inp_vec); ++i)
+        out_vec[i + 1] = inp_vec[i];
+    D3DXVec3TransformCoordArray((D3DXVECTOR3 *)&out_vec[1], sizeof(*out_vec),
+            (D3DXVECTOR3 *)&out_vec[1], sizeof(*out_vec), &mat, ARRAY_SIZE(inp_vec));
+    for (i = 0; i < ARRAY_SIZE(inp_vec); ++i)
+        out_vec[i + 1].w = 0.0f;
+    expect_vec4_array(ARRAY_SIZE(exp_vec), exp_vec, out_vec, 1);
+
     /* D3DXVec3TransformNormalArray */
     exp_vec[1].x = 25.0f; exp_vec[1].y = 30.0f; exp_vec[1].z = 35.0f;
     exp_vec[2].x = 30.0f; exp_vec[2].y = 36.0f; exp_vec[2].z = 42.0f;
@@ -2491,6 +2500,87 @@ static void test_D3DXVec_Array(void)
     }
 }
 
+static void test_D3DX_transform_fractional(void)
+{
+    D3DXVECTOR3 out_normal[5], out_coord[5];
+    D3DXMATRIX m1, m2, got, expected;
+    D3DXVECTOR4 out_vec[5];
+    unsigned int i;
+
+    /* Inexact inputs, so that the results depend on rounding. They are all
+     * positive, so that sums don't cancel out and a few ulps are enough to
+     * absorb differences in the order of operations. */
+    static const D3DXVECTOR3 in_vec[] =
+    {
+        {0.1f,  0.2f,  0.3f},
+        {1.5f,  2.5f,  3.5f},
+        {0.7f,  0.4f,  1.9f},
+        {2.0f,  1.0f,  0.5f},
+        {0.33f, 0.66f, 0.99f},
+    };
+    static const D3DXVECTOR4 exp_vec[] =
+    {
+        {1.25000000e+00f, 1.40000010e+00f, 1.43750000e+00f, 3.17500019e+00f},
+        {1.18000002e+01f, 9.32499981e+00f, 5.78749990e+00f, 1.43249998e+01f},
+        {5.05000019e+00f, 5.00000000e+00f, 2.93750000e+00f, 5.82499981e+00f},
+        {3.79999995e+00f, 4.32499981e+00f, 5.66249990e+00f, 7.19999981e+00f},
+        {3.43499994e+00f, 3.01000023e+00f, 2.21374989e+00f, 5.41750002e+00f},
+    };
+    static const D3DXVECTOR3 exp_normal[] =
+    {
+        {9.50000048e-01f, 7.00000048e-01f, 3.37500006e-01f},
+        {1.15000000e+01f, 8.62500000e+00f, 4.68750000e+00f},
+        {4.75000000e+00f, 4.30000019e+00f, 1.83749998e+00f},
+        {3.50000000e+00f, 3.62500000e+00f, 4.56250000e+00f},
+        {3.13499999e+00f, 2.31000018e+00f, 1.11374998e+00f},
+    };
+    static const D3DXVECTOR3 exp_coord[] =
+    {
+        {3.93700778e-01f, 4.40944880e-01f, 4.52755868e-01f},
+        {8.23734760e-01f, 6.50959849e-01f, 4.04013962e-01f},
+        {8.66952837e-01f, 8.58369112e-01f, 5.04291832e-01f},
+        {5.27777791e-01f, 6.00694418e-01f, 7.86458313e-01f},
+        {6.34056270e-01f, 5.55606842e-01f, 4.08629417e-01f},
+    };
+
+    set_matrix(&m1,
+            0.5f, 1.25f, 2.0f, 0.75f,
+            1.5f, 0.25f, 0.5f, 3.0f,
+            2.0f, 1.75f, 0.125f, 1.0f,
+            0.3f, 0.7f, 1.1f, 2.2f);
+    set_matrix(&m2,
+            1.1f, 0.2f, 0.3f, 0.4f,
+            0.5f, 1.6f, 0.7f, 0.8f,
+            0.9f, 1.0f, 1.2f, 0.1f,
+            0.25f, 0.5f, 0.75f, 1.0f);
+    set_matrix(&expected,
+            3.16249990e+00f, 4.47499990e+00f, 3.98750019e+00f, 2.15000010e+00f,
+            2.97500014e+00f, 2.70000005e+00f, 3.47499990e+00f, 3.84999990e+00f,
+            3.43750000e+00f, 3.82500005e+00f, 2.72499990e+00f, 3.21250010e+00f,
+            2.22000003e+00f, 3.38000011e+00f, 3.55000019e+00f, 2.99000001e+00f);
+
+    D3DXMatrixMultiply(&got, &m1, &m2);
+    expect_matrix(&expected, &got, 4);
+    got = m1;
+    D3DXMatrixMultiply(&got, &got, &m2);
+    expect_matrix(&expected, &got, 4);
+    got = m2;
+    D3DXMatrixMultiply(&got, &m1, &got);
+    expect_matrix(&expected, &got, 4);
+
+    D3DXVec3TransformArray(out_vec, sizeof(*out_vec), in_vec, sizeof(*in_vec), &m1, ARRAY_SIZE(in_vec));
+    D3DXVec3TransformNormalArray(out_normal, sizeof(*out_normal), in_vec, sizeof(*in_vec),
+            &m1, ARRAY_SIZE(in_vec));
+    D3DXVec3TransformCoordArray(out_coord, sizeof(*out_coord), in_vec, sizeof(*in_vec),
+            &m1, ARRAY_SIZE(in_vec));
+    for (i = 0; i < ARRAY_SIZE(in_vec); ++i)
+    {
+        expect_vec4(&exp_vec[i], &out_vec[i], 4);
+        expect_vec3(&exp_normal[i], &out_normal[i], 4);
+        expect_vec3(&exp_coord[i], &out_coord[i], 4);
+    }
+}
+
 static void test_D3DXFloat_Array(void)
 {
     unsigned int i;
@@ -3670,6 +3760,7 @@ START_TEST(math)
     test_Matrix_Decompose();
     test_Matrix_Transformation2D();
     test_D3DXVec_Array();
+    test_D3DX_transform_fractional();
     test_D3DXFloat_Array();
     test_D3DXSHAdd();
     test_D3DXSHDot();
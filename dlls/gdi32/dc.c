@@ -53,7 +53,7 @@ static const struct gdi_obj_funcs dc_funcs =
 static inline DC *get_dc_obj( HDC hdc )
 {
     WORD type;
-    DC *dc = get_any_obj_ptr( hdc, &type );
+    DC *dc = get_any_obj_ref( hdc, &type );
     if (!dc) return NULL;
 
     switch (type)
@@ -64,7 +64,7 @@ static inline DC *get_dc_obj( HDC hdc )
     case OBJ_ENHMETADC:
         return dc;
     default:
-        GDI_ReleaseObj( hdc );
+        release_obj_ref( hdc );
         SetLastError( ERROR_INVALID_HANDLE );
         return NULL;
     }
@@ -198,7 +198,8 @@ void free_dc_ptr( DC *dc )
 /***********************************************************************
  *           get_dc_ptr
  *
- * Retrieve a DC pointer but release the GDI lock.
+ * Retrieve a DC pointer. This doesn't take the GDI lock, the DC is
+ * protected by its reference count and owner thread instead.
  */
 DC *get_dc_ptr( HDC hdc )
 {
@@ -206,7 +207,7 @@ DC *get_dc_ptr( HDC hdc )
     if (!dc) return NULL;
     if (dc->disabled)
     {
-        GDI_ReleaseObj( hdc );
+        release_obj_ref( hdc );
         return NULL;
     }
 
@@ -217,12 +218,12 @@ DC *get_dc_ptr( HDC hdc )
     else if (dc->thread != GetCurrentThreadId())
     {
         WARN( "dc %p belongs to thread %04x\n", hdc, dc->thread );
-        GDI_ReleaseObj( hdc );
+        release_obj_ref( hdc );
         return NULL;
     }
     else InterlockedIncrement( &dc->refcount );
 
-    GDI_ReleaseObj( hdc );
+    release_obj_ref( hdc );
     return dc;
 }
 
@@ -1280,7 +1281,7 @@ WORD WINAPI SetHookFlags( HDC hdc, WORD flags )
     else if (flags & DCHF_ENABLEDC)
         ret = InterlockedExchange( &dc->disabled, 0 );
 
-    GDI_ReleaseObj( hdc );
+    release_obj_ref( hdc );
 
     if (flags & DCHF_RESETDC) ret = reset_dc_state( hdc );
     return ret;
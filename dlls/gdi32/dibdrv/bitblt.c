@@ -20,6 +20,9 @@
 
 #include <assert.h>
 
+#include "windef.h"
+#include "winbase.h"
+#include "winreg.h"
 #include "gdi_private.h"
 #include "dibdrv.h"
 
@@ -42,6 +45,115 @@ WINE_DEFAULT_DEBUG_CHANNEL(dib);
 
 #define MAX_OP_LEN  6  /* Longest opcode + 1 for the terminating 0 */
 
+/* large operations are split in bands of rows that are processed in parallel on the thread pool */
+#define MIN_BAND_PIXELS  (256 * 1024)
+#define MIN_BAND_ROWS    16
+
+struct dib_band_work
+{
+    LONG     refcount;
+    LONG     next;      /* next band to process */
+    LONG     pending;   /* number of bands not yet finished */
+    int      count;
+    HANDLE   done;
+    void   (*func)( void *ctx, int band );
+    void    *ctx;
+};
+
+/* the maximum number of bands can be set with the DibThreads value, 0 or 1 disables threading */
+static int get_max_dib_bands(void)
+{
+    SYSTEM_INFO info;
+    DWORD type, value, size = sizeof(value);
+    HKEY hkey;
+    int ret;
+
+    GetSystemInfo( &info );
+    ret = min( info.dwNumberOfProcessors, MAX_DIB_BANDS );
+
+    if (!RegOpenKeyA( HKEY_CURRENT_USER, "Software\\Wine\\Gdi", &hkey ))
+    {
+        if (!RegQueryValueExA( hkey, "DibThreads", NULL, &type, (BYTE *)&value, &size ) && type == REG_DWORD)
+            ret = min( value, MAX_DIB_BANDS );
+        RegCloseKey( hkey );
+    }
+    TRACE( "using up to %d bands\n", ret );
+    return ret;
+}
+
+/* number of bands to use to process an area of the given size */
+int get_dib_band_count( int width, int height )
+{
+    static int max_bands = -1;
+    int count;
+
+    if (max_bands == -1) max_bands = get_max_dib_bands();
+    if (max_bands <= 1 || width <= 0 || height < 2 * MIN_BAND_ROWS) return 1;
+    count = min( (LONGLONG)width * height / MIN_BAND_PIXELS, height / MIN_BAND_ROWS );
+    return max( 1, min( count, max_bands ));
+}
+
+static void release_band_work( struct dib_band_work *work )
+{
+    if (InterlockedDecrement( &work->refcount )) return;
+    CloseHandle( work->done );
+    HeapFree( GetProcessHeap(), 0, work );
+}
+
+static void process_bands( struct dib_band_work *work )
+{
+    LONG band;
+
+    while ((band = InterlockedIncrement( &work->next ) - 1) < work->count)
+    {
+        work->func( work->ctx, band );
+        if (!InterlockedDecrement( &work->pending )) SetEvent( work->done );
+    }
+}
+
+static void CALLBACK dib_band_callback( TP_CALLBACK_INSTANCE *instance, void *arg )
+{
+    struct dib_band_work *work = arg;
+
+    process_bands( work );
+    release_band_work( work );
+}
+
+/* call func for each band, using the thread pool when there are several of them */
+void run_dib_bands( void (*func)( void *ctx, int band ), void *ctx, int count )
+{
+    struct dib_band_work *work;
+    int i;
+
+    if (count > 1 && (work = HeapAlloc( GetProcessHeap(), 0, sizeof(*work) )))
+    {
+        if ((work->done = CreateEventW( NULL, TRUE, FALSE, NULL )))
+        {
+            work->refcount = 1;
+            work->next     = 0;
+            work->pending  = count;
+            work->count    = count;
+            work->func     = func;
+            work->ctx      = ctx;
+
+            for (i = 1; i < count; i++)
+            {
+                InterlockedIncrement( &work->refcount );
+                if (TrySubmitThreadpoolCallback( dib_band_callback, work, NULL )) continue;
+                InterlockedDecrement( &work->refcount );
+                break;
+            }
+            /* the calling thread takes part too, and does everything if no worker is available */
+            process_bands( work );
+            WaitForSingleObject( work->done, INFINITE );
+            release_band_work( work );
+            return;
+        }
+        HeapFree( GetProcessHeap(), 0, work );
+    }
+    for (i = 0; i < count; i++) func( ctx, i );
+}
+
 static const unsigned char BITBLT_Opcodes[256][MAX_OP_LEN] =
 {
     { OP(PAT,DST,R2_BLACK) },                                       /* 0x00  0              */
@@ -678,16 +790,52 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
+struct gradient_bands
+{
+    const dib_info  *dib;
+    const TRIVERTEX *v;
+    int              mode;
+    RECT             rect;
+    int              count;
+    LONG             failed;
+};
+
+static void gradient_band( void *arg, int band )
+{
+    struct gradient_bands *ctx = arg;
+    int height = ctx->rect.bottom - ctx->rect.top;
+    RECT rect = ctx->rect;
+
+    rect.top    = ctx->rect.top + height * band / ctx->count;
+    rect.bottom = ctx->rect.top + height * (band + 1) / ctx->count;
+    if (!ctx->dib->funcs->gradient_rect( ctx->dib, &rect, ctx->v, ctx->mode ))
+        InterlockedExchange( &ctx->failed, TRUE );
+}
+
 static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
 {
     int i;
     struct clipped_rects clipped_rects;
+    struct gradient_bands bands;
     BOOL ret = TRUE;
 
     if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
     for (i = 0; i < clipped_rects.count; i++)
     {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        const RECT *rc = &clipped_rects.rects[i];
+
+        bands.count = get_dib_band_count( rc->right - rc->left, rc->bottom - rc->top );
+        if (bands.count > 1)
+        {
+            bands.dib    = dib;
+            bands.v      = v;
+            bands.mode   = mode;
+            bands.rect   = *rc;
+            bands.failed = FALSE;
+            run_dib_bands( gradient_band, &bands, bands.count );
+            if (!(ret = !bands.failed)) break;
+        }
+        else if (!(ret = dib->funcs->gradient_rect( dib, rc, v, mode ))) break;
     }
     free_clipped_rects( &clipped_rects );
     return ret;
@@ -1196,6 +1344,145 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
+struct stretch_band
+{
+    POINT dst_start;
+    POINT src_start;
+    int   err;
+    int   length;
+};
+
+struct stretch_bands
+{
+    dib_info              *dst_dib;
+    const dib_info        *src_dib;
+    struct stretch_params  v_params;
+    struct stretch_params  h_params;
+    BOOL                   vstretch;
+    int                    mode;
+    int                    width;
+    void                 (*row_fn)(const dib_info *dst_dib, const POINT *dst_start,
+                                   const dib_info *src_dib, const POINT *src_start,
+                                   const struct stretch_params *params, int mode, BOOL keep_dst);
+    struct stretch_band    bands[MAX_DIB_BANDS];
+};
+
+static void stretch_rows( const struct stretch_bands *ctx, const struct stretch_band *band )
+{
+    POINT dst_start = band->dst_start, src_start = band->src_start;
+    int err = band->err, length = band->length;
+
+    if (ctx->vstretch)
+    {
+        BOOL need_row = TRUE;
+        RECT last_row, this_row;
+        last_row.left = 0;
+        last_row.right = ctx->width;
+
+        while (length--)
+        {
+            if (need_row)
+            {
+                ctx->row_fn( ctx->dst_dib, &dst_start, ctx->src_dib, &src_start, &ctx->h_params, ctx->mode, FALSE );
+                need_row = FALSE;
+            }
+            else
+            {
+                last_row.top = dst_start.y - ctx->v_params.dst_inc;
+                last_row.bottom = last_row.top + 1;
+                this_row = last_row;
+                offset_rect( &this_row, 0, ctx->v_params.dst_inc );
+                copy_rect( ctx->dst_dib, &this_row, ctx->dst_dib, &last_row, NULL, R2_COPYPEN );
+            }
+
+            if (err > 0)
+            {
+                src_start.y += ctx->v_params.src_inc;
+                need_row = TRUE;
+                err += ctx->v_params.err_add_1;
+            }
+            else err += ctx->v_params.err_add_2;
+            dst_start.y += ctx->v_params.dst_inc;
+        }
+    }
+    else
+    {
+        int merged_rows = 0;
+
+        while (length--)
+        {
+            if (ctx->mode != STRETCH_DELETESCANS || !merged_rows)
+                ctx->row_fn( ctx->dst_dib, &dst_start, ctx->src_dib, &src_start, &ctx->h_params,
+                             ctx->mode, merged_rows != 0 );
+            merged_rows++;
+
+            if (err > 0)
+            {
+                dst_start.y += ctx->v_params.dst_inc;
+                merged_rows = 0;
+                err += ctx->v_params.err_add_1;
+            }
+            else err += ctx->v_params.err_add_2;
+            src_start.y += ctx->v_params.src_inc;
+        }
+    }
+}
+
+static void stretch_band( void *arg, int band )
+{
+    struct stretch_bands *ctx = arg;
+
+    stretch_rows( ctx, &ctx->bands[band] );
+}
+
+/* split the rows in independent bands, each one starting on a fresh destination row;
+ * returns the number of bands */
+static int split_stretch_rows( struct stretch_bands *ctx, POINT dst_start, POINT src_start, int err, int count )
+{
+    int i, start = 0, n = 0, length = ctx->v_params.length;
+    BOOL new_row = TRUE;
+
+    ctx->bands[0].dst_start = dst_start;
+    ctx->bands[0].src_start = src_start;
+    ctx->bands[0].err = err;
+
+    for (i = 0; i < length; i++)
+    {
+        if (n < count - 1 && i >= length * (n + 1) / count && (ctx->vstretch || new_row))
+        {
+            ctx->bands[n++].length = i - start;
+            ctx->bands[n].dst_start = dst_start;
+            ctx->bands[n].src_start = src_start;
+            ctx->bands[n].err = err;
+            start = i;
+        }
+
+        new_row = err > 0;
+        if (ctx->vstretch)
+        {
+            if (err > 0)
+            {
+                src_start.y += ctx->v_params.src_inc;
+                err += ctx->v_params.err_add_1;
+            }
+            else err += ctx->v_params.err_add_2;
+            dst_start.y += ctx->v_params.dst_inc;
+        }
+        else
+        {
+            if (err > 0)
+            {
+                dst_start.y += ctx->v_params.dst_inc;
+                err += ctx->v_params.err_add_1;
+            }
+            else err += ctx->v_params.err_add_2;
+            src_start.y += ctx->v_params.src_inc;
+        }
+    }
+    ctx->bands[n].length = length - start;
+    return n + 1;
+}
+
 DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                           const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
                           INT mode )
@@ -1205,11 +1492,9 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
-    int err;
+    struct stretch_bands bands;
+    int count;
     DWORD ret;
-    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
-                    const dib_info *src_dib, const POINT *src_start,
-                    const struct stretch_params *params, int mode, BOOL keep_dst);
 
     TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
           dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
@@ -1243,64 +1528,19 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     dst_start.x -= dst->visrect.left;
     dst_start.y -= dst->visrect.top;
 
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
-
-    if (vstretch)
-    {
-        BOOL need_row = TRUE;
-        RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
-        last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
-
-        while (v_params.length--)
-        {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
-            {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                offset_rect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
-            }
-
-            if (err > 0)
-            {
-                src_start.y += v_params.src_inc;
-                need_row = TRUE;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
-        }
-    }
-    else
-    {
-        int merged_rows = 0;
-
-        while (v_params.length--)
-        {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
-            merged_rows++;
-
-            if (err > 0)
-            {
-                dst_start.y += v_params.dst_inc;
-                merged_rows = 0;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
-        }
-    }
+    bands.dst_dib  = &dst_dib;
+    bands.src_dib  = &src_dib;
+    bands.v_params = v_params;
+    bands.h_params = h_params;
+    bands.vstretch = vstretch;
+    bands.mode     = (vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    bands.width    = dst->visrect.right - dst->visrect.left;
+    bands.row_fn   = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+
+    count = get_dib_band_count( max( h_params.length, bands.width ), v_params.length );
+    count = split_stretch_rows( &bands, dst_start, src_start, v_params.err_start, count );
+    if (count > 1) run_dib_bands( stretch_band, &bands, count );
+    else stretch_rows( &bands, &bands.bands[0] );
 
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     *src = *dst;
@@ -210,28 +210,57 @@ void copy_dib_color_info(dib_info *dst, const dib_info *src)
     dst->color_table      = src->color_table;
 }
 
-DWORD convert_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                          const BITMAPINFO *dst_info, void *dst_bits )
+struct convert_bands
 {
-    dib_info src_dib, dst_dib;
-    DWORD ret;
+    dib_info dst;
+    dib_info src;
+    RECT     rect;
+    int      count;
+    LONG     failed;
+};
 
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
-    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
+static void convert_band( void *arg, int band )
+{
+    struct convert_bands *ctx = arg;
+    int height = ctx->rect.bottom - ctx->rect.top;
+    dib_info dst = ctx->dst;
+    RECT rect = ctx->rect;
+
+    /* the destination starts at 0,0 so move its origin to the band start */
+    rect.top    = ctx->rect.top + height * band / ctx->count;
+    rect.bottom = ctx->rect.top + height * (band + 1) / ctx->count;
+    dst.rect.top += rect.top - ctx->rect.top;
 
     __TRY
     {
-        dst_dib.funcs->convert_to( &dst_dib, &src_dib, &src->visrect, FALSE );
-        ret = TRUE;
+        dst.funcs->convert_to( &dst, &ctx->src, &rect, FALSE );
     }
     __EXCEPT_PAGE_FAULT
     {
-        WARN( "invalid bits pointer %p\n", src_bits );
-        ret = FALSE;
+        InterlockedExchange( &ctx->failed, TRUE );
     }
     __ENDTRY
+}
 
-    if(!ret) return ERROR_BAD_FORMAT;
+DWORD convert_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
+                          const BITMAPINFO *dst_info, void *dst_bits )
+{
+    struct convert_bands bands;
+
+    init_dib_info_from_bitmapinfo( &bands.src, src_info, src_bits );
+    init_dib_info_from_bitmapinfo( &bands.dst, dst_info, dst_bits );
+    bands.rect   = src->visrect;
+    bands.count  = get_dib_band_count( src->visrect.right - src->visrect.left,
+                                       src->visrect.bottom - src->visrect.top );
+    bands.failed = FALSE;
+
+    run_dib_bands( convert_band, &bands, bands.count );
+
+    if (bands.failed)
+    {
+        WARN( "invalid bits pointer %p\n", src_bits );
+        return ERROR_BAD_FORMAT;
+    }
 
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     src->x -= src->visrect.left;
@@ -234,6 +234,8 @@ struct rop_codes
 #define OVERLAP_ABOVE 0x04  /* dest starts above source */
 #define OVERLAP_BELOW 0x08  /* dest starts below source */
 
+#define MAX_DIB_BANDS 8     /* max number of bands processed in parallel */
+
 typedef struct
 {
     unsigned int dx, dy;
@@ -265,6 +267,8 @@ extern int clip_line(const POINT *start, const POINT *end, const RECT *clip,
                      const bres_params *params, POINT *pt1, POINT *pt2) DECLSPEC_HIDDEN;
 extern void release_cached_font( struct cached_font *font ) DECLSPEC_HIDDEN;
 extern BOOL fill_with_pixel( DC *dc, dib_info *dib, DWORD pixel, int num, const RECT *rects, INT rop ) DECLSPEC_HIDDEN;
+extern int get_dib_band_count( int width, int height ) DECLSPEC_HIDDEN;
+extern void run_dib_bands( void (*func)( void *ctx, int band ), void *ctx, int count ) DECLSPEC_HIDDEN;
 
 static inline void init_clipped_rects( struct clipped_rects *clip_rects )
 {
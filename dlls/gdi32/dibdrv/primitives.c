@@ -19,6 +19,9 @@
  */
 
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "gdi_private.h"
 #include "dibdrv.h"
@@ -4651,32 +4654,129 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+#ifdef __SSE2__
+
+/* compute (x + 127) / 255 on unsigned 16-bit lanes, exact for x <= 255 * 255 */
+static inline __m128i div255_round_epu16( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 127 ));
+    x = _mm_add_epi16( x, _mm_add_epi16( _mm_srli_epi16( x, 8 ), _mm_set1_epi16( 1 )));
+    return _mm_srli_epi16( x, 8 );
+}
+
+/* replicate the alpha channel of the two pixels held in 16-bit lanes */
+static inline __m128i broadcast_alpha_epi16( __m128i x )
+{
+    return _mm_shufflehi_epi16( _mm_shufflelo_epi16( x, 0xff ), 0xff );
+}
+
+/* SSE2 version of blend_argb / blend_argb_alpha, returns the number of pixels processed */
+static int blend_line_argb_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16( 255 );
+    const __m128i cst = _mm_set1_epi16( alpha );
+    __m128i s, d, s_lo, s_hi, d_lo, d_hi;
+    int x, i;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        s_lo = _mm_unpacklo_epi8( s, zero );
+        s_hi = _mm_unpackhi_epi8( s, zero );
+        d_lo = _mm_unpacklo_epi8( d, zero );
+        d_hi = _mm_unpackhi_epi8( d, zero );
+        if (alpha != 255)
+        {
+            s_lo = div255_round_epu16( _mm_mullo_epi16( s_lo, cst ));
+            s_hi = div255_round_epu16( _mm_mullo_epi16( s_hi, cst ));
+        }
+        d_lo = div255_round_epu16( _mm_mullo_epi16( d_lo, _mm_sub_epi16( max, broadcast_alpha_epi16( s_lo ))));
+        d_hi = div255_round_epu16( _mm_mullo_epi16( d_hi, _mm_sub_epi16( max, broadcast_alpha_epi16( s_hi ))));
+        d_lo = _mm_add_epi16( d_lo, s_lo );
+        d_hi = _mm_add_epi16( d_hi, s_hi );
+
+        /* colors larger than alpha overflow into the next channel, let the generic code handle them */
+        if (_mm_movemask_epi8( _mm_or_si128( _mm_cmpgt_epi16( d_lo, max ), _mm_cmpgt_epi16( d_hi, max ))))
+        {
+            for (i = x; i < x + 4; i++)
+                dst[i] = alpha == 255 ? blend_argb( dst[i], src[i] ) : blend_argb_alpha( dst[i], src[i], alpha );
+            continue;
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( d_lo, d_hi ));
+    }
+    return x;
+}
+
+/* SSE2 version of blend_argb_constant_alpha, returns the number of pixels processed */
+static int blend_line_constant_alpha_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha,
+                                           DWORD src_mask )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask = _mm_set1_epi32( src_mask );
+    const __m128i src_alpha = _mm_set1_epi16( alpha );
+    const __m128i dst_alpha = _mm_set1_epi16( 255 - alpha );
+    __m128i s, d, lo, hi;
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), mask );
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), src_alpha ),
+                            _mm_mullo_epi16( _mm_unpacklo_epi8( d, zero ), dst_alpha ));
+        hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), src_alpha ),
+                            _mm_mullo_epi16( _mm_unpackhi_epi8( d, zero ), dst_alpha ));
+        _mm_storeu_si128( (__m128i *)(dst + x),
+                          _mm_packus_epi16( div255_round_epu16( lo ), div255_round_epu16( hi )));
+    }
+    return x;
+}
+
+#endif  /* __SSE2__ */
+
+static void blend_line_argb( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    x = blend_line_argb_sse2( dst, src, len, alpha );
+#endif
+    if (alpha == 255)
+        for ( ; x < len; x++) dst[x] = blend_argb( dst[x], src[x] );
+    else
+        for ( ; x < len; x++) dst[x] = blend_argb_alpha( dst[x], src[x], alpha );
+}
+
+static void blend_line_constant_alpha( DWORD *dst, const DWORD *src, int len, DWORD alpha,
+                                       BOOL src_alpha )
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    x = blend_line_constant_alpha_sse2( dst, src, len, alpha, src_alpha ? 0 : 0xff000000 );
+#endif
+    if (src_alpha)
+        for ( ; x < len; x++) dst[x] = blend_argb_constant_alpha( dst[x], src[x], alpha );
+    else
+        for ( ; x < len; x++) dst[x] = blend_argb_no_src_alpha( dst[x], src[x], alpha );
+}
+
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
     DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
-    int x, y;
+    int y;
 
     if (blend.AlphaFormat & AC_SRC_ALPHA)
-    {
-	if (blend.SourceConstantAlpha == 255)
-	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
-		    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
-        else
-	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
-		    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
-    }
-    else if (src->compression == BI_RGB)
-	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
-		dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+        for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+            blend_line_argb( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha );
     else
-	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
-		dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+        for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+            blend_line_constant_alpha( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha,
+                                       src->compression == BI_RGB );
 }
 
 static void blend_rect_32(const dib_info *dst, const RECT *rc,
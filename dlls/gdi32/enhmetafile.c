@@ -48,10 +48,28 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(enhmetafile);
 
+#define EMF_RECORD_CULL  0x01  /* output record that can be skipped when its bounds are clipped */
+#define EMF_RECORD_PEN   0x02  /* the bounds need to be extended by the pen width */
+
+struct emf_record
+{
+    DWORD offset;
+    DWORD flags;
+    RECTL bounds;   /* logical bounds of the output, if EMF_RECORD_CULL is set */
+};
+
+/* index of the valid records, built the first time the metafile is enumerated */
+struct emf_index
+{
+    UINT              count;
+    struct emf_record records[1];
+};
+
 typedef struct
 {
-    ENHMETAHEADER  *emh;
-    BOOL           on_disk;   /* true if metafile is on disk */
+    ENHMETAHEADER    *emh;
+    BOOL             on_disk;   /* true if metafile is on disk */
+    struct emf_index *index;
 } ENHMETAFILEOBJ;
 
 static const struct emr_name {
@@ -278,6 +296,7 @@ HENHMETAFILE EMF_Create_HENHMETAFILE(ENHMETAHEADER *emh, DWORD filesize, BOOL on
 
     metaObj->emh = emh;
     metaObj->on_disk = on_disk;
+    metaObj->index = NULL;
 
     if (!(hmf = alloc_gdi_handle( metaObj, OBJ_ENHMETAFILE, NULL )))
         HeapFree( GetProcessHeap(), 0, metaObj );
@@ -297,6 +316,7 @@ static BOOL EMF_Delete_HENHMETAFILE( HENHMETAFILE hmf )
         UnmapViewOfFile( metaObj->emh );
     else
         HeapFree( GetProcessHeap(), 0, metaObj->emh );
+    HeapFree( GetProcessHeap(), 0, metaObj->index );
     HeapFree( GetProcessHeap(), 0, metaObj );
     return TRUE;
 }
@@ -319,6 +339,213 @@ static ENHMETAHEADER *EMF_GetEnhMetaHeader( HENHMETAFILE hmf )
     return ret;
 }
 
+/******************************************************************
+ *         get_points_bounds / get_points16_bounds
+ */
+static BOOL get_points_bounds( RECTL *bounds, const POINTL *pts, DWORD count )
+{
+    DWORD i;
+
+    if (!count) return FALSE;
+    bounds->left = bounds->right = pts[0].x;
+    bounds->top = bounds->bottom = pts[0].y;
+    for (i = 1; i < count; i++)
+    {
+        bounds->left   = min( bounds->left, pts[i].x );
+        bounds->right  = max( bounds->right, pts[i].x );
+        bounds->top    = min( bounds->top, pts[i].y );
+        bounds->bottom = max( bounds->bottom, pts[i].y );
+    }
+    return TRUE;
+}
+
+static BOOL get_points16_bounds( RECTL *bounds, const POINTS *pts, DWORD count )
+{
+    DWORD i;
+
+    if (!count) return FALSE;
+    bounds->left = bounds->right = pts[0].x;
+    bounds->top = bounds->bottom = pts[0].y;
+    for (i = 1; i < count; i++)
+    {
+        bounds->left   = min( bounds->left, pts[i].x );
+        bounds->right  = max( bounds->right, pts[i].x );
+        bounds->top    = min( bounds->top, pts[i].y );
+        bounds->bottom = max( bounds->bottom, pts[i].y );
+    }
+    return TRUE;
+}
+
+static void get_dest_bounds( RECTL *bounds, LONG x, LONG y, LONG cx, LONG cy )
+{
+    bounds->left   = min( x, x + cx );
+    bounds->right  = max( x, x + cx );
+    bounds->top    = min( y, y + cy );
+    bounds->bottom = max( y, y + cy );
+}
+
+/******************************************************************
+ *         get_record_bounds
+ *
+ * Compute the logical bounds of the output of the records that don't
+ * change any DC state, so that they can be skipped if they are clipped.
+ */
+static DWORD get_record_bounds( const ENHMETARECORD *emr, RECTL *bounds )
+{
+    switch (emr->iType)
+    {
+    case EMR_POLYBEZIER:
+    case EMR_POLYGON:
+    case EMR_POLYLINE:
+    {
+        const EMRPOLYLINE *poly = (const EMRPOLYLINE *)emr;
+
+        if (emr->nSize < FIELD_OFFSET( EMRPOLYLINE, aptl )) return 0;
+        if (poly->cptl > (emr->nSize - FIELD_OFFSET( EMRPOLYLINE, aptl )) / sizeof(POINTL)) return 0;
+        if (!get_points_bounds( bounds, poly->aptl, poly->cptl )) return 0;
+        return EMF_RECORD_CULL | EMF_RECORD_PEN;
+    }
+    case EMR_POLYBEZIER16:
+    case EMR_POLYGON16:
+    case EMR_POLYLINE16:
+    {
+        const EMRPOLYLINE16 *poly = (const EMRPOLYLINE16 *)emr;
+
+        if (emr->nSize < FIELD_OFFSET( EMRPOLYLINE16, apts )) return 0;
+        if (poly->cpts > (emr->nSize - FIELD_OFFSET( EMRPOLYLINE16, apts )) / sizeof(POINTS)) return 0;
+        if (!get_points16_bounds( bounds, poly->apts, poly->cpts )) return 0;
+        return EMF_RECORD_CULL | EMF_RECORD_PEN;
+    }
+    case EMR_POLYPOLYLINE:
+    case EMR_POLYPOLYGON:
+    {
+        const EMRPOLYPOLYLINE *poly = (const EMRPOLYPOLYLINE *)emr;
+        DWORD size = emr->nSize - FIELD_OFFSET( EMRPOLYPOLYLINE, aPolyCounts );
+
+        if (emr->nSize < FIELD_OFFSET( EMRPOLYPOLYLINE, aPolyCounts )) return 0;
+        if (poly->nPolys > size / sizeof(DWORD)) return 0;
+        size -= poly->nPolys * sizeof(DWORD);
+        if (poly->cptl > size / sizeof(POINTL)) return 0;
+        if (!get_points_bounds( bounds, (const POINTL *)(poly->aPolyCounts + poly->nPolys), poly->cptl ))
+            return 0;
+        return EMF_RECORD_CULL | EMF_RECORD_PEN;
+    }
+    case EMR_POLYPOLYLINE16:
+    case EMR_POLYPOLYGON16:
+    {
+        const EMRPOLYPOLYLINE16 *poly = (const EMRPOLYPOLYLINE16 *)emr;
+        DWORD size = emr->nSize - FIELD_OFFSET( EMRPOLYPOLYLINE16, aPolyCounts );
+
+        if (emr->nSize < FIELD_OFFSET( EMRPOLYPOLYLINE16, aPolyCounts )) return 0;
+        if (poly->nPolys > size / sizeof(DWORD)) return 0;
+        size -= poly->nPolys * sizeof(DWORD);
+        if (poly->cpts > size / sizeof(POINTS)) return 0;
+        if (!get_points16_bounds( bounds, (const POINTS *)(poly->aPolyCounts + poly->nPolys), poly->cpts ))
+            return 0;
+        return EMF_RECORD_CULL | EMF_RECORD_PEN;
+    }
+    case EMR_BITBLT:
+    {
+        const EMRBITBLT *blt = (const EMRBITBLT *)emr;
+
+        if (emr->nSize < sizeof(*blt)) return 0;
+        get_dest_bounds( bounds, blt->xDest, blt->yDest, blt->cxDest, blt->cyDest );
+        return EMF_RECORD_CULL;
+    }
+    case EMR_STRETCHBLT:
+    {
+        const EMRSTRETCHBLT *blt = (const EMRSTRETCHBLT *)emr;
+
+        if (emr->nSize < sizeof(*blt)) return 0;
+        get_dest_bounds( bounds, blt->xDest, blt->yDest, blt->cxDest, blt->cyDest );
+        return EMF_RECORD_CULL;
+    }
+    case EMR_STRETCHDIBITS:
+    {
+        const EMRSTRETCHDIBITS *blt = (const EMRSTRETCHDIBITS *)emr;
+
+        if (emr->nSize < sizeof(*blt)) return 0;
+        get_dest_bounds( bounds, blt->xDest, blt->yDest, blt->cxDest, blt->cyDest );
+        return EMF_RECORD_CULL;
+    }
+    default:
+        return 0;
+    }
+}
+
+/******************************************************************
+ *         create_emf_index
+ */
+static struct emf_index *create_emf_index( const ENHMETAHEADER *emh )
+{
+    struct emf_index *index;
+    const ENHMETARECORD *emr;
+    DWORD offset;
+    UINT i, count = 0;
+    BOOL in_path = FALSE;
+
+    for (offset = 0; offset < emh->nBytes; offset += emr->nSize, count++)
+    {
+        emr = (const ENHMETARECORD *)((const char *)emh + offset);
+
+        if (offset + 8 > emh->nBytes ||
+            emr->nSize < 8 ||
+            offset > offset + emr->nSize ||
+            offset + emr->nSize > emh->nBytes)
+        {
+            WARN("record truncated\n");
+            break;
+        }
+    }
+
+    if (!(index = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct emf_index, records[count] ))))
+        return NULL;
+    index->count = count;
+
+    for (i = 0, offset = 0; i < count; i++, offset += emr->nSize)
+    {
+        emr = (const ENHMETARECORD *)((const char *)emh + offset);
+        index->records[i].offset = offset;
+        index->records[i].flags = 0;
+
+        switch (emr->iType)
+        {
+        case EMR_BEGINPATH:
+            in_path = TRUE;
+            break;
+        case EMR_ENDPATH:
+        case EMR_ABORTPATH:
+            in_path = FALSE;
+            break;
+        default:
+            /* drawing inside a path bracket only builds the path */
+            if (!in_path) index->records[i].flags = get_record_bounds( emr, &index->records[i].bounds );
+            break;
+        }
+    }
+    TRACE( "%u records\n", count );
+    return index;
+}
+
+/******************************************************************
+ *         EMF_GetEnhMetaIndex
+ *
+ * Returns the record index of the HENHMETAFILE, creating it if necessary.
+ */
+static const struct emf_index *EMF_GetEnhMetaIndex( HENHMETAFILE hmf )
+{
+    const struct emf_index *ret = NULL;
+    ENHMETAFILEOBJ *metaObj = GDI_GetObjPtr( hmf, OBJ_ENHMETAFILE );
+
+    if (metaObj)
+    {
+        if (!metaObj->index) metaObj->index = create_emf_index( metaObj->emh );
+        ret = metaObj->index;
+        GDI_ReleaseObj( hmf );
+    }
+    return ret;
+}
+
 /*****************************************************************************
  *         EMF_GetEnhMetaFile
  *
@@ -2270,52 +2497,98 @@ BOOL WINAPI PlayEnhMetaFileRecord(
 }
 
 
-/*****************************************************************************
- *
- *        EnumEnhMetaFile  (GDI32.@)
- *
- *  Walk an enhanced metafile, calling a user-specified function _EnhMetaFunc_
- *  for each
- *  record. Returns when either every record has been used or
- *  when _EnhMetaFunc_ returns FALSE.
- *
- *
- * RETURNS
- *  TRUE if every record is used, FALSE if any invocation of _EnhMetaFunc_
- *  returns FALSE.
- *
- * BUGS
- *   Ignores rect.
- *
- * NOTES
- *   This function behaves differently in Win9x and WinNT.
- *
- *   In WinNT, the DC's world transform is updated as the EMF changes
- *    the Window/Viewport Extent and Origin or its world transform.
- *    The actual Window/Viewport Extent and Origin are left untouched.
- *
- *   In Win9x, the DC is left untouched, and PlayEnhMetaFileRecord
- *    updates the scaling itself but only just before a record that
- *    writes anything to the DC.
- *
- *   I'm not sure where the data (enum_emh_data) is stored in either
- *    version. For this implementation, it is stored before the handle
- *    table, but it could be stored in the DC, in the EMF handle or in
- *    TLS.
- *             MJM  5 Oct 2002
- */
-BOOL WINAPI EnumEnhMetaFile(
-     HDC hdc,                /* [in] device context to pass to _EnhMetaFunc_ */
-     HENHMETAFILE hmf,       /* [in] EMF to walk */
-     ENHMFENUMPROC callback, /* [in] callback function */
-     LPVOID data,            /* [in] optional data for callback function */
-     const RECT *lpRect      /* [in] bounding rectangle for rendered metafile */
-    )
+/* convert a logical rectangle to the bounding rectangle of its device coordinates */
+static void get_device_bounds( HDC hdc, RECT *rect )
+{
+    POINT pts[4];
+    int i;
+
+    pts[0].x = pts[3].x = rect->left;
+    pts[0].y = pts[1].y = rect->top;
+    pts[1].x = pts[2].x = rect->right;
+    pts[2].y = pts[3].y = rect->bottom;
+    LPtoDP( hdc, pts, 4 );
+    rect->left = rect->right = pts[0].x;
+    rect->top = rect->bottom = pts[0].y;
+    for (i = 1; i < 4; i++)
+    {
+        rect->left   = min( rect->left, pts[i].x );
+        rect->right  = max( rect->right, pts[i].x );
+        rect->top    = min( rect->top, pts[i].y );
+        rect->bottom = max( rect->bottom, pts[i].y );
+    }
+}
+
+/* how far outside of the points the current pen can draw, in logical units */
+static int get_pen_extent( HDC hdc )
+{
+    union
+    {
+        LOGPEN    pen;
+        EXTLOGPEN ext;
+        BYTE      buffer[sizeof(EXTLOGPEN) + 16 * sizeof(DWORD)];
+    } u;
+    FLOAT miter = 1.0;
+    int size, width;
+
+    size = GetObjectW( GetCurrentObject( hdc, OBJ_PEN ), sizeof(u), &u );
+    if (size == sizeof(u.pen)) width = u.pen.lopnWidth.x;
+    else if (size >= FIELD_OFFSET( EXTLOGPEN, elpStyleEntry )) width = u.ext.elpWidth;
+    else return -1;
+
+    /* miter joins can extend up to half the miter limit times the width */
+    GetMiterLimit( hdc, &miter );
+    return width * max( miter, 1.0 ) / 2 + 1;
+}
+
+/* check if the output of a record intersects the device clip box */
+static BOOL is_record_visible( HDC hdc, const struct emf_record *record, const RECT *clip )
+{
+    RECT rect;
+    int extent = 0;
+
+    if ((record->flags & EMF_RECORD_PEN) && (extent = get_pen_extent( hdc )) < 0) return TRUE;
+
+    rect.left   = record->bounds.left - extent;
+    rect.top    = record->bounds.top - extent;
+    rect.right  = record->bounds.right + extent;
+    rect.bottom = record->bounds.bottom + extent;
+    get_device_bounds( hdc, &rect );
+
+    /* allow for rounding and cosmetic pens */
+    return rect.right + 2 >= clip->left && rect.left - 2 < clip->right &&
+           rect.bottom + 2 >= clip->top && rect.top - 2 < clip->bottom;
+}
+
+/* the metafile can only restrict the initial clipping with the other modes */
+static BOOL emr_may_extend_clipping( const ENHMETARECORD *emr )
+{
+    DWORD mode;
+
+    switch (emr->iType)
+    {
+    case EMR_EXTSELECTCLIPRGN:
+        if (emr->nSize < FIELD_OFFSET( EMREXTSELECTCLIPRGN, RgnData )) return TRUE;
+        mode = ((const EMREXTSELECTCLIPRGN *)emr)->iMode;
+        break;
+    case EMR_SELECTCLIPPATH:
+        if (emr->nSize < sizeof(EMRSELECTCLIPPATH)) return TRUE;
+        mode = ((const EMRSELECTCLIPPATH *)emr)->iMode;
+        break;
+    default:
+        return FALSE;
+    }
+    return mode != RGN_AND && mode != RGN_DIFF;
+}
+
+static BOOL enum_enh_metafile( HDC hdc, HENHMETAFILE hmf, ENHMFENUMPROC callback, LPVOID data,
+                               const RECT *lpRect, BOOL cull )
 {
     BOOL ret;
     ENHMETAHEADER *emh;
     ENHMETARECORD *emr;
-    DWORD offset;
+    const struct emf_index *index;
+    RECT clip;
     UINT i;
     HANDLETABLE *ht;
     INT savedMode = 0;
@@ -2335,12 +2608,18 @@ BOOL WINAPI EnumEnhMetaFile(
 	SetLastError(ERROR_INVALID_PARAMETER);
 	return FALSE;
     }
+    if (!hdc) cull = FALSE;
 
     emh = EMF_GetEnhMetaHeader(hmf);
     if(!emh) {
         SetLastError(ERROR_INVALID_HANDLE);
         return FALSE;
     }
+    if (!(index = EMF_GetEnhMetaIndex(hmf)))
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return FALSE;
+    }
 
     info = HeapAlloc( GetProcessHeap(), 0,
 		    sizeof (enum_emh_data) + sizeof(HANDLETABLE) * emh->nHandles );
@@ -2381,6 +2660,12 @@ BOOL WINAPI EnumEnhMetaFile(
         GetWindowOrgEx(hdc, &win_org);
         mapMode = GetMapMode(hdc);
 
+        /* Win9x only updates the transform before output records */
+        if (cull && !IS_WIN9X() && GetClipBox(hdc, &clip) != ERROR)
+            get_device_bounds(hdc, &clip);
+        else
+            cull = FALSE;
+
 	/* save DC */
 	hPen = GetCurrentObject(hdc, OBJ_PEN);
 	hBrush = GetCurrentObject(hdc, OBJ_BRUSH);
@@ -2465,17 +2750,27 @@ BOOL WINAPI EnumEnhMetaFile(
     }
 
     ret = TRUE;
-    offset = 0;
-    while(ret && offset < emh->nBytes)
+    for (i = 0; ret && i < index->count; i++)
     {
-	emr = (ENHMETARECORD *)((char *)emh + offset);
+        const struct emf_record *record = &index->records[i];
 
-        if (offset + 8 > emh->nBytes ||
-            offset > offset + emr->nSize ||
-            offset + emr->nSize > emh->nBytes)
+	emr = (ENHMETARECORD *)((char *)emh + record->offset);
+
+        if (cull)
         {
-            WARN("record truncated\n");
-            break;
+            if (record->flags & EMF_RECORD_CULL)
+            {
+                if (!is_record_visible(hdc, record, &clip))
+                {
+                    TRACE("skipping clipped record %s\n", get_emr_name(emr->iType));
+                    continue;
+                }
+            }
+            else if (emr_may_extend_clipping(emr))
+            {
+                TRACE("clipping changed by %s, playing all records\n", get_emr_name(emr->iType));
+                cull = FALSE;
+            }
         }
 
         /* In Win9x mode we update the xform if the record will produce output */
@@ -2484,7 +2779,6 @@ BOOL WINAPI EnumEnhMetaFile(
 
 	TRACE("Calling EnumFunc with record %s, size %d\n", get_emr_name(emr->iType), emr->nSize);
 	ret = (*callback)(hdc, ht, emr, emh->nHandles, (LPARAM)data);
-	offset += emr->nSize;
     }
 
     if (hdc)
@@ -2528,6 +2822,51 @@ BOOL WINAPI EnumEnhMetaFile(
     return ret;
 }
 
+/*****************************************************************************
+ *
+ *        EnumEnhMetaFile  (GDI32.@)
+ *
+ *  Walk an enhanced metafile, calling a user-specified function _EnhMetaFunc_
+ *  for each
+ *  record. Returns when either every record has been used or
+ *  when _EnhMetaFunc_ returns FALSE.
+ *
+ *
+ * RETURNS
+ *  TRUE if every record is used, FALSE if any invocation of _EnhMetaFunc_
+ *  returns FALSE.
+ *
+ * BUGS
+ *   Ignores rect.
+ *
+ * NOTES
+ *   This function behaves differently in Win9x and WinNT.
+ *
+ *   In WinNT, the DC's world transform is updated as the EMF changes
+ *    the Window/Viewport Extent and Origin or its world transform.
+ *    The actual Window/Viewport Extent and Origin are left untouched.
+ *
+ *   In Win9x, the DC is left untouched, and PlayEnhMetaFileRecord
+ *    updates the scaling itself but only just before a record that
+ *    writes anything to the DC.
+ *
+ *   I'm not sure where the data (enum_emh_data) is stored in either
+ *    version. For this implementation, it is stored before the handle
+ *    table, but it could be stored in the DC, in the EMF handle or in
+ *    TLS.
+ *             MJM  5 Oct 2002
+ */
+BOOL WINAPI EnumEnhMetaFile(
+     HDC hdc,                /* [in] device context to pass to _EnhMetaFunc_ */
+     HENHMETAFILE hmf,       /* [in] EMF to walk */
+     ENHMFENUMPROC callback, /* [in] callback function */
+     LPVOID data,            /* [in] optional data for callback function */
+     const RECT *lpRect      /* [in] bounding rectangle for rendered metafile */
+    )
+{
+    return enum_enh_metafile( hdc, hmf, callback, data, lpRect, FALSE );
+}
+
 static INT CALLBACK EMF_PlayEnhMetaFileCallback(HDC hdc, HANDLETABLE *ht,
 						const ENHMETARECORD *emr,
 						INT handles, LPARAM data)
@@ -2551,8 +2890,8 @@ BOOL WINAPI PlayEnhMetaFile(
        const RECT *lpRect /* [in] rectangle to place metafile inside */
       )
 {
-    return EnumEnhMetaFile(hdc, hmf, EMF_PlayEnhMetaFileCallback, NULL,
-			   lpRect);
+    /* the callback can't see the records, skip the ones that are entirely clipped */
+    return enum_enh_metafile( hdc, hmf, EMF_PlayEnhMetaFileCallback, NULL, lpRect, TRUE );
 }
 
 /*****************************************************************************
@@ -429,7 +429,9 @@ struct tagGdiFont {
     DWORD aa_flags;
     UINT ntmCellHeight, ntmAvgWidth;
     FONTSIGNATURE fs;
-    GdiFont *base_font;
+    Face *link_face;    /* for child fonts, the face and base font ppem they were created for */
+    LONG link_ppem;
+    SIZE_T unused_size; /* estimated memory used while on the unused list */
     VOID *GSUB_Table;
     const VOID *vert_feature;
     ULONG ttc_item_offset; /* 0 if font is not a part of TrueType collection */
@@ -461,8 +463,25 @@ struct enum_charset_list {
 
 static struct list gdi_font_list = LIST_INIT(gdi_font_list);
 static struct list unused_gdi_font_list = LIST_INIT(unused_gdi_font_list);
+static struct list child_font_list = LIST_INIT(child_font_list);
 static unsigned int unused_font_count;
-#define UNUSED_CACHE_SIZE 10
+static SIZE_T unused_font_size;
+
+/* unused fonts are freed, least recently used first, once the cache is above these limits */
+#define UNUSED_CACHE_SIZE       10
+#define UNUSED_CACHE_MAX_SIZE   256
+#define UNUSED_CACHE_MAX_MEMORY (8 * 1024 * 1024)
+/* rough cost of an open FreeType face, the font file mapping itself is shared */
+#define FT_FACE_MEMORY_SIZE     (64 * 1024)
+
+static struct
+{
+    unsigned int created;
+    unsigned int reused;
+    unsigned int evicted;
+    unsigned int child_created;
+    unsigned int child_shared;
+} font_cache_stats;
 static struct list system_links = LIST_INIT(system_links);
 
 static struct list font_subst_list = LIST_INIT(font_subst_list);
@@ -586,6 +605,20 @@ static const WCHAR face_internal_leading_value[] = {'I','n','t','e','r','n','a',
 static const WCHAR face_font_sig_value[] = {'F','o','n','t',' ','S','i','g','n','a','t','u','r','e',0};
 static const WCHAR face_file_name_value[] = {'F','i','l','e',' ','N','a','m','e','\0'};
 static const WCHAR face_full_name_value[] = {'F','u','l','l',' ','N','a','m','e','\0'};
+static const WCHAR font_catalogue_value[] = {'C','a','t','a','l','o','g','u','e',0};
+
+/* The cache key also stores a binary copy of the whole font list, so that processes
+ * can load it with a single registry query instead of walking the face keys */
+#define FONT_CATALOGUE_MAGIC    0x54414346  /* 'FCAT' */
+#define FONT_CATALOGUE_VERSION  1
+
+struct font_catalogue
+{
+    BYTE *data;
+    DWORD size;
+    DWORD pos;
+    BOOL  error;
+};
 
 
 struct font_mapping
@@ -602,6 +635,7 @@ static struct list mappings_list = LIST_INIT( mappings_list );
 
 static UINT default_aa_flags;
 static HKEY hkey_font_cache;
+static BOOL font_catalogue_valid;
 static BOOL antialias_fakes = TRUE;
 
 static CRITICAL_SECTION freetype_cs;
@@ -1818,11 +1852,20 @@ static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
     return ret;
 }
 
+static void invalidate_font_catalogue(void)
+{
+    if (!font_catalogue_valid) return;
+    RegDeleteValueW( hkey_font_cache, font_catalogue_value );
+    font_catalogue_valid = FALSE;
+}
+
 static void add_face_to_cache(Face *face)
 {
     HKEY hkey_family, hkey_face;
     WCHAR *face_key_name;
 
+    invalidate_font_catalogue();
+
     RegCreateKeyExW(hkey_font_cache, face->family->FamilyName, 0,
                     NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &hkey_family, NULL);
     if(face->family->EnglishName)
@@ -1872,6 +1915,8 @@ static void remove_face_from_cache( Face *face )
 {
     HKEY hkey_family;
 
+    invalidate_font_catalogue();
+
     RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family );
 
     if (face->scalable)
@@ -1889,6 +1934,272 @@ static void remove_face_from_cache( Face *face )
     RegCloseKey(hkey_family);
 }
 
+static void catalogue_write( struct font_catalogue *cat, const void *data, DWORD size )
+{
+    DWORD aligned = (size + 3) & ~3;
+
+    if (cat->error) return;
+    if (cat->pos + aligned > cat->size)
+    {
+        DWORD new_size = max( cat->size * 2, cat->pos + aligned );
+        BYTE *new_data = cat->data ? HeapReAlloc( GetProcessHeap(), 0, cat->data, new_size )
+                                   : HeapAlloc( GetProcessHeap(), 0, new_size );
+        if (!new_data)
+        {
+            cat->error = TRUE;
+            return;
+        }
+        cat->data = new_data;
+        cat->size = new_size;
+    }
+    memcpy( cat->data + cat->pos, data, size );
+    memset( cat->data + cat->pos + size, 0, aligned - size );
+    cat->pos += aligned;
+}
+
+static inline void catalogue_write_dword( struct font_catalogue *cat, DWORD val )
+{
+    catalogue_write( cat, &val, sizeof(val) );
+}
+
+static void catalogue_write_string( struct font_catalogue *cat, const WCHAR *str )
+{
+    DWORD len = str ? strlenW( str ) + 1 : 0;
+
+    catalogue_write_dword( cat, len );
+    catalogue_write( cat, str, len * sizeof(WCHAR) );
+}
+
+static const void *catalogue_read( struct font_catalogue *cat, DWORD size )
+{
+    DWORD aligned = (size + 3) & ~3;
+    const void *ret;
+
+    if (cat->error || aligned < size || cat->size - cat->pos < aligned)
+    {
+        cat->error = TRUE;
+        return NULL;
+    }
+    ret = cat->data + cat->pos;
+    cat->pos += aligned;
+    return ret;
+}
+
+static DWORD catalogue_read_dword( struct font_catalogue *cat )
+{
+    const DWORD *ptr = catalogue_read( cat, sizeof(DWORD) );
+    return ptr ? *ptr : 0;
+}
+
+/* returns NULL for a NULL string, sets the error flag if the string is required */
+static const WCHAR *catalogue_read_string( struct font_catalogue *cat, BOOL required )
+{
+    DWORD len = catalogue_read_dword( cat );
+    const WCHAR *str;
+
+    if (len > 0x10000) cat->error = TRUE;
+    if (!len || len > 0x10000)
+    {
+        if (required) cat->error = TRUE;
+        return NULL;
+    }
+    if (!(str = catalogue_read( cat, len * sizeof(WCHAR) ))) return NULL;
+    if (str[len - 1])
+    {
+        cat->error = TRUE;
+        return NULL;
+    }
+    return str;
+}
+
+static inline WCHAR *catalogue_strdupW( const WCHAR *str )
+{
+    return str ? strdupW( str ) : NULL;
+}
+
+/* save the faces that are in the registry cache to the catalogue value */
+static void save_font_catalogue(void)
+{
+    struct font_catalogue cat = { NULL, 0, 0, FALSE };
+    Family *family;
+    Face *face;
+    DWORD count, families = 0;
+
+    catalogue_write_dword( &cat, FONT_CATALOGUE_MAGIC );
+    catalogue_write_dword( &cat, FONT_CATALOGUE_VERSION );
+    catalogue_write_dword( &cat, 0 );  /* number of families, updated below */
+
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+    {
+        count = 0;
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+            if (face->flags & ADDFONT_ADD_TO_CACHE) count++;
+        if (!count) continue;
+
+        catalogue_write_string( &cat, family->FamilyName );
+        catalogue_write_string( &cat, family->EnglishName );
+        catalogue_write_dword( &cat, count );
+
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+        {
+            if (!(face->flags & ADDFONT_ADD_TO_CACHE)) continue;
+            catalogue_write_string( &cat, face->StyleName );
+            catalogue_write_string( &cat, face->FullName );
+            catalogue_write_string( &cat, face->file );
+            catalogue_write_dword( &cat, face->face_index );
+            catalogue_write_dword( &cat, face->ntmFlags );
+            catalogue_write_dword( &cat, face->font_version );
+            catalogue_write_dword( &cat, face->flags );
+            catalogue_write( &cat, &face->fs, sizeof(face->fs) );
+            catalogue_write_dword( &cat, face->scalable );
+            if (face->scalable) continue;
+            catalogue_write_dword( &cat, face->size.height );
+            catalogue_write_dword( &cat, face->size.width );
+            catalogue_write_dword( &cat, face->size.size );
+            catalogue_write_dword( &cat, face->size.x_ppem );
+            catalogue_write_dword( &cat, face->size.y_ppem );
+            catalogue_write_dword( &cat, face->size.internal_leading );
+        }
+        families++;
+    }
+
+    if (!cat.error)
+    {
+        ((DWORD *)cat.data)[2] = families;
+        if (!RegSetValueExW( hkey_font_cache, font_catalogue_value, 0, REG_BINARY, cat.data, cat.pos ))
+        {
+            TRACE( "saved %u families, %u bytes\n", families, cat.pos );
+            font_catalogue_valid = TRUE;
+        }
+    }
+    HeapFree( GetProcessHeap(), 0, cat.data );
+}
+
+/* parse the catalogue, only checking its consistency unless build is set */
+static BOOL parse_font_catalogue( struct font_catalogue *cat, BOOL build )
+{
+    DWORD i, j, families, faces;
+    const WCHAR *family_name, *english_name;
+    Family *family = NULL;
+    Face *face;
+
+    cat->pos = 0;
+    cat->error = FALSE;
+    if (catalogue_read_dword( cat ) != FONT_CATALOGUE_MAGIC) return FALSE;
+    if (catalogue_read_dword( cat ) != FONT_CATALOGUE_VERSION) return FALSE;
+    families = catalogue_read_dword( cat );
+
+    for (i = 0; i < families && !cat->error; i++)
+    {
+        family_name = catalogue_read_string( cat, TRUE );
+        english_name = catalogue_read_string( cat, FALSE );
+        faces = catalogue_read_dword( cat );
+
+        if (build)
+        {
+            family = create_family( strdupW( family_name ), catalogue_strdupW( english_name ));
+            if (english_name)
+            {
+                FontSubst *subst = HeapAlloc( GetProcessHeap(), 0, sizeof(*subst) );
+                subst->from.name = strdupW( english_name );
+                subst->from.charset = -1;
+                subst->to.name = strdupW( family_name );
+                subst->to.charset = -1;
+                add_font_subst( &font_subst_list, subst, 0 );
+            }
+        }
+
+        for (j = 0; j < faces && !cat->error; j++)
+        {
+            if (build)
+            {
+                face = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*face) );
+                face->refcount = 1;
+                face->StyleName = strdupW( catalogue_read_string( cat, TRUE ));
+                face->FullName = catalogue_strdupW( catalogue_read_string( cat, FALSE ));
+                face->file = strdupW( catalogue_read_string( cat, TRUE ));
+                face->face_index = catalogue_read_dword( cat );
+                face->ntmFlags = catalogue_read_dword( cat );
+                face->font_version = catalogue_read_dword( cat );
+                face->flags = catalogue_read_dword( cat );
+                memcpy( &face->fs, catalogue_read( cat, sizeof(face->fs) ), sizeof(face->fs) );
+                face->scalable = catalogue_read_dword( cat );
+                if (!face->scalable)
+                {
+                    face->size.height = catalogue_read_dword( cat );
+                    face->size.width = catalogue_read_dword( cat );
+                    face->size.size = catalogue_read_dword( cat );
+                    face->size.x_ppem = catalogue_read_dword( cat );
+                    face->size.y_ppem = catalogue_read_dword( cat );
+                    face->size.internal_leading = catalogue_read_dword( cat );
+                }
+                if (insert_face_in_family_list( face, family ))
+                    TRACE( "Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName) );
+                release_face( face );
+            }
+            else
+            {
+                catalogue_read_string( cat, TRUE );
+                catalogue_read_string( cat, FALSE );
+                catalogue_read_string( cat, TRUE );
+                catalogue_read( cat, 4 * sizeof(DWORD) + sizeof(FONTSIGNATURE) );
+                if (!catalogue_read_dword( cat )) catalogue_read( cat, 6 * sizeof(DWORD) );
+            }
+        }
+        if (build) release_family( family );
+    }
+    return !cat->error && cat->pos == cat->size;
+}
+
+static int family_name_compare( const void *p1, const void *p2 )
+{
+    const Family *family1 = *(const Family * const *)p1;
+    const Family *family2 = *(const Family * const *)p2;
+
+    return strcmpiW( family1->FamilyName, family2->FamilyName );
+}
+
+/* sort the families the same way the registry sorts the cache keys */
+static void sort_font_families(void)
+{
+    Family *family, **array;
+    unsigned int i, count = list_count( &font_list );
+
+    if (!(array = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*array) ))) return;
+    i = 0;
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry ) array[i++] = family;
+    qsort( array, count, sizeof(*array), family_name_compare );
+    list_init( &font_list );
+    for (i = 0; i < count; i++) list_add_tail( &font_list, &array[i]->entry );
+    HeapFree( GetProcessHeap(), 0, array );
+}
+
+/* load the font list from the catalogue value, returns FALSE if it's missing or invalid */
+static BOOL load_font_catalogue(void)
+{
+    struct font_catalogue cat = { NULL, 0, 0, FALSE };
+    DWORD type;
+    BOOL ret = FALSE;
+
+    if (RegQueryValueExW( hkey_font_cache, font_catalogue_value, NULL, &type, NULL, &cat.size ) ||
+        type != REG_BINARY)
+        return FALSE;
+    if (!(cat.data = HeapAlloc( GetProcessHeap(), 0, cat.size ))) return FALSE;
+
+    if (!RegQueryValueExW( hkey_font_cache, font_catalogue_value, NULL, NULL, cat.data, &cat.size ) &&
+        parse_font_catalogue( &cat, FALSE ))
+    {
+        parse_font_catalogue( &cat, TRUE );
+        sort_font_families();
+        reorder_vertical_fonts();
+        TRACE( "loaded %u families from the catalogue\n", list_count( &font_list ));
+        font_catalogue_valid = TRUE;
+        ret = TRUE;
+    }
+    HeapFree( GetProcessHeap(), 0, cat.data );
+    return ret;
+}
+
 static WCHAR *prepend_at(WCHAR *family)
 {
     WCHAR *str;
@@ -4408,8 +4719,11 @@ BOOL WineEngInit(void)
     create_font_cache_key(&hkey_font_cache, &disposition);
 
     if(disposition == REG_CREATED_NEW_KEY)
+    {
         init_font_list();
-    else
+        save_font_catalogue();
+    }
+    else if (!load_font_catalogue())
         load_font_list_from_cache(hkey_font_cache);
 
     reorder_font_list();
@@ -4677,8 +4991,13 @@ static void free_font(GdiFont *font)
     LIST_FOR_EACH_ENTRY_SAFE( child, child_next, &font->child_fonts, CHILD_FONT, entry )
     {
         list_remove(&child->entry);
-        if(child->font)
-            free_font(child->font);
+        /* child fonts are shared between all the base fonts linking to them */
+        if (child->font && !--child->font->refcount)
+        {
+            list_remove( &child->font->entry );
+            release_face( child->font->link_face );
+            free_font( child->font );
+        }
         release_face( child->face );
         HeapFree(GetProcessHeap(), 0, child);
     }
@@ -4909,17 +5228,35 @@ static void dump_gdi_font_list(void)
     GdiFont *font;
 
     TRACE("---------- Font Cache ----------\n");
+    TRACE("created %u reused %u evicted %u, %u unused using %lu bytes, child fonts created %u shared %u\n",
+          font_cache_stats.created, font_cache_stats.reused, font_cache_stats.evicted,
+          unused_font_count, unused_font_size, font_cache_stats.child_created,
+          font_cache_stats.child_shared);
     LIST_FOR_EACH_ENTRY( font, &gdi_font_list, struct tagGdiFont, entry )
         TRACE("font=%p ref=%u %s %d\n", font, font->refcount,
               debugstr_w(font->font_desc.lf.lfFaceName), font->font_desc.lf.lfHeight);
 }
 
+/* estimate the memory that freeing an unused font would give back */
+static SIZE_T get_font_memory_size( const GdiFont *font )
+{
+    SIZE_T size = sizeof(*font) + FT_FACE_MEMORY_SIZE;
+    DWORD i;
+
+    for (i = 0; i < font->gmsize; i++)
+        if (font->gm[i]) size += GM_BLOCK_SIZE * sizeof(GM);
+    if (font->potm) size += font->potm->otmSize;
+    if (font->kern_pairs) size += font->total_kern_pairs * sizeof(KERNINGPAIR);
+    return size;
+}
+
 static void grab_font( GdiFont *font )
 {
     if (!font->refcount++)
     {
         list_remove( &font->unused_entry );
         unused_font_count--;
+        unused_font_size -= font->unused_size;
     }
 }
 
@@ -4931,16 +5268,23 @@ static void release_font( GdiFont *font )
         TRACE( "font %p\n", font );
 
         /* add it to the unused list */
+        font->unused_size = get_font_memory_size( font );
         list_add_head( &unused_gdi_font_list, &font->unused_entry );
-        if (unused_font_count > UNUSED_CACHE_SIZE)
+        unused_font_count++;
+        unused_font_size += font->unused_size;
+
+        while (unused_font_count > UNUSED_CACHE_SIZE &&
+               (unused_font_count > UNUSED_CACHE_MAX_SIZE || unused_font_size > UNUSED_CACHE_MAX_MEMORY))
         {
             font = LIST_ENTRY( list_tail( &unused_gdi_font_list ), struct tagGdiFont, unused_entry );
             TRACE( "freeing %p\n", font );
             list_remove( &font->entry );
             list_remove( &font->unused_entry );
+            unused_font_count--;
+            unused_font_size -= font->unused_size;
+            font_cache_stats.evicted++;
             free_font( font );
         }
-        else unused_font_count++;
 
         if (TRACE_ON(font)) dump_gdi_font_list();
     }
@@ -4997,6 +5341,7 @@ static GdiFont *find_in_cache(HFONT hfont, const LOGFONTW *plf, const FMAT2 *pma
         list_remove( &ret->entry );
         list_add_head( &gdi_font_list, &ret->entry );
         grab_font( ret );
+        font_cache_stats.reused++;
         return ret;
     }
     return NULL;
@@ -5008,6 +5353,7 @@ static void add_to_cache(GdiFont *font)
 
     font->cache_num = cache_num++;
     list_add_head(&gdi_font_list, &font->entry);
+    font_cache_stats.created++;
     TRACE( "font %p\n", font );
 }
 
@@ -8214,6 +8560,7 @@ static BOOL load_child_font(GdiFont *font, CHILD_FONT *child)
 {
     const struct list *face_list;
     Face *child_face = NULL, *best_face = NULL;
+    GdiFont *child_font;
     UINT penalty = 0, new_penalty = 0;
     BOOL bold, italic, bd, it;
 
@@ -8234,6 +8581,21 @@ static BOOL load_child_font(GdiFont *font, CHILD_FONT *child)
     }
     child_face = best_face ? best_face : child->face;
 
+    /* the same linked fonts are used as fallbacks by most base fonts, share their instances */
+    LIST_FOR_EACH_ENTRY( child_font, &child_font_list, struct tagGdiFont, entry )
+    {
+        if (child_font->link_face != child_face || child_font->link_ppem != font->ppem) continue;
+        if (child_font->orientation != font->orientation || child_font->scale_y != font->scale_y) continue;
+        if (!child_font->font_desc.can_use_bitmap != !font->font_desc.can_use_bitmap) continue;
+        if (memcmp( &child_font->font_desc.matrix, &font->font_desc.matrix, sizeof(FMAT2) )) continue;
+        if (memcmp( &child_font->font_desc.lf, &font->font_desc.lf, offsetof(LOGFONTW, lfFaceName) )) continue;
+        child_font->refcount++;
+        child->font = child_font;
+        font_cache_stats.child_shared++;
+        TRACE("sharing child font %p for base %p\n", child->font, font);
+        return TRUE;
+    }
+
     child->font = alloc_font();
     child->font->ft_face = OpenFontFace( child->font, child_face, 0, -font->ppem );
     if(!child->font->ft_face)
@@ -8246,11 +8608,17 @@ static BOOL load_child_font(GdiFont *font, CHILD_FONT *child)
     child->font->fake_italic = italic && !( child_face->ntmFlags & NTM_ITALIC );
     child->font->fake_bold = bold && !( child_face->ntmFlags & NTM_BOLD );
     child->font->font_desc = font->font_desc;
+    /* the instance is shared with other base fonts, so it must not keep this one's name */
+    lstrcpynW( child->font->font_desc.lf.lfFaceName, child_face->family->FamilyName, LF_FACESIZE );
     child->font->ntmFlags = child_face->ntmFlags;
     child->font->orientation = font->orientation;
     child->font->scale_y = font->scale_y;
     child->font->name = strdupW( child_face->family->FamilyName );
-    child->font->base_font = font;
+    child->font->link_face = child_face;
+    child->font->link_ppem = font->ppem;
+    child_face->refcount++;
+    list_add_head( &child_font_list, &child->font->entry );
+    font_cache_stats.child_created++;
     TRACE("created child font %p for base %p\n", child->font, font);
     return TRUE;
 }
@@ -8260,9 +8628,6 @@ static BOOL get_glyph_index_linked(GdiFont *font, UINT c, GdiFont **linked_font,
     FT_UInt g,o;
     CHILD_FONT *child_font;
 
-    if(font->base_font)
-        font = font->base_font;
-
     *linked_font = font;
 
     if((*glyph = get_glyph_index(font, c)))
@@ -57,6 +57,7 @@ struct gdi_handle_entry
     WORD                        selcount;    /* number of times the object is selected in a DC */
     WORD                        system : 1;  /* system object flag */
     WORD                        deleted : 1; /* whether DeleteObject has been called on this object */
+    LONG                        pins;        /* number of lock-free lookups in progress */
 };
 
 static struct gdi_handle_entry gdi_handles[MAX_GDI_HANDLES];
@@ -84,6 +85,29 @@ static inline struct gdi_handle_entry *handle_entry( HGDIOBJ handle )
     return NULL;
 }
 
+/* lock-free version of handle_entry, the entry can't be freed until unpin_handle_entry is called */
+static struct gdi_handle_entry *pin_handle_entry( HGDIOBJ handle )
+{
+    unsigned int idx = LOWORD(handle) - FIRST_GDI_HANDLE;
+    struct gdi_handle_entry *entry;
+
+    if (idx < MAX_GDI_HANDLES)
+    {
+        entry = &gdi_handles[idx];
+        InterlockedIncrement( &entry->pins );
+        if (entry->type && (!HIWORD( handle ) || HIWORD( handle ) == entry->generation))
+            return entry;
+        InterlockedDecrement( &entry->pins );
+    }
+    if (handle) WARN( "invalid handle %p\n", handle );
+    return NULL;
+}
+
+static inline void unpin_handle_entry( struct gdi_handle_entry *entry )
+{
+    InterlockedDecrement( &entry->pins );
+}
+
 /***********************************************************************
  *          GDI stock objects
  */
@@ -803,14 +827,16 @@ HGDIOBJ alloc_gdi_handle( void *obj, WORD type, const struct gdi_obj_funcs *func
         if (TRACE_ON(gdi)) dump_gdi_objects();
         return 0;
     }
-    entry->obj      = obj;
+    /* the generation is bumped when the handle is freed, so that lock-free
+     * lookups of a stale handle can't match the entry while it is being reused */
+    if (!entry->generation) entry->generation = 1;
     entry->funcs    = funcs;
     entry->hdcs     = NULL;
-    entry->type     = type;
     entry->selcount = 0;
     entry->system   = 0;
     entry->deleted  = 0;
-    if (++entry->generation == 0xffff) entry->generation = 1;
+    InterlockedExchangePointer( &entry->obj, obj );
+    entry->type     = type;
     ret = entry_to_handle( entry );
     LeaveCriticalSection( &gdi_section );
     TRACE( "allocated %s %p %u/%u\n", gdi_obj_type(type), ret,
@@ -836,6 +862,9 @@ void *free_gdi_handle( HGDIOBJ handle )
                InterlockedDecrement( &debug_count ) + 1, MAX_GDI_HANDLES );
         object = entry->obj;
         entry->type = 0;
+        if (++entry->generation == 0xffff) entry->generation = 1;
+        /* wait for the lock-free lookups still using the object */
+        while (InterlockedCompareExchange( &entry->pins, 0, 0 )) Sleep( 0 );
         entry->obj = next_free;
         next_free = entry;
     }
@@ -853,11 +882,10 @@ HGDIOBJ get_full_gdi_handle( HGDIOBJ handle )
 {
     struct gdi_handle_entry *entry;
 
-    if (!HIWORD( handle ))
+    if (!HIWORD( handle ) && (entry = pin_handle_entry( handle )))
     {
-        EnterCriticalSection( &gdi_section );
-        if ((entry = handle_entry( handle ))) handle = entry_to_handle( entry );
-        LeaveCriticalSection( &gdi_section );
+        handle = entry_to_handle( entry );
+        unpin_handle_entry( entry );
     }
     return handle;
 }
@@ -914,6 +942,32 @@ void GDI_ReleaseObj( HGDIOBJ handle )
     LeaveCriticalSection( &gdi_section );
 }
 
+/***********************************************************************
+ *           get_any_obj_ref
+ *
+ * Return a pointer to, and the type of, the GDI object associated
+ * with the handle, without taking the GDI lock. The object is only
+ * guaranteed to stay allocated, the caller has to take care of any
+ * locking needed to access its contents.
+ * The object must be released with release_obj_ref.
+ */
+void *get_any_obj_ref( HGDIOBJ handle, WORD *type )
+{
+    struct gdi_handle_entry *entry;
+
+    if (!(entry = pin_handle_entry( handle ))) return NULL;
+    *type = entry->type;
+    return entry->obj;
+}
+
+/***********************************************************************
+ *           release_obj_ref
+ */
+void release_obj_ref( HGDIOBJ handle )
+{
+    unpin_handle_entry( &gdi_handles[LOWORD(handle) - FIRST_GDI_HANDLE] );
+}
+
 
 /***********************************************************************
  *           GDI_CheckNotLock
@@ -1142,9 +1196,11 @@ DWORD WINAPI GetObjectType( HGDIOBJ handle )
     struct gdi_handle_entry *entry;
     DWORD result = 0;
 
-    EnterCriticalSection( &gdi_section );
-    if ((entry = handle_entry( handle ))) result = entry->type;
-    LeaveCriticalSection( &gdi_section );
+    if ((entry = pin_handle_entry( handle )))
+    {
+        result = entry->type;
+        unpin_handle_entry( entry );
+    }
 
     TRACE("%p -> %u\n", handle, result );
     if (!result) SetLastError( ERROR_INVALID_HANDLE );
@@ -1222,13 +1278,12 @@ HGDIOBJ WINAPI SelectObject( HDC hdc, HGDIOBJ hObj )
 
     TRACE( "(%p,%p)\n", hdc, hObj );
 
-    EnterCriticalSection( &gdi_section );
-    if ((entry = handle_entry( hObj )))
+    if ((entry = pin_handle_entry( hObj )))
     {
         funcs = entry->funcs;
         hObj = entry_to_handle( entry );  /* make it a full handle */
+        unpin_handle_entry( entry );
     }
-    LeaveCriticalSection( &gdi_section );
 
     if (funcs && funcs->pSelectObject) return funcs->pSelectObject( hObj, hdc );
     return 0;
@@ -1243,13 +1298,12 @@ BOOL WINAPI UnrealizeObject( HGDIOBJ obj )
     const struct gdi_obj_funcs *funcs = NULL;
     struct gdi_handle_entry *entry;
 
-    EnterCriticalSection( &gdi_section );
-    if ((entry = handle_entry( obj )))
+    if ((entry = pin_handle_entry( obj )))
     {
         funcs = entry->funcs;
         obj = entry_to_handle( entry );  /* make it a full handle */
+        unpin_handle_entry( entry );
     }
-    LeaveCriticalSection( &gdi_section );
 
     if (funcs && funcs->pUnrealizeObject) return funcs->pUnrealizeObject( obj );
     return funcs != NULL;
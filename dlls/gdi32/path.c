@@ -399,14 +399,16 @@ static BOOL PATH_CheckCorners( DC *dc, POINT corners[], INT x1, INT y1, INT x2,
 }
 
 /* PATH_AddFlatBezier
+ *
+ * Flattens a run of count points (3n+1) of consecutive Bezier curves.
  */
-static BOOL PATH_AddFlatBezier(struct gdi_path *pPath, POINT *pt, BOOL closed)
+static BOOL PATH_AddFlatBezier(struct gdi_path *pPath, const POINT *pt, INT count, BOOL closed)
 {
     POINT *pts;
     BOOL ret;
     INT no;
 
-    pts = GDI_Bezier( pt, 4, &no );
+    pts = GDI_Bezier( pt, count, &no );
     if(!pts) return FALSE;
 
     ret = (add_points( pPath, pts + 1, no - 1, PT_LINETO ) != NULL);
@@ -423,7 +425,7 @@ static BOOL PATH_AddFlatBezier(struct gdi_path *pPath, POINT *pt, BOOL closed)
 static struct gdi_path *PATH_FlattenPath(const struct gdi_path *pPath)
 {
     struct gdi_path *new_path;
-    INT srcpt;
+    INT srcpt, end;
 
     if (!(new_path = alloc_gdi_path( pPath->count ))) return NULL;
 
@@ -438,13 +440,16 @@ static struct gdi_path *PATH_FlattenPath(const struct gdi_path *pPath)
             }
 	    break;
 	case PT_BEZIERTO:
-            if (!PATH_AddFlatBezier(new_path, &pPath->points[srcpt-1],
-                                    pPath->flags[srcpt+2] & PT_CLOSEFIGURE))
+            /* flatten all the curves of the figure at once */
+            for (end = srcpt + 2; end + 3 < pPath->count; end += 3)
+                if ((pPath->flags[end] & PT_CLOSEFIGURE) || pPath->flags[end + 1] != PT_BEZIERTO) break;
+            if (!PATH_AddFlatBezier(new_path, &pPath->points[srcpt-1], end - srcpt + 2,
+                                    pPath->flags[end] & PT_CLOSEFIGURE))
             {
                 free_gdi_path( new_path );
                 return NULL;
             }
-	    srcpt += 2;
+	    srcpt = end;
 	    break;
 	}
     }
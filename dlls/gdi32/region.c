@@ -126,23 +126,60 @@ static inline BOOL overlapping( const RECT *r1, const RECT *r2 )
             r1->bottom > r2->top && r1->top < r2->bottom);
 }
 
+/* freed rectangle arrays are kept for reuse, one for each power of two size */
+#define RECT_POOL_MIN_SIZE 16
+#define RECT_POOL_CLASSES  7   /* up to 1024 rectangles */
+
+static RECT *rect_pool[RECT_POOL_CLASSES];
+
+static int get_rect_pool_class( int size )
+{
+    int class;
+
+    for (class = 0; class < RECT_POOL_CLASSES; class++)
+        if (size == RECT_POOL_MIN_SIZE << class) return class;
+    return -1;
+}
+
+/* round up the size of a rectangle array to a pooled size if possible */
+static int get_rect_alloc_size( int size )
+{
+    int class;
+
+    for (class = 0; class < RECT_POOL_CLASSES; class++)
+        if (size <= RECT_POOL_MIN_SIZE << class) return RECT_POOL_MIN_SIZE << class;
+    return size;
+}
+
+static RECT *alloc_rects( int size )
+{
+    int class = get_rect_pool_class( size );
+    RECT *rects;
+
+    if (class != -1 && (rects = InterlockedExchangePointer( (void **)&rect_pool[class], NULL )))
+        return rects;
+    return HeapAlloc( GetProcessHeap(), 0, size * sizeof(RECT) );
+}
+
+static void free_rects( RECT *rects, int size )
+{
+    int class = get_rect_pool_class( size );
+
+    if (class != -1 && !InterlockedCompareExchangePointer( (void **)&rect_pool[class], rects, NULL ))
+        return;
+    HeapFree( GetProcessHeap(), 0, rects );
+}
+
 static BOOL grow_region( WINEREGION *rgn, int size )
 {
     RECT *new_rects;
 
     if (size <= rgn->size) return TRUE;
 
-    if (rgn->rects == rgn->rects_buf)
-    {
-        new_rects = HeapAlloc( GetProcessHeap(), 0, size * sizeof(RECT) );
-        if (!new_rects) return FALSE;
-        memcpy( new_rects, rgn->rects, rgn->numRects * sizeof(RECT) );
-    }
-    else
-    {
-        new_rects = HeapReAlloc( GetProcessHeap(), 0, rgn->rects, size * sizeof(RECT) );
-        if (!new_rects) return FALSE;
-    }
+    size = get_rect_alloc_size( size );
+    if (!(new_rects = alloc_rects( size ))) return FALSE;
+    memcpy( new_rects, rgn->rects, rgn->numRects * sizeof(RECT) );
+    if (rgn->rects != rgn->rects_buf) free_rects( rgn->rects, rgn->size );
     rgn->rects = new_rects;
     rgn->size = size;
     return TRUE;
@@ -162,6 +199,13 @@ static BOOL add_rect( WINEREGION *reg, INT left, INT top, INT right, INT bottom
     return TRUE;
 }
 
+/* Check if r1 contains r2. */
+static inline BOOL rect_contains( const RECT *r1, const RECT *r2 )
+{
+    return (r1->left <= r2->left && r1->right >= r2->right &&
+            r1->top <= r2->top && r1->bottom >= r2->bottom);
+}
+
 static inline void empty_region( WINEREGION *reg )
 {
     reg->numRects = 0;
@@ -328,6 +372,7 @@ static inline void bres_incr_polygon( struct bres_info *bres )
 typedef struct edge_table_entry {
     struct list entry;
     struct list winding_entry;
+    INT ymin;                     /* ycoord at which we enter this edge. */
     INT ymax;                     /* ycoord at which we exit this edge. */
     struct bres_info bres;        /* Bresenham info to run the edge     */
     int ClockWise;                /* flag for winding number rule       */
@@ -412,8 +457,8 @@ static BOOL init_region( WINEREGION *pReg, INT n )
     if (n > RGN_DEFAULT_RECTS)
     {
         if (n > INT_MAX / sizeof(RECT)) return FALSE;
-        if (!(pReg->rects = HeapAlloc( GetProcessHeap(), 0, n * sizeof( RECT ) )))
-            return FALSE;
+        n = get_rect_alloc_size( n );
+        if (!(pReg->rects = alloc_rects( n ))) return FALSE;
     }
     else
         pReg->rects = pReg->rects_buf;
@@ -429,7 +474,7 @@ static BOOL init_region( WINEREGION *pReg, INT n )
 static void destroy_region( WINEREGION *pReg )
 {
     if (pReg->rects != pReg->rects_buf)
-        HeapFree( GetProcessHeap(), 0, pReg->rects );
+        free_rects( pReg->rects, pReg->size );
 }
 
 /***********************************************************************
@@ -1603,12 +1648,14 @@ static void REGION_compact( WINEREGION *reg )
 {
     if ((reg->numRects < reg->size / 2) && (reg->numRects > RGN_DEFAULT_RECTS))
     {
-        RECT *new_rects = HeapReAlloc( GetProcessHeap(), 0, reg->rects, reg->numRects * sizeof(RECT) );
-        if (new_rects)
-        {
-            reg->rects = new_rects;
-            reg->size = reg->numRects;
-        }
+        int size = get_rect_alloc_size( reg->numRects );
+        RECT *new_rects;
+
+        if (size >= reg->size || !(new_rects = alloc_rects( size ))) return;
+        memcpy( new_rects, reg->rects, reg->numRects * sizeof(RECT) );
+        free_rects( reg->rects, reg->size );
+        reg->rects = new_rects;
+        reg->size = size;
     }
 }
 
@@ -1749,7 +1796,7 @@ static BOOL REGION_RegionOp(
 
             if ((top != bot) && (nonOverlap1Func != NULL))
 	    {
-		if (!nonOverlap1Func(&newReg, r1, r1BandEnd, top, bot)) return FALSE;
+		if (!nonOverlap1Func(&newReg, r1, r1BandEnd, top, bot)) goto failed;
 	    }
 
 	    ytop = r2->top;
@@ -1761,7 +1808,7 @@ static BOOL REGION_RegionOp(
 
             if ((top != bot) && (nonOverlap2Func != NULL))
 	    {
-		if (!nonOverlap2Func(&newReg, r2, r2BandEnd, top, bot)) return FALSE;
+		if (!nonOverlap2Func(&newReg, r2, r2BandEnd, top, bot)) goto failed;
 	    }
 
 	    ytop = r1->top;
@@ -1790,7 +1837,7 @@ static BOOL REGION_RegionOp(
 	curBand = newReg.numRects;
 	if (ybot > ytop)
 	{
-	    if (!overlapFunc(&newReg, r1, r1BandEnd, r2, r2BandEnd, ytop, ybot)) return FALSE;
+	    if (!overlapFunc(&newReg, r1, r1BandEnd, r2, r2BandEnd, ytop, ybot)) goto failed;
 	}
 
 	if (newReg.numRects != curBand)
@@ -1828,7 +1875,7 @@ static BOOL REGION_RegionOp(
 		    r1BandEnd++;
 		}
 		if (!nonOverlap1Func(&newReg, r1, r1BandEnd, max(r1->top,ybot), r1->bottom))
-                    return FALSE;
+                    goto failed;
 		r1 = r1BandEnd;
 	    } while (r1 != r1End);
 	}
@@ -1843,7 +1890,7 @@ static BOOL REGION_RegionOp(
 		 r2BandEnd++;
 	    }
 	    if (!nonOverlap2Func(&newReg, r2, r2BandEnd, max(r2->top,ybot), r2->bottom))
-                return FALSE;
+                goto failed;
 	    r2 = r2BandEnd;
 	} while (r2 != r2End);
     }
@@ -1856,6 +1903,11 @@ static BOOL REGION_RegionOp(
     REGION_compact( &newReg );
     move_rects( destReg, &newReg );
     return TRUE;
+
+failed:
+    /* leave the destination untouched */
+    destroy_region( &newReg );
+    return FALSE;
 }
 
 /***********************************************************************
@@ -1930,6 +1982,16 @@ static BOOL REGION_IntersectRegion(WINEREGION *newReg, WINEREGION *reg1,
     if ( (!(reg1->numRects)) || (!(reg2->numRects))  ||
 	(!overlapping(&reg1->extents, &reg2->extents)))
 	newReg->numRects = 0;
+    /* clipping against a single rectangle is by far the most common case */
+    else if (reg1->numRects == 1 && reg2->numRects == 1)
+    {
+        newReg->numRects = 1;
+        intersect_rect( newReg->rects, &reg1->extents, &reg2->extents );
+    }
+    else if (reg1->numRects == 1 && rect_contains( &reg1->extents, &reg2->extents ))
+        return REGION_CopyRegion( newReg, reg2 );
+    else if (reg2->numRects == 1 && rect_contains( &reg2->extents, &reg1->extents ))
+        return REGION_CopyRegion( newReg, reg1 );
     else
 	if (!REGION_RegionOp (newReg, reg1, reg2, REGION_IntersectO, NULL, NULL)) return FALSE;
 
@@ -2254,6 +2316,13 @@ static BOOL REGION_SubtractRegion(WINEREGION *regD, WINEREGION *regM, WINEREGION
 	(!overlapping(&regM->extents, &regS->extents)) )
 	return REGION_CopyRegion(regD, regM);
 
+    /* check for trivial subtraction of everything */
+    if (regS->numRects == 1 && rect_contains( &regS->extents, &regM->extents ))
+    {
+        empty_region( regD );
+        return TRUE;
+    }
+
     if (!REGION_RegionOp (regD, regM, regS, REGION_SubtractO, REGION_SubtractNonO1, NULL))
         return FALSE;
 
@@ -2298,68 +2367,69 @@ static BOOL REGION_XorRegion(WINEREGION *dr, WINEREGION *sra, WINEREGION *srb)
 #define SMALL_COORDINATE  0x80000000
 
 /***********************************************************************
- *     REGION_InsertEdgeInET
- *
- *     Insert the given edge into the edge table.
- *     First we must find the correct bucket in the
- *     Edge table, then find the right slot in the
- *     bucket.  Finally, we can insert it.
+ *     compare_edges
  *
+ *     Sort order of the edge table: by starting scanline, then by x.
+ *     Edges that start at the same point are kept in reverse order of
+ *     creation.
  */
-static void REGION_InsertEdgeInET(EdgeTable *ET, EdgeTableEntry *ETE,
-                INT scanline, ScanLineListBlock **SLLBlock, INT *iSLLBlock)
+static int compare_edges( const void *a, const void *b )
+{
+    const EdgeTableEntry *edge1 = *(const EdgeTableEntry * const *)a;
+    const EdgeTableEntry *edge2 = *(const EdgeTableEntry * const *)b;
 
+    if (edge1->ymin != edge2->ymin) return edge1->ymin < edge2->ymin ? -1 : 1;
+    if (edge1->bres.minor_axis != edge2->bres.minor_axis)
+        return edge1->bres.minor_axis < edge2->bres.minor_axis ? -1 : 1;
+    return edge1 < edge2 ? 1 : -1;
+}
+
+/***********************************************************************
+ *     REGION_InsertEdgesInET
+ *
+ *     Sort the edges and insert them in the edge table, creating
+ *     one ScanLineList per scanline at which edges are entered.
+ */
+static BOOL REGION_InsertEdgesInET( EdgeTable *ET, EdgeTableEntry *pETEs, unsigned int count,
+                                    ScanLineListBlock *SLLBlock )
 {
-    struct list *ptr;
-    ScanLineList *pSLL, *pPrevSLL;
+    EdgeTableEntry **sorted;
+    ScanLineList *pSLL = &ET->scanlines;
     ScanLineListBlock *tmpSLLBlock;
+    unsigned int i;
+    int iSLLBlock = 0;
 
-    /*
-     * find the right bucket to put the edge into
-     */
-    pPrevSLL = &ET->scanlines;
-    pSLL = pPrevSLL->next;
-    while (pSLL && (pSLL->scanline < scanline))
-    {
-        pPrevSLL = pSLL;
-        pSLL = pSLL->next;
-    }
+    if (!(sorted = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*sorted) ))) return FALSE;
+    for (i = 0; i < count; i++) sorted[i] = &pETEs[i];
+    qsort( sorted, count, sizeof(*sorted), compare_edges );
 
-    /*
-     * reassign pSLL (pointer to ScanLineList) if necessary
-     */
-    if ((!pSLL) || (pSLL->scanline > scanline))
+    for (i = 0; i < count; i++)
     {
-        if (*iSLLBlock > SLLSPERBLOCK-1)
+        if (pSLL == &ET->scanlines || pSLL->scanline != sorted[i]->ymin)
         {
-            tmpSLLBlock = HeapAlloc( GetProcessHeap(), 0, sizeof(ScanLineListBlock));
-	    if(!tmpSLLBlock)
-	    {
-	        WARN("Can't alloc SLLB\n");
-		return;
-	    }
-            (*SLLBlock)->next = tmpSLLBlock;
-            tmpSLLBlock->next = NULL;
-            *SLLBlock = tmpSLLBlock;
-            *iSLLBlock = 0;
+            if (iSLLBlock > SLLSPERBLOCK-1)
+            {
+                if (!(tmpSLLBlock = HeapAlloc( GetProcessHeap(), 0, sizeof(ScanLineListBlock) )))
+                {
+                    WARN("Can't alloc SLLB\n");
+                    HeapFree( GetProcessHeap(), 0, sorted );
+                    return FALSE;
+                }
+                SLLBlock->next = tmpSLLBlock;
+                tmpSLLBlock->next = NULL;
+                SLLBlock = tmpSLLBlock;
+                iSLLBlock = 0;
+            }
+            pSLL->next = &SLLBlock->SLLs[iSLLBlock++];
+            pSLL = pSLL->next;
+            pSLL->next = NULL;
+            pSLL->scanline = sorted[i]->ymin;
+            list_init( &pSLL->edgelist );
         }
-        pSLL = &((*SLLBlock)->SLLs[(*iSLLBlock)++]);
-
-        pSLL->next = pPrevSLL->next;
-        list_init( &pSLL->edgelist );
-        pPrevSLL->next = pSLL;
+        list_add_tail( &pSLL->edgelist, &sorted[i]->entry );
     }
-    pSLL->scanline = scanline;
-
-    /*
-     * now insert the edge in the right bucket
-     */
-    LIST_FOR_EACH( ptr, &pSLL->edgelist )
-    {
-        struct edge_table_entry *entry = LIST_ENTRY( ptr, struct edge_table_entry, entry );
-        if (entry->bres.minor_axis >= ETE->bres.minor_axis) break;
-    }
-    list_add_before( ptr, &ETE->entry );
+    HeapFree( GetProcessHeap(), 0, sorted );
+    return TRUE;
 }
 
 /***********************************************************************
@@ -2393,8 +2463,8 @@ static unsigned int REGION_CreateEdgeTable(const INT *Count, INT nbpolygons,
 {
     const POINT *top, *bottom;
     const POINT *PrevPt, *CurrPt, *EndPt;
+    EdgeTableEntry *pETE = pETEs;
     INT poly, count;
-    int iSLLBlock = 0;
     unsigned int dy, total = 0;
 
     /*
@@ -2430,12 +2500,12 @@ static unsigned int REGION_CreateEdgeTable(const INT *Count, INT nbpolygons,
 	    if (PrevPt->y > CurrPt->y)
 	    {
 	        bottom = PrevPt, top = CurrPt;
-		pETEs->ClockWise = 0;
+		pETE->ClockWise = 0;
 	    }
 	    else
 	    {
 	        bottom = CurrPt, top = PrevPt;
-		pETEs->ClockWise = 1;
+		pETE->ClockWise = 1;
 	    }
 
         /*
@@ -2443,25 +2513,25 @@ static unsigned int REGION_CreateEdgeTable(const INT *Count, INT nbpolygons,
          */
 	    if (bottom->y == top->y) continue;
             if (clip_rect && (top->y >= clip_rect->bottom || bottom->y <= clip_rect->top)) continue;
-            pETEs->ymax = bottom->y-1; /* -1 so we don't get last scanline */
+            pETE->ymin = top->y;
+            pETE->ymax = bottom->y-1; /* -1 so we don't get last scanline */
 
             /*
              *  initialize integer edge algorithm
              */
             dy = bottom->y - top->y;
-            bres_init_polygon(dy, top->x, bottom->x, &pETEs->bres);
+            bres_init_polygon(dy, top->x, bottom->x, &pETE->bres);
 
             if (clip_rect) dy = min( bottom->y, clip_rect->bottom ) - max( top->y, clip_rect->top );
             if (total + dy < total) return 0;  /* overflow */
             total += dy;
 
-            REGION_InsertEdgeInET(ET, pETEs, top->y, &pSLLBlock, &iSLLBlock);
-
             if (top->y    < ET->ymin) ET->ymin = top->y;
             if (bottom->y > ET->ymax) ET->ymax = bottom->y;
-            pETEs++;
+            pETE++;
 	}
     }
+    if (total && !REGION_InsertEdgesInET( ET, pETEs, pETE - pETEs, pSLLBlock )) return 0;
     return total;
 }
 
@@ -2476,17 +2546,20 @@ static unsigned int REGION_CreateEdgeTable(const INT *Count, INT nbpolygons,
 static void REGION_loadAET( struct list *AET, struct list *ETEs )
 {
     struct edge_table_entry *ptr, *next, *entry;
-    struct list *active;
+    struct list *active = list_head( AET );
 
+    /* the new edges are sorted too, so resume the search from the last inserted one */
     LIST_FOR_EACH_ENTRY_SAFE( ptr, next, ETEs, struct edge_table_entry, entry )
     {
-        LIST_FOR_EACH( active, AET )
+        for ( ; active && active != AET; active = active->next)
         {
             entry = LIST_ENTRY( active, struct edge_table_entry, entry );
             if (entry->bres.minor_axis >= ptr->bres.minor_axis) break;
         }
+        if (!active) active = AET;
         list_remove( &ptr->entry );
         list_add_before( active, &ptr->entry );
+        active = &ptr->entry;
     }
 }
 
@@ -2551,16 +2624,20 @@ static inline BOOL next_scanline( struct list *AET, int y )
         }
         else bres_incr_polygon( &active->bres );
     }
+    /* insertion sort, the edges only move a little from one scanline to the next */
     LIST_FOR_EACH_ENTRY_SAFE( active, next, AET, struct edge_table_entry, entry )
     {
-        LIST_FOR_EACH_ENTRY( insert, AET, struct edge_table_entry, entry )
+        struct list *prev = active->entry.prev;
+
+        while (prev != AET)
         {
-            if (insert == active) break;
-            if (insert->bres.minor_axis > active->bres.minor_axis) break;
+            insert = LIST_ENTRY( prev, struct edge_table_entry, entry );
+            if (insert->bres.minor_axis <= active->bres.minor_axis) break;
+            prev = prev->prev;
         }
-        if (insert == active) continue;
+        if (prev == active->entry.prev) continue;
         list_remove( &active->entry );
-        list_add_before( &insert->entry, &active->entry );
+        list_add_after( prev, &active->entry );
         changed = TRUE;
     }
     return changed;
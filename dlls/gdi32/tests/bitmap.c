@@ -3480,6 +3480,71 @@ static INT check_StretchDIBits_stretch( HDC hdcDst, UINT32 *dstBuffer, UINT32 *s
     return ret;
 }
 
+static void test_StretchBlt_large(void)
+{
+    BITMAPINFO bmi;
+    HBITMAP bmp_src, bmp_dst;
+    HDC hdc_src, hdc_dst;
+    DWORD *src_bits, *dst_bits;
+    BYTE *bits24;
+    int x, y, errors, ret;
+
+    /* large enough for the DIB engine to split the work in bands */
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 300;
+    bmi.bmiHeader.biHeight = -300;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    bmp_src = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    bmi.bmiHeader.biWidth = 1200;
+    bmi.bmiHeader.biHeight = -900;
+    bmp_dst = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    ok( bmp_src && bmp_dst, "failed to create bitmaps\n" );
+    hdc_src = CreateCompatibleDC( 0 );
+    hdc_dst = CreateCompatibleDC( 0 );
+    SelectObject( hdc_src, bmp_src );
+    SelectObject( hdc_dst, bmp_dst );
+
+    for (y = 0; y < 300; y++)
+        for (x = 0; x < 300; x++)
+            src_bits[y * 300 + x] = (y << 12) | x;
+
+    SetStretchBltMode( hdc_dst, COLORONCOLOR );
+    ret = StretchBlt( hdc_dst, 0, 0, 1200, 900, hdc_src, 0, 0, 300, 300, SRCCOPY );
+    ok( ret, "StretchBlt failed\n" );
+
+    for (y = errors = 0; y < 900; y++)
+        for (x = 0; x < 1200; x++)
+            if (dst_bits[y * 1200 + x] != src_bits[(y / 3) * 300 + x / 4] && errors++ < 5)
+                ok( 0, "%d,%d: got %08x expected %08x\n", x, y,
+                    dst_bits[y * 1200 + x], src_bits[(y / 3) * 300 + x / 4] );
+    ok( !errors, "got %d wrong pixels\n", errors );
+
+    /* format conversion of the whole bitmap */
+    bits24 = HeapAlloc( GetProcessHeap(), 0, 1200 * 3 * 900 );
+    bmi.bmiHeader.biBitCount = 24;
+    ret = GetDIBits( hdc_dst, bmp_dst, 0, 900, bits24, &bmi, DIB_RGB_COLORS );
+    ok( ret == 900, "GetDIBits returned %d\n", ret );
+
+    for (y = errors = 0; y < 900; y++)
+        for (x = 0; x < 1200; x++)
+        {
+            const BYTE *ptr = bits24 + y * 1200 * 3 + x * 3;
+            DWORD val = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16);
+            if (val != dst_bits[y * 1200 + x] && errors++ < 5)
+                ok( 0, "%d,%d: got %06x expected %06x\n", x, y, val, dst_bits[y * 1200 + x] );
+        }
+    ok( !errors, "got %d wrong pixels\n", errors );
+
+    HeapFree( GetProcessHeap(), 0, bits24 );
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+}
+
 static void test_StretchDIBits(void)
 {
     HBITMAP bmpDst;
@@ -3846,6 +3911,113 @@ static void test_GdiAlphaBlend(void)
     HeapFree(GetProcessHeap(), 0, bmi);
 }
 
+static BYTE blend_channel( BYTE dst, BYTE src, DWORD alpha )
+{
+    return (src * alpha + dst * (255 - alpha) + 127) / 255;
+}
+
+static DWORD blend_pixel( DWORD dst, DWORD src, BLENDFUNCTION blend )
+{
+    DWORD i, res = 0, alpha = blend.SourceConstantAlpha;
+    BYTE s, src_alpha;
+
+    if (!(blend.AlphaFormat & AC_SRC_ALPHA))
+    {
+        for (i = 0; i < 32; i += 8)
+            res |= blend_channel( dst >> i, src >> i, alpha ) << i;
+        return res;
+    }
+    src_alpha = ((src >> 24) * alpha + 127) / 255;
+    for (i = 0; i < 32; i += 8)
+    {
+        s = ((BYTE)(src >> i) * alpha + 127) / 255;
+        res |= (s + ((BYTE)(dst >> i) * (255 - src_alpha) + 127) / 255) << i;
+    }
+    return res;
+}
+
+static void test_GdiAlphaBlend_pixels(void)
+{
+    static const BYTE alphas[] = { 255, 128, 1 };
+    static const BYTE formats[] = { 0, AC_SRC_ALPHA };
+    static const int starts[] = { 0, 1, 3 };
+    BITMAPINFO bmi;
+    HBITMAP bmp_src, bmp_dst;
+    HDC hdc_src, hdc_dst;
+    DWORD *src_bits, *dst_bits, expect[16];
+    BLENDFUNCTION blend;
+    int i, j, k, x, y, width, premul;
+    BOOL ret;
+
+    if (!pGdiAlphaBlend)
+    {
+        win_skip("GdiAlphaBlend() is not implemented\n");
+        return;
+    }
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 16;
+    bmi.bmiHeader.biHeight = -8;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    bmp_src = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    bmp_dst = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    hdc_src = CreateCompatibleDC( 0 );
+    hdc_dst = CreateCompatibleDC( 0 );
+    SelectObject( hdc_src, bmp_src );
+    SelectObject( hdc_dst, bmp_dst );
+
+    blend.BlendOp = AC_SRC_OVER;
+    blend.BlendFlags = 0;
+
+    /* various offsets and widths to cover both the vectorized groups and the remaining pixels,
+     * with premultiplied sources and with colors larger than alpha that overflow into the next channel */
+    for (premul = 0; premul < 2; premul++)
+    for (i = 0; i < ARRAY_SIZE(alphas); i++)
+    for (j = 0; j < ARRAY_SIZE(formats); j++)
+    for (k = 0; k < ARRAY_SIZE(starts); k++)
+    for (width = 1; starts[k] + width <= 16; width++)
+    {
+        blend.SourceConstantAlpha = alphas[i];
+        blend.AlphaFormat = formats[j];
+
+        for (y = 0; y < 8; y++)
+            for (x = 0; x < 16; x++)
+            {
+                BYTE a = (x * 37 + y * 61) & 0xff;
+                if (premul)
+                    src_bits[y * 16 + x] = a << 24 | ((x * 13 + y) * a / 255) << 16 |
+                                           ((x * 7 + y * 29) % 256 * a / 255) << 8 | (y * 31 * a / 255 & 0xff);
+                else
+                    src_bits[y * 16 + x] = (a / 2) << 24 | (0xff - x * 3) << 16 |
+                                           ((x * 7 + y * 29) & 0xff) << 8 | (0x80 + y * 15);
+                dst_bits[y * 16 + x] = 0x01020304 * (x + 16 * y + 1) ^ (x & 1 ? 0xffffffff : 0);
+            }
+
+        for (y = 0; y < 8; y++)
+        {
+            for (x = 0; x < 16; x++)
+                expect[x] = x >= starts[k] && x < starts[k] + width ?
+                            blend_pixel( dst_bits[y * 16 + x], src_bits[y * 16 + x], blend ) :
+                            dst_bits[y * 16 + x];
+            ret = pGdiAlphaBlend( hdc_dst, starts[k], y, width, 1, hdc_src, starts[k], y, width, 1, blend );
+            ok( ret, "GdiAlphaBlend failed err %u\n", GetLastError() );
+            for (x = 0; x < 16; x++)
+                if (dst_bits[y * 16 + x] != expect[x]) break;
+            ok( x == 16, "premul %d alpha %u format %u start %d width %d pixel %d,%d: got %08x expected %08x\n",
+                premul, alphas[i], formats[j], starts[k], width, x, y,
+                x < 16 ? dst_bits[y * 16 + x] : 0, x < 16 ? expect[x] : 0 );
+        }
+    }
+
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+}
+
 static void test_GdiGradientFill(void)
 {
     HDC hdc;
@@ -5978,8 +6150,10 @@ START_TEST(bitmap)
     test_CreateBitmap();
     test_BitBlt();
     test_StretchBlt();
+    test_StretchBlt_large();
     test_StretchDIBits();
     test_GdiAlphaBlend();
+    test_GdiAlphaBlend_pixels();
     test_GdiGradientFill();
     test_32bit_ddb();
     test_bitmapinfoheadersize();
@@ -534,6 +534,162 @@ static void test_window_dc_clipping(void)
 }
 
 
+#define check_region_rects(rgn, rects, count) check_region_rects_(__LINE__, rgn, rects, count)
+static void check_region_rects_(unsigned int line, HRGN rgn, const RECT *rects, unsigned int count)
+{
+    char buffer[sizeof(RGNDATAHEADER) + 64 * sizeof(RECT)];
+    RGNDATA *data = (RGNDATA *)buffer;
+    const RECT *rect = (const RECT *)data->Buffer;
+    unsigned int i;
+    DWORD size;
+
+    size = GetRegionData(rgn, sizeof(buffer), data);
+    ok_(__FILE__, line)(size == sizeof(RGNDATAHEADER) + count * sizeof(RECT), "got size %u\n", size);
+    ok_(__FILE__, line)(data->rdh.nCount == count, "got %u rects, expected %u\n", data->rdh.nCount, count);
+    for (i = 0; i < min(count, data->rdh.nCount); i++)
+        ok_(__FILE__, line)(EqualRect(&rect[i], &rects[i]), "%u: got %s, expected %s\n", i,
+                            wine_dbgstr_rect(&rect[i]), wine_dbgstr_rect(&rects[i]));
+}
+
+static void test_CombineRgn(void)
+{
+    static const RECT and_rects[] = { { 50, 50, 100, 100 } };
+    static const RECT diff_rects[] = { { 100, 50, 150, 100 }, { 50, 100, 150, 150 } };
+    static const RECT stripes_rects[] =
+    {
+        {  0,  0,  2, 10 }, {  4,  0,  6, 10 }, {  8,  0, 10, 10 }, { 12,  0, 14, 10 },
+        { 16,  0, 18, 10 }, { 20,  0, 22, 10 }, { 24,  0, 26, 10 }, { 28,  0, 30, 10 },
+        { 32,  0, 34, 10 }, { 36,  0, 38, 10 }, { 40,  0, 42, 10 }, { 44,  0, 46, 10 },
+        {  4, 10,  6, 20 }, { 12, 10, 14, 20 }, { 20, 10, 22, 20 }, { 28, 10, 30, 20 },
+        { 36, 10, 38, 20 }, { 44, 10, 46, 20 },
+    };
+    static const RECT stripes_and_rects[] =
+    {
+        { 12,  5, 14, 10 }, { 16,  5, 18, 10 }, { 20,  5, 22, 10 }, { 24,  5, 26, 10 },
+        { 28,  5, 30, 10 },
+        { 12, 10, 14, 15 }, { 20, 10, 22, 15 }, { 28, 10, 30, 15 },
+    };
+    static const RECT stripes_diff_rects[] =
+    {
+        {  0,  0,  2,  5 }, {  4,  0,  6,  5 }, {  8,  0, 10,  5 }, { 12,  0, 14,  5 },
+        { 16,  0, 18,  5 }, { 20,  0, 22,  5 }, { 24,  0, 26,  5 }, { 28,  0, 30,  5 },
+        { 32,  0, 34,  5 }, { 36,  0, 38,  5 }, { 40,  0, 42,  5 }, { 44,  0, 46,  5 },
+        {  0,  5,  2, 10 }, {  4,  5,  6, 10 }, {  8,  5, 10, 10 }, { 32,  5, 34, 10 },
+        { 36,  5, 38, 10 }, { 40,  5, 42, 10 }, { 44,  5, 46, 10 },
+        {  4, 10,  6, 15 }, { 36, 10, 38, 15 }, { 44, 10, 46, 15 },
+        {  4, 15,  6, 20 }, { 12, 15, 14, 20 }, { 20, 15, 22, 20 }, { 28, 15, 30, 20 },
+        { 36, 15, 38, 20 }, { 44, 15, 46, 20 },
+    };
+    HRGN rect1, rect2, stripes, dst;
+    INT ret, i;
+
+    rect1 = CreateRectRgn(0, 0, 100, 100);
+    rect2 = CreateRectRgn(50, 50, 150, 150);
+    dst = CreateRectRgn(0, 0, 0, 0);
+
+    ret = CombineRgn(dst, rect1, rect2, RGN_AND);
+    ok(ret == SIMPLEREGION, "got %d\n", ret);
+    check_region_rects(dst, and_rects, ARRAY_SIZE(and_rects));
+
+    ret = CombineRgn(dst, rect2, rect1, RGN_DIFF);
+    ok(ret == COMPLEXREGION, "got %d\n", ret);
+    check_region_rects(dst, diff_rects, ARRAY_SIZE(diff_rects));
+
+    ret = CombineRgn(dst, rect1, rect1, RGN_DIFF);
+    ok(ret == NULLREGION, "got %d\n", ret);
+    check_region_rects(dst, NULL, 0);
+
+    /* more rectangles than the inline storage holds */
+    stripes = CreateRectRgn(0, 0, 0, 0);
+    for (i = 0; i < 12; i++)
+    {
+        SetRectRgn(rect2, i * 4, 0, i * 4 + 2, (i & 1) ? 20 : 10);
+        CombineRgn(stripes, stripes, rect2, RGN_OR);
+    }
+    check_region_rects(stripes, stripes_rects, ARRAY_SIZE(stripes_rects));
+
+    SetRectRgn(rect1, -10, -10, 1000, 1000);
+    ret = CombineRgn(dst, rect1, stripes, RGN_AND);
+    ok(ret == COMPLEXREGION, "got %d\n", ret);
+    check_region_rects(dst, stripes_rects, ARRAY_SIZE(stripes_rects));
+    ret = CombineRgn(dst, stripes, rect1, RGN_DIFF);
+    ok(ret == NULLREGION, "got %d\n", ret);
+    check_region_rects(dst, NULL, 0);
+
+    /* the destination already holds a complex region */
+    SetRectRgn(rect1, 10, 5, 30, 15);
+    CombineRgn(dst, stripes, 0, RGN_COPY);
+    ret = CombineRgn(dst, stripes, rect1, RGN_AND);
+    ok(ret == COMPLEXREGION, "got %d\n", ret);
+    check_region_rects(dst, stripes_and_rects, ARRAY_SIZE(stripes_and_rects));
+
+    ret = CombineRgn(dst, stripes, rect1, RGN_DIFF);
+    ok(ret == COMPLEXREGION, "got %d\n", ret);
+    check_region_rects(dst, stripes_diff_rects, ARRAY_SIZE(stripes_diff_rects));
+
+    /* the destination is also a source */
+    ret = CombineRgn(stripes, stripes, rect1, RGN_AND);
+    ok(ret == COMPLEXREGION, "got %d\n", ret);
+    check_region_rects(stripes, stripes_and_rects, ARRAY_SIZE(stripes_and_rects));
+
+    DeleteObject(rect1);
+    DeleteObject(rect2);
+    DeleteObject(stripes);
+    DeleteObject(dst);
+}
+
+static void test_CreatePolyPolygonRgn(void)
+{
+    static const POINT squares[] = {{0, 0}, {10, 0}, {10, 10}, {0, 10}, {0, 0}, {10, 0}, {10, 10}, {0, 10}};
+    static const INT square_counts[] = {4, 4};
+    POINT comb[2 + 4 * 100];
+    RGNDATA *data;
+    DWORD size;
+    HRGN hrgn;
+    RECT rc;
+    int i, n = 0, ret;
+
+    /* a comb with 100 teeth at the top */
+    comb[n].x = 0; comb[n++].y = 30;
+    for (i = 0; i < 100; i++)
+    {
+        comb[n].x = 8 * i;     comb[n++].y = 0;
+        comb[n].x = 8 * i + 4; comb[n++].y = 0;
+        comb[n].x = 8 * i + 4; comb[n++].y = 20;
+        comb[n].x = 8 * i + 8; comb[n++].y = 20;
+    }
+    comb[n].x = 800; comb[n++].y = 30;
+
+    hrgn = CreatePolygonRgn(comb, n, ALTERNATE);
+    ok(hrgn != 0, "CreatePolygonRgn failed\n");
+    ret = GetRgnBox(hrgn, &rc);
+    ok(ret == COMPLEXREGION, "wrong region type %d\n", ret);
+    ok(rc.left == 0 && rc.top == 0 && rc.right == 800 && rc.bottom == 30, "wrong box %s\n", wine_dbgstr_rect(&rc));
+    size = GetRegionData(hrgn, 0, NULL);
+    data = HeapAlloc(GetProcessHeap(), 0, size);
+    GetRegionData(hrgn, size, data);
+    ok(data->rdh.nCount == 101, "got %u rects\n", data->rdh.nCount);
+    HeapFree(GetProcessHeap(), 0, data);
+    for (i = 0; i < 100; i++)
+    {
+        ok(PtInRegion(hrgn, 8 * i + 2, 10), "%d: tooth not in region\n", i);
+        ok(!PtInRegion(hrgn, 8 * i + 6, 10), "%d: gap in region\n", i);
+        ok(PtInRegion(hrgn, 8 * i + 6, 25), "%d: spine not in region\n", i);
+    }
+    DeleteObject(hrgn);
+
+    hrgn = CreatePolyPolygonRgn(squares, square_counts, 2, ALTERNATE);
+    ret = GetRgnBox(hrgn, &rc);
+    ok(ret == NULLREGION, "wrong region type %d\n", ret);
+    DeleteObject(hrgn);
+
+    hrgn = CreatePolyPolygonRgn(squares, square_counts, 2, WINDING);
+    ret = GetRgnBox(hrgn, &rc);
+    ok(ret == SIMPLEREGION, "wrong region type %d\n", ret);
+    ok(rc.left == 0 && rc.top == 0 && rc.right == 10 && rc.bottom == 10, "wrong box %s\n", wine_dbgstr_rect(&rc));
+    DeleteObject(hrgn);
+}
+
 START_TEST(clipping)
 {
     test_GetRandomRgn();
@@ -541,4 +697,6 @@ START_TEST(clipping)
     test_GetClipRgn();
     test_memory_dc_clipping();
     test_window_dc_clipping();
+    test_CombineRgn();
+    test_CreatePolyPolygonRgn();
 }
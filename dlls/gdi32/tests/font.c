@@ -28,6 +28,7 @@
 #include "wingdi.h"
 #include "winuser.h"
 #include "winnls.h"
+#include "winreg.h"
 
 #include "wine/heap.h"
 #include "wine/test.h"
@@ -4512,6 +4513,102 @@ static void test_GetTextFace(void)
     ReleaseDC(NULL, dc);
 }
 
+static void draw_test_text(HDC hdc, DWORD *bits, DWORD *copy)
+{
+    static const char test_str[] = "Wine glyph cache";
+    int i;
+
+    for (i = 0; i < 128 * 32; i++) bits[i] = 0xffffff;
+    ok(TextOutA(hdc, 2, 2, test_str, strlen(test_str)), "TextOut failed\n");
+    GdiFlush();
+    memcpy(copy, bits, 128 * 32 * sizeof(*bits));
+}
+
+static void test_glyph_cache(void)
+{
+    BITMAPINFO bmi;
+    LOGFONTA lf;
+    HBITMAP bmp, old_bmp;
+    HFONT hfont, hfont2, old_hfont;
+    DWORD *bits, ref[128 * 32], cur[128 * 32];
+    int i, set;
+    HDC hdc;
+
+    if (!is_truetype_font_installed("Arial"))
+    {
+        skip("Arial is not installed\n");
+        return;
+    }
+
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 128;
+    bmi.bmiHeader.biHeight = -32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    hdc = CreateCompatibleDC(0);
+    bmp = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0);
+    ok(bmp != NULL, "CreateDIBSection failed\n");
+    old_bmp = SelectObject(hdc, bmp);
+    SetBkMode(hdc, TRANSPARENT);
+    SetTextColor(hdc, RGB(0, 0, 0));
+
+    memset(&lf, 0, sizeof(lf));
+    lstrcpyA(lf.lfFaceName, "Arial");
+    lf.lfHeight = -16;
+    lf.lfQuality = NONANTIALIASED_QUALITY;
+    hfont = CreateFontIndirectA(&lf);
+    lf.lfHeight = -20;
+    lf.lfWeight = FW_BOLD;
+    hfont2 = CreateFontIndirectA(&lf);
+    old_hfont = SelectObject(hdc, hfont);
+
+    draw_test_text(hdc, bits, ref);
+    for (i = set = 0; i < ARRAY_SIZE(ref); i++)
+    {
+        if (ref[i] == 0xffffff) continue;
+        ok(ref[i] == 0, "%d: got %08x\n", i, ref[i]);
+        set++;
+    }
+    ok(set > 0, "no pixels drawn\n");
+
+    /* the second time the glyphs come from the cache */
+    draw_test_text(hdc, bits, cur);
+    ok(!memcmp(ref, cur, sizeof(ref)), "text differs when drawn again\n");
+
+    /* cached glyphs must be drawn with the current text color */
+    SetTextColor(hdc, RGB(255, 0, 0));
+    draw_test_text(hdc, bits, cur);
+    for (i = 0; i < ARRAY_SIZE(ref); i++)
+        if (cur[i] != (ref[i] ? 0xffffff : 0xff0000)) break;
+    ok(i == ARRAY_SIZE(ref), "%d: got %08x for %08x\n", i,
+       i < ARRAY_SIZE(ref) ? cur[i] : 0, i < ARRAY_SIZE(ref) ? ref[i] : 0);
+    SetTextColor(hdc, RGB(0, 0, 0));
+
+    /* text output ignores the binary raster operation */
+    SetROP2(hdc, R2_XORPEN);
+    draw_test_text(hdc, bits, cur);
+    ok(!memcmp(ref, cur, sizeof(ref)), "text differs with R2_XORPEN\n");
+    SetROP2(hdc, R2_COPYPEN);
+
+    /* a different font must not reuse the glyphs of the previous one */
+    SelectObject(hdc, hfont2);
+    draw_test_text(hdc, bits, cur);
+    ok(memcmp(ref, cur, sizeof(ref)), "text with a different font is identical\n");
+
+    SelectObject(hdc, hfont);
+    draw_test_text(hdc, bits, cur);
+    ok(!memcmp(ref, cur, sizeof(ref)), "text differs after selecting the font again\n");
+
+    SelectObject(hdc, old_hfont);
+    SelectObject(hdc, old_bmp);
+    DeleteObject(hfont);
+    DeleteObject(hfont2);
+    DeleteObject(bmp);
+    DeleteDC(hdc);
+}
+
 static void test_orientation(void)
 {
     static const char test_str[11] = "Test String";
@@ -4541,6 +4638,90 @@ static void test_orientation(void)
     DeleteDC(hdc);
 }
 
+static void test_font_cache(void)
+{
+    static const char test_str[] = "Test String";
+    static const WCHAR linked_str[] = {'a',0x3042,0x4e00,0xac00,'b'};
+    static const char *linked_faces[] = { "Arial", "Times New Roman", "Courier New" };
+    TEXTMETRICA (*tm)[300];
+    SIZE (*size)[300], linked_size[2][ARRAY_SIZE(linked_faces)][20];
+    HDC hdc;
+    LOGFONTA lf;
+    HFONT hfont, old_hfont;
+    int pass, i, j;
+
+    if (!is_truetype_font_installed("Arial"))
+    {
+        skip("Arial is not installed\n");
+        return;
+    }
+
+    /* cycle through more fonts than the unused font cache keeps, metrics must not change */
+    tm = heap_alloc(2 * sizeof(*tm));
+    size = heap_alloc(2 * sizeof(*size));
+    hdc = CreateCompatibleDC(0);
+    memset(&lf, 0, sizeof(lf));
+    lstrcpyA(lf.lfFaceName, "Arial");
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (i = 0; i < ARRAY_SIZE(tm[0]); i++)
+        {
+            lf.lfHeight = -(8 + i / 2);
+            lf.lfWeight = (i & 1) ? FW_BOLD : FW_NORMAL;
+            hfont = CreateFontIndirectA(&lf);
+            ok(hfont != 0, "CreateFontIndirect failed\n");
+            old_hfont = SelectObject(hdc, hfont);
+            ok(GetTextMetricsA(hdc, &tm[pass][i]), "GetTextMetrics failed\n");
+            ok(GetTextExtentPoint32A(hdc, test_str, strlen(test_str), &size[pass][i]),
+               "GetTextExtentPoint32 failed\n");
+            SelectObject(hdc, old_hfont);
+            DeleteObject(hfont);
+        }
+    }
+    for (i = 0; i < ARRAY_SIZE(tm[0]); i++)
+    {
+        ok(!memcmp(&tm[0][i], &tm[1][i], sizeof(tm[0][i])), "%d: text metrics differ\n", i);
+        ok(size[0][i].cx == size[1][i].cx && size[0][i].cy == size[1][i].cy,
+           "%d: got %dx%d, expected %dx%d\n", i, size[1][i].cx, size[1][i].cy,
+           size[0][i].cx, size[0][i].cy);
+    }
+
+    /* characters missing from the base fonts come from linked fonts, which may be shared
+     * between the base fonts; the result must not depend on which base font created them */
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (i = 0; i < ARRAY_SIZE(linked_size[0][0]); i++)
+        {
+            for (j = 0; j < ARRAY_SIZE(linked_faces); j++)
+            {
+                /* the second pass creates the base fonts in the reverse order */
+                int face = pass ? ARRAY_SIZE(linked_faces) - 1 - j : j;
+
+                memset(&lf, 0, sizeof(lf));
+                lstrcpyA(lf.lfFaceName, linked_faces[face]);
+                lf.lfHeight = -(10 + i);
+                hfont = CreateFontIndirectA(&lf);
+                old_hfont = SelectObject(hdc, hfont);
+                ok(GetTextExtentPoint32W(hdc, linked_str, ARRAY_SIZE(linked_str), &linked_size[pass][face][i]),
+                   "GetTextExtentPoint32 failed\n");
+                SelectObject(hdc, old_hfont);
+                DeleteObject(hfont);
+            }
+        }
+    }
+    for (j = 0; j < ARRAY_SIZE(linked_faces); j++)
+        for (i = 0; i < ARRAY_SIZE(linked_size[0][0]); i++)
+            ok(linked_size[0][j][i].cx == linked_size[1][j][i].cx &&
+               linked_size[0][j][i].cy == linked_size[1][j][i].cy,
+               "%s %d: got %dx%d, expected %dx%d\n", linked_faces[j], i,
+               linked_size[1][j][i].cx, linked_size[1][j][i].cy,
+               linked_size[0][j][i].cx, linked_size[0][j][i].cy);
+
+    DeleteDC(hdc);
+    heap_free(tm);
+    heap_free(size);
+}
+
 static void test_oemcharset(void)
 {
     HDC hdc;
@@ -5184,6 +5365,123 @@ todo_wine
     ReleaseDC(NULL, hdc);
 }
 
+static INT CALLBACK count_families_proc(const LOGFONTA *lf, const TEXTMETRICA *tm, DWORD type, LPARAM lparam)
+{
+    (*(DWORD *)lparam)++;
+    return 1;
+}
+
+/* runs in a child process, so that the font list is loaded again */
+static void test_font_catalogue_child(void)
+{
+    DWORD count = 0;
+    HDC hdc = GetDC(0);
+
+    EnumFontFamiliesA(hdc, NULL, count_families_proc, (LPARAM)&count);
+    ReleaseDC(0, hdc);
+    ExitProcess(count);
+}
+
+static DWORD run_font_catalogue_child(HKEY hkey, const BYTE *data, DWORD size)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char path_name[MAX_PATH], **argv;
+    DWORD ret, code = 0;
+
+    ret = RegSetValueExA(hkey, "Catalogue", 0, REG_BINARY, data, size);
+    ok(!ret, "RegSetValueEx failed %u\n", ret);
+
+    winetest_get_mainargs(&argv);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    sprintf(path_name, "%s font font_catalogue", argv[0]);
+    ok(CreateProcessA(NULL, path_name, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info),
+       "CreateProcess failed.\n");
+    ret = WaitForSingleObject(info.hProcess, 30000);
+    ok(ret == WAIT_OBJECT_0, "wait failed %u\n", ret);
+    GetExitCodeProcess(info.hProcess, &code);
+    CloseHandle(info.hProcess);
+    CloseHandle(info.hThread);
+    return code;
+}
+
+static void test_font_catalogue(void)
+{
+    HKEY hkey;
+    BYTE *data, *corrupt;
+    DWORD ret, type, size, count, expect;
+
+    /* Wine specific: the font cache keeps a binary copy of the font list */
+    if (RegOpenKeyExA(HKEY_CURRENT_USER, "Software\\Wine\\Fonts\\Cache", 0, KEY_ALL_ACCESS, &hkey))
+    {
+        skip("no font cache key\n");
+        return;
+    }
+    size = 0;
+    if (RegQueryValueExA(hkey, "Catalogue", NULL, &type, NULL, &size))
+    {
+        skip("no font catalogue\n");
+        RegCloseKey(hkey);
+        return;
+    }
+    ok(type == REG_BINARY, "got type %u\n", type);
+    ok(size >= 3 * sizeof(DWORD), "got size %u\n", size);
+    ok(!(size % sizeof(DWORD)), "got size %u\n", size);
+    if (size < 3 * sizeof(DWORD))
+    {
+        RegCloseKey(hkey);
+        return;
+    }
+
+    data = heap_alloc(size);
+    corrupt = heap_alloc(size + 16);
+    ret = RegQueryValueExA(hkey, "Catalogue", NULL, NULL, data, &size);
+    ok(!ret, "RegQueryValueEx failed %u\n", ret);
+    ok(((DWORD *)data)[0] == 0x54414346, "got magic %08x\n", ((DWORD *)data)[0]);
+    ok(((DWORD *)data)[1] == 1, "got version %u\n", ((DWORD *)data)[1]);
+    ok(((DWORD *)data)[2] > 0, "got %u families\n", ((DWORD *)data)[2]);
+
+    expect = run_font_catalogue_child(hkey, data, size);
+    ok(expect > 0, "got %u families\n", expect);
+
+    /* invalid catalogues are ignored and the font list is loaded from the cache keys */
+    count = run_font_catalogue_child(hkey, data, (size / 2) & ~3);
+    ok(count == expect, "truncated: got %u families, expected %u\n", count, expect);
+
+    count = run_font_catalogue_child(hkey, data, 2 * sizeof(DWORD));
+    ok(count == expect, "header only: got %u families, expected %u\n", count, expect);
+
+    memcpy(corrupt, data, size);
+    ((DWORD *)corrupt)[1] = 2;
+    count = run_font_catalogue_child(hkey, corrupt, size);
+    ok(count == expect, "bad version: got %u families, expected %u\n", count, expect);
+
+    memcpy(corrupt, data, size);
+    ((DWORD *)corrupt)[2] = 0xffffffff;
+    count = run_font_catalogue_child(hkey, corrupt, size);
+    ok(count == expect, "bad family count: got %u families, expected %u\n", count, expect);
+
+    if (size >= 4 * sizeof(DWORD))
+    {
+        memcpy(corrupt, data, size);
+        ((DWORD *)corrupt)[3] = 0x7fffffff;  /* length of the first family name */
+        count = run_font_catalogue_child(hkey, corrupt, size);
+        ok(count == expect, "bad string length: got %u families, expected %u\n", count, expect);
+    }
+
+    memcpy(corrupt, data, size);
+    memset(corrupt + size, 0xcc, 16);
+    count = run_font_catalogue_child(hkey, corrupt, size + 16);
+    ok(count == expect, "trailing data: got %u families, expected %u\n", count, expect);
+
+    ret = RegSetValueExA(hkey, "Catalogue", 0, REG_BINARY, data, size);
+    ok(!ret, "RegSetValueEx failed %u\n", ret);
+    heap_free(corrupt);
+    heap_free(data);
+    RegCloseKey(hkey);
+}
+
 static void test_AddFontMemResource(void)
 {
     char ttf_name[MAX_PATH];
@@ -7017,9 +7315,12 @@ START_TEST(font)
     {
         if (!strcmp(argv[2], "AddFontMemResource"))
             test_AddFontMemResource();
+        else if (!strcmp(argv[2], "font_catalogue"))
+            test_font_catalogue_child();
         return;
     }
 
+    test_font_catalogue();
     test_stock_fonts();
     test_logfont();
     test_bitmap_font();
@@ -7036,7 +7337,9 @@ START_TEST(font)
     test_GdiGetCodePage();
     test_GetFontUnicodeRanges();
     test_nonexistent_font();
+    test_glyph_cache();
     test_orientation();
+    test_font_cache();
     test_height_selection();
     test_EnumFonts();
     test_EnumFonts_subst();
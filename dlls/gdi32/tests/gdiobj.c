@@ -194,6 +194,68 @@ static void test_thread_objects(void)
     CloseHandle(hgdiobj_event.ready_event);
 }
 
+static DWORD WINAPI draw_thread_proc(void *param)
+{
+    BITMAPINFO info;
+    HBITMAP bitmap;
+    HDC hdc;
+    DWORD *bits;
+    int i, failures = 0;
+
+    memset(&info, 0, sizeof(info));
+    info.bmiHeader.biSize = sizeof(info.bmiHeader);
+    info.bmiHeader.biWidth = 16;
+    info.bmiHeader.biHeight = -16;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+
+    for (i = 0; i < 200; i++)
+    {
+        hdc = CreateCompatibleDC(0);
+        bitmap = CreateDIBSection(hdc, &info, DIB_RGB_COLORS, (void **)&bits, NULL, 0);
+        SelectObject(hdc, bitmap);
+        SelectObject(hdc, GetStockObject(NULL_PEN));
+        SelectObject(hdc, GetStockObject(WHITE_BRUSH));
+        Rectangle(hdc, 0, 0, 17, 17);
+        PatBlt(hdc, 4, 4, 8, 8, BLACKNESS);
+        if (bits[0] != 0xffffff || bits[8 * 16 + 8] != 0) failures++;
+        DeleteDC(hdc);
+        DeleteObject(bitmap);
+    }
+    return failures;
+}
+
+static void test_thread_drawing(void)
+{
+    HANDLE threads[4];
+    DWORD ret, i, tid;
+    HDC hdc;
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+    {
+        threads[i] = CreateThread(NULL, 0, draw_thread_proc, NULL, 0, &tid);
+        ok(threads[i] != NULL, "CreateThread error %u\n", GetLastError());
+    }
+
+    /* look up DC handles while the other threads keep freeing and reusing them */
+    for (i = 0; i < 200; i++)
+    {
+        hdc = CreateCompatibleDC(0);
+        ok(GetObjectType(hdc) == OBJ_MEMDC, "wrong type %u\n", GetObjectType(hdc));
+        DeleteDC(hdc);
+        ret = GetObjectType(hdc);
+        ok(!ret || ret == OBJ_MEMDC, "wrong type %u\n", ret);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+    {
+        WaitForSingleObject(threads[i], INFINITE);
+        GetExitCodeThread(threads[i], &ret);
+        ok(!ret, "thread %u: %u drawing failures\n", i, ret);
+        CloseHandle(threads[i]);
+    }
+}
+
 static void test_GetCurrentObject(void)
 {
     DWORD type;
@@ -366,6 +428,7 @@ START_TEST(gdiobj)
 {
     test_gdi_objects();
     test_thread_objects();
+    test_thread_drawing();
     test_GetCurrentObject();
     test_region();
     test_handles_on_win64();
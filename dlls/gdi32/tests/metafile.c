@@ -4281,6 +4281,66 @@ static void test_emf_WorldTransform(void)
     }
 }
 
+static void test_emf_clipped_playback(void)
+{
+    static const POINT left[] = {{0, 0}, {10, 0}, {10, 10}, {0, 10}};
+    static const POINT right[] = {{90, 0}, {100, 0}, {100, 10}, {90, 10}};
+    BITMAPINFO info;
+    HBITMAP bitmap, old_bitmap;
+    HDC hdc, hdc_emf;
+    HENHMETAFILE hemf;
+    ENHMETAHEADER header;
+    DWORD *bits;
+    RECT rect;
+    HRGN rgn;
+    BOOL ret;
+    int i;
+
+    hdc_emf = CreateEnhMetaFileA(0, NULL, NULL, NULL);
+    ok(hdc_emf != 0, "CreateEnhMetaFileA error %d\n", GetLastError());
+    SelectObject(hdc_emf, GetStockObject(BLACK_BRUSH));
+    Polygon(hdc_emf, left, ARRAY_SIZE(left));
+    Polygon(hdc_emf, right, ARRAY_SIZE(right));
+    hemf = CloseEnhMetaFile(hdc_emf);
+    ok(hemf != 0, "CloseEnhMetaFile error %d\n", GetLastError());
+    GetEnhMetaFileHeader(hemf, sizeof(header), &header);
+    SetRect(&rect, header.rclBounds.left, header.rclBounds.top,
+            header.rclBounds.right + 1, header.rclBounds.bottom + 1);
+
+    memset(&info, 0, sizeof(info));
+    info.bmiHeader.biSize = sizeof(info.bmiHeader);
+    info.bmiHeader.biWidth = 100;
+    info.bmiHeader.biHeight = -20;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    hdc = CreateCompatibleDC(0);
+    bitmap = CreateDIBSection(hdc, &info, DIB_RGB_COLORS, (void **)&bits, NULL, 0);
+    old_bitmap = SelectObject(hdc, bitmap);
+
+    /* play twice, the record index is reused */
+    for (i = 0; i < 2; i++)
+    {
+        memset(bits, 0xff, 100 * 20 * sizeof(*bits));
+        rgn = CreateRectRgn(0, 0, 50, 20);
+        SelectClipRgn(hdc, i ? NULL : rgn);
+        DeleteObject(rgn);
+
+        ret = PlayEnhMetaFile(hdc, hemf, &rect);
+        ok(ret, "%d: PlayEnhMetaFile failed\n", i);
+        ok((bits[5 * 100 + 5] & 0xffffff) == 0, "%d: got %08x\n", i, bits[5 * 100 + 5]);
+        if (i)
+            ok((bits[5 * 100 + 95] & 0xffffff) == 0, "%d: got %08x\n", i, bits[5 * 100 + 95]);
+        else
+            ok(bits[5 * 100 + 95] == 0xffffffff, "%d: got %08x\n", i, bits[5 * 100 + 95]);
+        ok(bits[15 * 100 + 50] == 0xffffffff, "%d: got %08x\n", i, bits[15 * 100 + 50]);
+    }
+
+    SelectObject(hdc, old_bitmap);
+    DeleteObject(bitmap);
+    DeleteDC(hdc);
+    DeleteEnhMetaFile(hemf);
+}
+
 START_TEST(metafile)
 {
     init_function_pointers();
@@ -4298,6 +4358,7 @@ START_TEST(metafile)
     test_emf_PolyPolyline();
     test_emf_GradientFill();
     test_emf_WorldTransform();
+    test_emf_clipped_playback();
 
     /* For win-format metafiles (mfdrv) */
     test_mf_SaveDC();
@@ -1146,6 +1146,69 @@ error:
     pNtClose(dir);
 }
 
+static void test_directory_many_names(void)
+{
+    static const unsigned int count = 2000;
+    NTSTATUS status;
+    UNICODE_STRING str;
+    OBJECT_ATTRIBUTES attr;
+    HANDLE dir, h, *events;
+    char name[32];
+    unsigned int i;
+
+    pRtlCreateUnicodeStringFromAsciiz(&str, "\\BaseNamedObjects\\om.c-many");
+    InitializeObjectAttributes(&attr, &str, 0, 0, NULL);
+    status = pNtCreateDirectoryObject( &dir, GENERIC_ALL, &attr );
+    ok( status == STATUS_SUCCESS, "Failed to create directory %08x\n", status );
+    pRtlFreeUnicodeString(&str);
+
+    events = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*events) );
+    for (i = 0; i < count; i++)
+    {
+        sprintf( name, "event%u", i );
+        pRtlCreateUnicodeStringFromAsciiz(&str, name);
+        InitializeObjectAttributes(&attr, &str, 0, dir, NULL);
+        status = pNtCreateEvent( &events[i], GENERIC_ALL, &attr, FALSE, FALSE );
+        ok( status == STATUS_SUCCESS, "%u: NtCreateEvent failed %08x\n", i, status );
+        pRtlFreeUnicodeString(&str);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        sprintf( name, "EVENT%u", i );
+        pRtlCreateUnicodeStringFromAsciiz(&str, name);
+        InitializeObjectAttributes(&attr, &str, OBJ_CASE_INSENSITIVE, dir, NULL);
+        status = pNtOpenEvent( &h, GENERIC_ALL, &attr );
+        ok( status == STATUS_SUCCESS, "%u: NtOpenEvent failed %08x\n", i, status );
+        if (!status) pNtClose( h );
+        attr.Attributes = 0;
+        status = pNtOpenEvent( &h, GENERIC_ALL, &attr );
+        ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "%u: NtOpenEvent got %08x\n", i, status );
+        pRtlFreeUnicodeString(&str);
+    }
+
+    for (i = 0; i < count; i += 2) pNtClose( events[i] );
+
+    for (i = 0; i < count; i++)
+    {
+        sprintf( name, "event%u", i );
+        pRtlCreateUnicodeStringFromAsciiz(&str, name);
+        InitializeObjectAttributes(&attr, &str, 0, dir, NULL);
+        status = pNtOpenEvent( &h, GENERIC_ALL, &attr );
+        if (i % 2)
+        {
+            ok( status == STATUS_SUCCESS, "%u: NtOpenEvent failed %08x\n", i, status );
+            if (!status) pNtClose( h );
+        }
+        else ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "%u: NtOpenEvent got %08x\n", i, status );
+        pRtlFreeUnicodeString(&str);
+    }
+
+    for (i = 1; i < count; i += 2) pNtClose( events[i] );
+    HeapFree( GetProcessHeap(), 0, events );
+    pNtClose( dir );
+}
+
 static void test_symboliclink(void)
 {
     NTSTATUS status;
@@ -2204,6 +2267,7 @@ START_TEST(om)
     test_name_collisions();
     test_name_limits();
     test_directory();
+    test_directory_many_names();
     test_symboliclink();
     test_query_object();
     test_type_mismatch();
@@ -365,8 +365,11 @@ HWND WINAPI GetFocus(void)
  */
 HWND WINAPI GetForegroundWindow(void)
 {
+    desktop_shm_t state;
     HWND ret = 0;
 
+    if (get_desktop_shared_state( &state )) return wine_server_ptr_handle( state.foreground );
+
     SERVER_START_REQ( get_thread_input )
     {
         req->tid = 0;
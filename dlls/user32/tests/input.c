@@ -2507,6 +2507,96 @@ static void test_GetKeyState(void)
     CloseHandle(semaphores[1]);
 }
 
+struct desktop_state
+{
+    POINT cursor;
+    HWND foreground;
+    SHORT key;
+};
+
+static DWORD WINAPI get_desktop_state_thread(void *arg)
+{
+    struct desktop_state *state = arg;
+
+    GetCursorPos(&state->cursor);
+    state->foreground = GetForegroundWindow();
+    state->key = GetAsyncKeyState('X');
+    return 0;
+}
+
+static void check_desktop_state_from_thread(const POINT *cursor, HWND foreground, BOOL key_down)
+{
+    struct desktop_state state;
+    HANDLE thread;
+    DWORD result;
+
+    thread = CreateThread(NULL, 0, get_desktop_state_thread, &state, 0, NULL);
+    ok(thread != NULL, "CreateThread failed %u\n", GetLastError());
+    result = WaitForSingleObject(thread, 1000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    CloseHandle(thread);
+
+    ok(state.cursor.x == cursor->x && state.cursor.y == cursor->y,
+       "got cursor (%d,%d), expected (%d,%d)\n", state.cursor.x, state.cursor.y, cursor->x, cursor->y);
+    ok(state.foreground == foreground, "got foreground %p, expected %p\n", state.foreground, foreground);
+    ok(!(state.key & 0x8000) == !key_down, "got key state %#x\n", state.key);
+}
+
+static void test_desktop_state(void)
+{
+    GUITHREADINFO info;
+    POINT pt, expect;
+    HWND hwnd, foreground;
+    SHORT state;
+    BOOL ret;
+
+    hwnd = CreateWindowA("static", "Title", WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+                         10, 10, 200, 200, NULL, NULL, NULL, NULL);
+    ok(hwnd != NULL, "CreateWindowA failed %u\n", GetLastError());
+    SetForegroundWindow(hwnd);
+    SetFocus(hwnd);
+    empty_message_queue();
+
+    /* the cursor position set through the server is visible right away */
+    expect.x = 57;
+    expect.y = 63;
+    ret = SetCursorPos(expect.x, expect.y);
+    ok(ret, "SetCursorPos failed %u\n", GetLastError());
+    ret = GetCursorPos(&pt);
+    ok(ret, "GetCursorPos failed %u\n", GetLastError());
+    ok(pt.x == expect.x && pt.y == expect.y, "got cursor (%d,%d), expected (%d,%d)\n",
+       pt.x, pt.y, expect.x, expect.y);
+
+    /* the foreground window matches the active window of its thread */
+    foreground = GetForegroundWindow();
+    ok(foreground != NULL, "no foreground window\n");
+    memset(&info, 0, sizeof(info));
+    info.cbSize = sizeof(info);
+    ret = GetGUIThreadInfo(GetWindowThreadProcessId(foreground, NULL), &info);
+    ok(ret, "GetGUIThreadInfo failed %u\n", GetLastError());
+    ok(info.hwndActive == foreground, "got active window %p, foreground %p\n", info.hwndActive, foreground);
+
+    check_desktop_state_from_thread(&expect, foreground, FALSE);
+
+    /* the first call after a key press reports the key from the server,
+     * the following ones may be answered from the cached state */
+    keybd_event('X', 0, 0, 0);
+    empty_message_queue();
+    state = GetAsyncKeyState('X');
+    ok(state & 0x8000, "expected the key to be down, got %#x\n", state);
+    state = GetAsyncKeyState('X');
+    ok(state & 0x8000, "expected the key to be down, got %#x\n", state);
+    check_desktop_state_from_thread(&expect, foreground, TRUE);
+
+    keybd_event('X', 0, KEYEVENTF_KEYUP, 0);
+    empty_message_queue();
+    state = GetAsyncKeyState('X');
+    ok(!(state & 0x8000), "expected the key to be up, got %#x\n", state);
+    check_desktop_state_from_thread(&expect, foreground, FALSE);
+
+    DestroyWindow(hwnd);
+}
+
 static void test_OemKeyScan(void)
 {
     DWORD ret, expect, vkey, scan;
@@ -2696,6 +2786,7 @@ START_TEST(input)
     test_key_names();
     test_attach_input();
     test_GetKeyState();
+    test_desktop_state();
     test_OemKeyScan();
 
     if(pGetMouseMovePointsEx)
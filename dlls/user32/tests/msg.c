@@ -12411,6 +12411,78 @@ static void test_PeekMessage3(void)
     flush_events();
 }
 
+static void test_PeekMessage_ranges(void)
+{
+    static const UINT messages[] = { WM_USER + 1, WM_APP + 2, WM_NULL, 0xc123, WM_USER + 3, WM_APP + 4 };
+    HWND hwnd[2];
+    unsigned int i;
+    BOOL ret;
+    MSG msg;
+
+    for (i = 0; i < ARRAY_SIZE(hwnd); i++)
+    {
+        hwnd[i] = CreateWindowA("TestWindowClass", "PeekMessage ranges", WS_OVERLAPPEDWINDOW,
+                                10, 10, 100, 100, NULL, NULL, NULL, NULL);
+        ok(hwnd[i] != NULL, "expected hwnd != NULL\n");
+    }
+    flush_events();
+
+    /* posted messages from different ranges are retrieved in posting order */
+    for (i = 0; i < ARRAY_SIZE(messages); i++)
+        PostMessageA(hwnd[i % 2], messages[i], i, 0);
+
+    for (i = 0; i < ARRAY_SIZE(messages); i++)
+    {
+        ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+        ok(ret, "%u: PeekMessage failed\n", i);
+        ok(msg.message == messages[i], "%u: got message %04x\n", i, msg.message);
+        ok(msg.hwnd == hwnd[i % 2], "%u: got hwnd %p\n", i, msg.hwnd);
+        ok(msg.wParam == i, "%u: got wparam %lu\n", i, msg.wParam);
+    }
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_NOREMOVE);
+    ok(!ret, "expected PeekMessage to return FALSE, got %u\n", ret);
+
+    /* filtered retrieval across range boundaries */
+    for (i = 0; i < ARRAY_SIZE(messages); i++)
+        PostMessageA(hwnd[i % 2], messages[i], i, 0);
+
+    ret = PeekMessageA(&msg, NULL, WM_USER + 2, WM_APP + 3, PM_REMOVE);
+    ok(ret && msg.message == WM_APP + 2, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, NULL, WM_USER + 2, WM_APP + 3, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 3, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, NULL, WM_USER + 2, WM_APP + 3, PM_REMOVE);
+    ok(!ret, "expected PeekMessage to return FALSE, got %u\n", ret);
+    ret = PeekMessageA(&msg, NULL, 0xc000, 0xffff, PM_REMOVE);
+    ok(ret && msg.message == 0xc123, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, hwnd[1], WM_USER, 0xffff, PM_REMOVE);
+    ok(ret && msg.message == WM_APP + 4, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, hwnd[0], 0, 0, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 1, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, hwnd[0], 0, 0, PM_REMOVE);
+    ok(ret && msg.message == WM_NULL, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_NOREMOVE);
+    ok(!ret, "expected PeekMessage to return FALSE, got %u\n", ret);
+
+    /* a larger number of messages interleaved over several windows */
+    for (i = 0; i < 1000; i++)
+        PostMessageA(hwnd[i % 2], WM_USER + (i % 7), i, 0);
+    for (i = 1; i < 1000; i += 2)
+    {
+        ret = PeekMessageA(&msg, hwnd[1], 0, 0, PM_REMOVE);
+        ok(ret && msg.wParam == i, "%u: got wparam %lu\n", i, msg.wParam);
+    }
+    for (i = 0; i < 1000; i += 2)
+    {
+        ret = PeekMessageA(&msg, NULL, WM_USER, WM_USER + 6, PM_REMOVE);
+        ok(ret && msg.wParam == i, "%u: got wparam %lu\n", i, msg.wParam);
+    }
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_NOREMOVE);
+    ok(!ret, "expected PeekMessage to return FALSE, got %u\n", ret);
+
+    for (i = 0; i < ARRAY_SIZE(hwnd); i++) DestroyWindow(hwnd[i]);
+    flush_events();
+}
+
 static INT_PTR CALLBACK wm_quit_dlg_proc(HWND hwnd, UINT message, WPARAM wp, LPARAM lp)
 {
     struct recvd_message msg;
@@ -17612,6 +17684,7 @@ START_TEST(msg)
     test_PeekMessage();
     test_PeekMessage2();
     test_PeekMessage3();
+    test_PeekMessage_ranges();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
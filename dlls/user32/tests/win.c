@@ -2958,6 +2958,99 @@ static void test_vis_rgn( HWND hwnd )
     ReleaseDC( hwnd, hdc );
 }
 
+#define check_vis_rgn(hwnd, flags, ref, rect, clip, count) \
+        check_vis_rgn_(__LINE__, hwnd, flags, ref, rect, clip, count)
+static void check_vis_rgn_( int line, HWND hwnd, DWORD flags, HWND ref, const RECT *rect,
+                            const RECT *clip, unsigned int count )
+{
+    HRGN hrgn = CreateRectRgn( 0, 0, 0, 0 ), expect, tmp;
+    RECT r, rgn_rect, expect_rect;
+    unsigned int i;
+    HDC hdc;
+
+    /* rectangles are relative to the client area of ref, SYSRGN is in screen coordinates */
+    r = *rect;
+    MapWindowPoints( ref, 0, (POINT *)&r, 2 );
+    expect = CreateRectRgnIndirect( &r );
+    for (i = 0; i < count; i++)
+    {
+        r = clip[i];
+        MapWindowPoints( ref, 0, (POINT *)&r, 2 );
+        tmp = CreateRectRgnIndirect( &r );
+        CombineRgn( expect, expect, tmp, RGN_DIFF );
+        DeleteObject( tmp );
+    }
+
+    hdc = GetDCEx( hwnd, 0, DCX_CACHE | flags );
+    ok_(__FILE__, line)( GetRandomRgn( hdc, hrgn, SYSRGN ) == 1, "GetRandomRgn failed\n" );
+    GetRgnBox( hrgn, &rgn_rect );
+    GetRgnBox( expect, &expect_rect );
+    ok_(__FILE__, line)( EqualRgn( hrgn, expect ), "got region box %s, expected %s\n",
+                         wine_dbgstr_rect( &rgn_rect ), wine_dbgstr_rect( &expect_rect ));
+    ReleaseDC( hwnd, hdc );
+    DeleteObject( expect );
+    DeleteObject( hrgn );
+}
+
+static void test_sibling_vis_rgn(void)
+{
+    static const RECT parent_rect = { 0, 0, 300, 300 };
+    RECT rect_a = { 10, 10, 110, 110 };
+    RECT rects[3];
+    HWND parent, hwnd_a, hwnd_b, hwnd_c;
+
+    parent = CreateWindowExA( WS_EX_TOPMOST, "MainWindowClass", NULL, WS_POPUP | WS_VISIBLE,
+                              100, 100, 300, 300, 0, 0, GetModuleHandleA(NULL), NULL );
+    ok( parent != 0, "CreateWindowEx failed\n" );
+    hwnd_a = CreateWindowExA( 0, "MainWindowClass", NULL, WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS,
+                              10, 10, 100, 100, parent, 0, GetModuleHandleA(NULL), NULL );
+    ok( hwnd_a != 0, "CreateWindowEx failed\n" );
+    hwnd_b = CreateWindowExA( 0, "MainWindowClass", NULL, WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS,
+                              60, 60, 100, 100, parent, 0, GetModuleHandleA(NULL), NULL );
+    ok( hwnd_b != 0, "CreateWindowEx failed\n" );
+    hwnd_c = CreateWindowExA( 0, "MainWindowClass", NULL, WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS,
+                              200, 200, 50, 50, parent, 0, GetModuleHandleA(NULL), NULL );
+    ok( hwnd_c != 0, "CreateWindowEx failed\n" );
+    SetWindowPos( hwnd_b, HWND_TOP, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+    SetWindowPos( hwnd_a, HWND_BOTTOM, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+
+    SetRect( &rects[0], 60, 60, 160, 160 );
+    SetRect( &rects[1], 200, 200, 250, 250 );
+    rects[2] = rect_a;
+    check_vis_rgn( hwnd_a, DCX_CLIPSIBLINGS, parent, &rect_a, rects, 1 );
+    check_vis_rgn( parent, DCX_CLIPCHILDREN, parent, &parent_rect, rects, 3 );
+
+    /* moving a sibling that doesn't overlap */
+    SetWindowPos( hwnd_c, 0, 220, 10, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE );
+    SetRect( &rects[1], 220, 10, 270, 60 );
+    check_vis_rgn( hwnd_a, DCX_CLIPSIBLINGS, parent, &rect_a, rects, 1 );
+    check_vis_rgn( parent, DCX_CLIPCHILDREN, parent, &parent_rect, rects, 3 );
+
+    /* moving the overlapping sibling away */
+    SetWindowPos( hwnd_b, 0, 120, 120, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE );
+    SetRect( &rects[0], 120, 120, 220, 220 );
+    check_vis_rgn( hwnd_a, DCX_CLIPSIBLINGS, parent, &rect_a, NULL, 0 );
+    check_vis_rgn( parent, DCX_CLIPCHILDREN, parent, &parent_rect, rects, 3 );
+
+    /* and back over it */
+    SetWindowPos( hwnd_b, 0, 60, 60, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE );
+    SetRect( &rects[0], 60, 60, 160, 160 );
+    check_vis_rgn( hwnd_a, DCX_CLIPSIBLINGS, parent, &rect_a, rects, 1 );
+
+    /* moving it below */
+    SetWindowPos( hwnd_b, HWND_BOTTOM, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+    check_vis_rgn( hwnd_a, DCX_CLIPSIBLINGS, parent, &rect_a, NULL, 0 );
+    SetWindowPos( hwnd_b, HWND_TOP, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+    check_vis_rgn( hwnd_a, DCX_CLIPSIBLINGS, parent, &rect_a, rects, 1 );
+
+    /* hiding it */
+    ShowWindow( hwnd_b, SW_HIDE );
+    check_vis_rgn( hwnd_a, DCX_CLIPSIBLINGS, parent, &rect_a, NULL, 0 );
+    check_vis_rgn( parent, DCX_CLIPCHILDREN, parent, &parent_rect, rects + 1, 2 );
+
+    DestroyWindow( parent );
+}
+
 static LRESULT WINAPI set_focus_on_activate_proc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
 {
     if (msg == WM_ACTIVATE && LOWORD(wp) == WA_ACTIVE)
@@ -10843,6 +10936,7 @@ START_TEST(win)
     test_scroll();
     test_IsWindowUnicode();
     test_vis_rgn(hwndMain);
+    test_sibling_vis_rgn();
 
     test_AdjustWindowRect();
     test_window_styles();
@@ -429,11 +429,82 @@ BOOL WINAPI SetThreadDesktop( HDESK handle )
         thread_info->top_window = 0;
         thread_info->msg_window = 0;
         if (key_state_info) key_state_info->time = 0;
+        release_desktop_shared_memory();
     }
     return ret;
 }
 
 
+/* map the shared memory of the thread desktop on first use */
+static const desktop_shm_t *get_desktop_shared_memory(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    HANDLE handle = 0;
+
+    if (thread_info->desktop_shm) return thread_info->desktop_shm;
+
+    SERVER_START_REQ( get_desktop_shared_memory )
+    {
+        if (!wine_server_call( req )) handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+    if (!handle) return NULL;
+
+    thread_info->desktop_shm = MapViewOfFile( handle, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( handle );
+    return thread_info->desktop_shm;
+}
+
+
+/* full memory barrier; the shared section is mapped read-only, so the
+ * interlocked operation has to target a local variable */
+static inline void shared_memory_barrier(void)
+{
+    LONG dummy = 0;
+    InterlockedCompareExchange( &dummy, 0, 0 );
+}
+
+
+/***********************************************************************
+ *              get_desktop_shared_state
+ *
+ * Retrieve a consistent copy of the desktop state shared with the server,
+ * without a server round trip.
+ */
+BOOL get_desktop_shared_state( desktop_shm_t *state )
+{
+    const volatile desktop_shm_t *shared = get_desktop_shared_memory();
+    unsigned int seq;
+
+    if (!shared) return FALSE;
+
+    do
+    {
+        /* the server is in the middle of an update while the sequence number is odd */
+        while ((seq = shared->seq) & 1) Sleep( 0 );
+        shared_memory_barrier();
+        *state = *(const desktop_shm_t *)shared;
+        shared_memory_barrier();
+    } while (shared->seq != seq);
+
+    state->seq = seq;
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *              release_desktop_shared_memory
+ */
+void release_desktop_shared_memory(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+
+    if (!thread_info->desktop_shm) return;
+    UnmapViewOfFile( (void *)thread_info->desktop_shm );
+    thread_info->desktop_shm = NULL;
+}
+
+
 /******************************************************************************
  *              EnumDesktopsA   (USER32.@)
  */
@@ -35,6 +35,27 @@ WINE_DEFAULT_DEBUG_CHANNEL(d3d);
 #define WINED3D_BUFFER_DISCARD      0x08    /* A DISCARD lock has occurred since the last preload. */
 #define WINED3D_BUFFER_APPLESYNC    0x10    /* Using sync as in GL_APPLE_flush_buffer_range. */
 
+#define WINED3D_BUFFER_STREAM_SLOT_COUNT 4
+/* The ring renames whole buffer objects, so bound the storage it may use.
+ * Larger buffers are left to the driver's own orphaning. */
+#define WINED3D_BUFFER_STREAM_RING_SIZE  (4 * 1024 * 1024)
+
+struct wined3d_buffer_stream_slot
+{
+    GLuint buffer_object;
+    BYTE *map_ptr;
+    struct wined3d_fence *fence;    /* Issued when the slot is retired. */
+};
+
+/* Dynamic buffers are backed by a small ring of persistently mapped buffer
+ * objects. A DISCARD map moves to the next slot the GPU is done with,
+ * instead of reallocating storage or synchronising on every map. */
+struct wined3d_buffer_gl_stream
+{
+    struct wined3d_buffer_stream_slot slots[WINED3D_BUFFER_STREAM_SLOT_COUNT];
+    unsigned int slot_count, slot_limit, current;
+};
+
 #define VB_MAXDECLCHANGES     100     /* After that number of decl changes we stop converting */
 #define VB_RESETDECLCHANGE    1000    /* Reset the decl changecount after that number of draws */
 #define VB_MAXFULLCONVERSIONS 5       /* Number of full conversions before we stop converting */
@@ -139,14 +160,10 @@ static void wined3d_buffer_gl_bind(struct wined3d_buffer_gl *buffer_gl, struct w
 }
 
 /* Context activation is done by the caller. */
-static void wined3d_buffer_gl_destroy_buffer_object(struct wined3d_buffer_gl *buffer_gl,
+static void wined3d_buffer_gl_invalidate_bindings(struct wined3d_buffer_gl *buffer_gl,
         struct wined3d_context *context)
 {
     struct wined3d_resource *resource = &buffer_gl->b.resource;
-    const struct wined3d_gl_info *gl_info = context->gl_info;
-
-    if (!buffer_gl->buffer_object)
-        return;
 
     /* The stream source state handler might have read the memory of the
      * vertex buffer already and got the memory in the vbo which is not
@@ -181,6 +198,168 @@ static void wined3d_buffer_gl_destroy_buffer_object(struct wined3d_buffer_gl *bu
             }
         }
     }
+}
+
+/* Context activation is done by the caller. */
+static BOOL wined3d_buffer_gl_stream_create_slot(struct wined3d_buffer_gl *buffer_gl,
+        struct wined3d_context *context, struct wined3d_buffer_stream_slot *slot)
+{
+    const GLbitfield map_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+
+    GL_EXTCALL(glGenBuffers(1, &slot->buffer_object));
+    context_bind_bo(context, buffer_gl->buffer_type_hint, slot->buffer_object);
+    GL_EXTCALL(glBufferStorage(buffer_gl->buffer_type_hint, buffer_gl->b.resource.size,
+            NULL, map_flags | GL_DYNAMIC_STORAGE_BIT));
+    slot->map_ptr = GL_EXTCALL(glMapBufferRange(buffer_gl->buffer_type_hint,
+            0, buffer_gl->b.resource.size, map_flags));
+    checkGLcall("create persistent buffer");
+    slot->fence = NULL;
+
+    if (!slot->map_ptr || ((DWORD_PTR)slot->map_ptr & (RESOURCE_ALIGNMENT - 1)))
+    {
+        WARN("Failed to map persistent buffer, pointer %p.\n", slot->map_ptr);
+        GL_EXTCALL(glDeleteBuffers(1, &slot->buffer_object));
+        checkGLcall("glDeleteBuffers");
+        return FALSE;
+    }
+
+    TRACE("Created persistent buffer object %u for buffer %p.\n", slot->buffer_object, buffer_gl);
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static BOOL wined3d_buffer_gl_stream_create(struct wined3d_buffer_gl *buffer_gl, struct wined3d_context *context)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    struct wined3d_resource *resource = &buffer_gl->b.resource;
+    struct wined3d_buffer_gl_stream *stream;
+
+    /* Views and stream output need a fixed buffer object. The mapping is
+     * write-only, so buffers the application may read back are excluded as
+     * well. */
+    if (!(resource->usage & WINED3DUSAGE_DYNAMIC) || !gl_info->supported[ARB_BUFFER_STORAGE]
+            || !gl_info->supported[ARB_SYNC] || buffer_gl->b.flags & WINED3D_BUFFER_PIN_SYSMEM
+            || resource->bind_flags & ~(WINED3D_BIND_VERTEX_BUFFER | WINED3D_BIND_INDEX_BUFFER
+            | WINED3D_BIND_CONSTANT_BUFFER)
+            || (resource->access & WINED3D_RESOURCE_ACCESS_MAP_R && !(resource->usage & WINED3DUSAGE_WRITEONLY))
+            || resource->size > WINED3D_BUFFER_STREAM_RING_SIZE / 2)
+        return FALSE;
+
+    if (!(stream = heap_alloc_zero(sizeof(*stream))))
+        return FALSE;
+
+    if (!wined3d_buffer_gl_stream_create_slot(buffer_gl, context, &stream->slots[0]))
+    {
+        heap_free(stream);
+        return FALSE;
+    }
+    stream->slot_count = 1;
+    stream->slot_limit = min(ARRAY_SIZE(stream->slots), WINED3D_BUFFER_STREAM_RING_SIZE / resource->size);
+
+    buffer_gl->stream = stream;
+    buffer_gl->buffer_object = stream->slots[0].buffer_object;
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static void wined3d_buffer_gl_stream_destroy(struct wined3d_buffer_gl *buffer_gl, struct wined3d_context *context)
+{
+    struct wined3d_buffer_gl_stream *stream = buffer_gl->stream;
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    unsigned int i;
+
+    for (i = 0; i < stream->slot_count; ++i)
+    {
+        if (stream->slots[i].buffer_object != buffer_gl->buffer_object)
+            GL_EXTCALL(glDeleteBuffers(1, &stream->slots[i].buffer_object));
+        if (stream->slots[i].fence)
+            wined3d_fence_destroy(stream->slots[i].fence);
+    }
+    checkGLcall("glDeleteBuffers");
+
+    heap_free(stream);
+    buffer_gl->stream = NULL;
+}
+
+/* Context activation is done by the caller. */
+static void wined3d_buffer_gl_stream_wait(struct wined3d_buffer_gl *buffer_gl)
+{
+    struct wined3d_buffer_stream_slot *slot = &buffer_gl->stream->slots[buffer_gl->stream->current];
+    struct wined3d_device *device = buffer_gl->b.resource.device;
+
+    if (!slot->fence && FAILED(wined3d_fence_create(device, &slot->fence)))
+    {
+        ERR("Failed to create fence.\n");
+        return;
+    }
+
+    TRACE("Synchronizing buffer %p.\n", buffer_gl);
+    wined3d_fence_issue(slot->fence, device);
+    wined3d_fence_wait(slot->fence, device);
+}
+
+/* Context activation is done by the caller. */
+static void wined3d_buffer_gl_stream_discard(struct wined3d_buffer_gl *buffer_gl, struct wined3d_context *context)
+{
+    struct wined3d_buffer_gl_stream *stream = buffer_gl->stream;
+    struct wined3d_device *device = buffer_gl->b.resource.device;
+    struct wined3d_buffer_stream_slot *slot;
+    unsigned int i, idx;
+
+    /* Everything using the current slot has been submitted, so a fence
+     * issued now tells us when the slot can be written again. */
+    slot = &stream->slots[stream->current];
+    if (!slot->fence && FAILED(wined3d_fence_create(device, &slot->fence)))
+    {
+        ERR("Failed to create fence.\n");
+        wined3d_buffer_gl_stream_wait(buffer_gl);
+        return;
+    }
+    wined3d_fence_issue(slot->fence, device);
+
+    for (i = 1; i < stream->slot_count; ++i)
+    {
+        idx = (stream->current + i) % stream->slot_count;
+        if (wined3d_fence_test(stream->slots[idx].fence, device, WINED3DGETDATA_FLUSH) == WINED3D_FENCE_OK)
+            break;
+    }
+
+    if (i == stream->slot_count)
+    {
+        if (stream->slot_count < stream->slot_limit
+                && wined3d_buffer_gl_stream_create_slot(buffer_gl, context, &stream->slots[stream->slot_count]))
+        {
+            idx = stream->slot_count++;
+        }
+        else
+        {
+            /* Wait for the least recently retired slot. */
+            TRACE("Waiting for a free slot for buffer %p.\n", buffer_gl);
+            idx = (stream->current + 1) % stream->slot_count;
+            wined3d_fence_wait(stream->slots[idx].fence, device);
+        }
+    }
+
+    TRACE("Buffer %p switching from slot %u to slot %u.\n", buffer_gl, stream->current, idx);
+    stream->current = idx;
+    buffer_gl->buffer_object = stream->slots[idx].buffer_object;
+    wined3d_buffer_gl_invalidate_bindings(buffer_gl, context);
+}
+
+/* Context activation is done by the caller. */
+static void wined3d_buffer_gl_destroy_buffer_object(struct wined3d_buffer_gl *buffer_gl,
+        struct wined3d_context *context)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+
+    if (!buffer_gl->buffer_object)
+        return;
+
+    wined3d_buffer_gl_invalidate_bindings(buffer_gl, context);
+
+    if (buffer_gl->stream)
+        wined3d_buffer_gl_stream_destroy(buffer_gl, context);
 
     GL_EXTCALL(glDeleteBuffers(1, &buffer_gl->buffer_object));
     checkGLcall("glDeleteBuffers");
@@ -217,6 +396,13 @@ static BOOL wined3d_buffer_gl_create_buffer_object(struct wined3d_buffer_gl *buf
      * to be verified to check if the rhw and color values are in the correct
      * format. */
 
+    if (wined3d_buffer_gl_stream_create(buffer_gl, context))
+    {
+        buffer_gl->buffer_object_usage = GL_STREAM_DRAW_ARB;
+        buffer_invalidate_bo_range(&buffer_gl->b, 0, 0);
+        return TRUE;
+    }
+
     GL_EXTCALL(glGenBuffers(1, &buffer_gl->buffer_object));
     error = gl_info->gl_ops.gl.p_glGetError();
     if (!buffer_gl->buffer_object || error != GL_NO_ERROR)
@@ -489,9 +675,9 @@ static BOOL buffer_find_decl(struct wined3d_buffer *This, const struct wined3d_s
     return ret;
 }
 
-static inline unsigned int fixup_d3dcolor(DWORD *dst_color)
+static void fixup_d3dcolor(BYTE *data, unsigned int stride, unsigned int count)
 {
-    DWORD src_color = *dst_color;
+    DWORD *dst_color, src_color;
 
     /* Color conversion like in draw_primitive_immediate_mode(). Watch out for
      * endianness. If we want this to work on big-endian machines as well we
@@ -502,27 +688,36 @@ static inline unsigned int fixup_d3dcolor(DWORD *dst_color)
      * 0x0000ff00: Green mask
      * 0x000000ff: Red mask
      */
-    *dst_color = 0;
-    *dst_color |= (src_color & 0xff00ff00u);         /* Alpha Green */
-    *dst_color |= (src_color & 0x00ff0000u) >> 16;   /* Red */
-    *dst_color |= (src_color & 0x000000ffu) << 16;   /* Blue */
-
-    return sizeof(*dst_color);
+    while (count--)
+    {
+        dst_color = (DWORD *)data;
+        src_color = *dst_color;
+        *dst_color = (src_color & 0xff00ff00u)          /* Alpha Green */
+                | ((src_color & 0x00ff0000u) >> 16)     /* Red */
+                | ((src_color & 0x000000ffu) << 16);    /* Blue */
+        data += stride;
+    }
 }
 
-static inline unsigned int fixup_transformed_pos(struct wined3d_vec4 *p)
+static void fixup_transformed_pos(BYTE *data, unsigned int stride, unsigned int count)
 {
+    struct wined3d_vec4 *p;
+    float w;
+
     /* rhw conversion like in position_float4(). */
-    if (p->w != 1.0f && p->w != 0.0f)
+    while (count--)
     {
-        float w = 1.0f / p->w;
-        p->x *= w;
-        p->y *= w;
-        p->z *= w;
-        p->w = w;
+        p = (struct wined3d_vec4 *)data;
+        if (p->w != 1.0f && p->w != 0.0f)
+        {
+            w = 1.0f / p->w;
+            p->x *= w;
+            p->y *= w;
+            p->z *= w;
+            p->w = w;
+        }
+        data += stride;
     }
-
-    return sizeof(*p);
 }
 
 ULONG CDECL wined3d_buffer_incref(struct wined3d_buffer *buffer)
@@ -552,9 +747,43 @@ static void wined3d_buffer_gl_upload_ranges(struct wined3d_buffer_gl *buffer_gl,
     checkGLcall("glBufferSubData");
 }
 
+static unsigned int buffer_get_conversions(const struct wined3d_buffer *buffer,
+        struct wined3d_buffer_conversion *conversions)
+{
+    unsigned int j, count = 0;
+
+    for (j = 0; j < buffer->stride;)
+    {
+        switch (buffer->conversion_map[j])
+        {
+            case CONV_NONE:
+                j += sizeof(DWORD);
+                break;
+            case CONV_D3DCOLOR:
+                conversions[count].offset = j;
+                conversions[count].size = sizeof(DWORD);
+                conversions[count++].convert = fixup_d3dcolor;
+                j += sizeof(DWORD);
+                break;
+            case CONV_POSITIONT:
+                conversions[count].offset = j;
+                conversions[count].size = sizeof(struct wined3d_vec4);
+                conversions[count++].convert = fixup_transformed_pos;
+                j += sizeof(struct wined3d_vec4);
+                break;
+            default:
+                FIXME("Unimplemented conversion %d in shifted conversion.\n", buffer->conversion_map[j]);
+                ++j;
+        }
+    }
+
+    return count;
+}
+
 static void buffer_conversion_upload(struct wined3d_buffer *buffer, struct wined3d_context *context)
 {
-    unsigned int i, j, range_idx, start, end, vertex_count;
+    unsigned int i, range_idx, start, end, first, last, vertex_count, conversion_count;
+    const struct wined3d_buffer_conversion *conversion;
     BYTE *data;
 
     if (!wined3d_buffer_load_location(buffer, context, WINED3D_LOCATION_SYSMEM))
@@ -573,33 +802,33 @@ static void buffer_conversion_upload(struct wined3d_buffer *buffer, struct wined
         return;
     }
 
+    /* Decode the conversion map once, and then convert one attribute at a
+     * time over all vertices, instead of walking the map for every vertex. */
+    if (!wined3d_array_reserve((void **)&buffer->conversions, &buffer->conversions_size,
+            buffer->stride, sizeof(*buffer->conversions)))
+    {
+        ERR("Out of memory.\n");
+        heap_free(data);
+        return;
+    }
+    conversion_count = buffer_get_conversions(buffer, buffer->conversions);
+
     for (range_idx = 0; range_idx < buffer->modified_areas; ++range_idx)
     {
         start = buffer->maps[range_idx].offset;
         end = start + buffer->maps[range_idx].size;
 
         memcpy(data + start, (BYTE *)buffer->resource.heap_memory + start, end - start);
-        for (i = start / buffer->stride; i < min((end / buffer->stride) + 1, vertex_count); ++i)
+
+        first = start / buffer->stride;
+        last = min((end / buffer->stride) + 1, vertex_count);
+        if (last <= first)
+            continue;
+        for (i = 0; i < conversion_count; ++i)
         {
-            for (j = 0; j < buffer->stride;)
-            {
-                switch (buffer->conversion_map[j])
-                {
-                    case CONV_NONE:
-                        /* Done already */
-                        j += sizeof(DWORD);
-                        break;
-                    case CONV_D3DCOLOR:
-                        j += fixup_d3dcolor((DWORD *) (data + i * buffer->stride + j));
-                        break;
-                    case CONV_POSITIONT:
-                        j += fixup_transformed_pos((struct wined3d_vec4 *) (data + i * buffer->stride + j));
-                        break;
-                    default:
-                        FIXME("Unimplemented conversion %d in shifted conversion.\n", buffer->conversion_map[j]);
-                        ++j;
-                }
-            }
+            conversion = &buffer->conversions[i];
+            conversion->convert(data + first * buffer->stride + conversion->offset,
+                    buffer->stride, last - first);
         }
     }
 
@@ -786,6 +1015,7 @@ static void wined3d_buffer_gl_destroy_object(void *object)
         heap_free(buffer_gl->b.conversion_map);
     }
 
+    heap_free(buffer_gl->b.conversions);
     heap_free(buffer_gl->b.maps);
     heap_free(buffer_gl);
 }
@@ -1076,7 +1306,15 @@ static HRESULT wined3d_buffer_gl_map(struct wined3d_buffer_gl *buffer_gl,
                 if (buffer_gl->b.flags & WINED3D_BUFFER_DISCARD)
                     flags &= ~WINED3D_MAP_DISCARD;
 
-                if (gl_info->supported[ARB_MAP_BUFFER_RANGE])
+                if (buffer_gl->stream)
+                {
+                    if (flags & WINED3D_MAP_DISCARD)
+                        wined3d_buffer_gl_stream_discard(buffer_gl, context);
+                    else if (!(flags & WINED3D_MAP_NOOVERWRITE))
+                        wined3d_buffer_gl_stream_wait(buffer_gl);
+                    buffer_gl->b.map_ptr = buffer_gl->stream->slots[buffer_gl->stream->current].map_ptr;
+                }
+                else if (gl_info->supported[ARB_MAP_BUFFER_RANGE])
                 {
                     GLbitfield mapflags = wined3d_resource_gl_map_flags(flags);
                     buffer_gl->b.map_ptr = GL_EXTCALL(glMapBufferRange(buffer_gl->buffer_type_hint,
@@ -1158,6 +1396,14 @@ static void wined3d_buffer_gl_unmap(struct wined3d_buffer_gl *buffer_gl)
         return;
     }
 
+    /* Persistent mappings are coherent, there is nothing to flush. */
+    if (buffer_gl->stream && buffer_gl->b.map_ptr)
+    {
+        buffer_clear_dirty_areas(&buffer_gl->b);
+        buffer_gl->b.map_ptr = NULL;
+        return;
+    }
+
     if (buffer_gl->b.map_ptr)
     {
         struct wined3d_device *device = buffer_gl->b.resource.device;
@@ -1223,6 +1469,7 @@ void wined3d_buffer_copy(struct wined3d_buffer *dst_buffer, unsigned int dst_off
 void wined3d_buffer_upload_data(struct wined3d_buffer *buffer, struct wined3d_context *context,
         const struct wined3d_box *box, const void *data)
 {
+    struct wined3d_buffer_gl *buffer_gl = wined3d_buffer_gl(buffer);
     struct wined3d_map_range range;
 
     if (box)
@@ -1236,7 +1483,15 @@ void wined3d_buffer_upload_data(struct wined3d_buffer *buffer, struct wined3d_co
         range.size = buffer->resource.size;
     }
 
-    wined3d_buffer_gl_upload_ranges(wined3d_buffer_gl(buffer), context, data, range.offset, 1, &range);
+    /* Replacing the whole contents of a streaming buffer is a discard. */
+    if (buffer_gl->stream && !buffer->resource.map_count && !range.offset && range.size == buffer->resource.size)
+    {
+        wined3d_buffer_gl_stream_discard(buffer_gl, context);
+        memcpy(buffer_gl->stream->slots[buffer_gl->stream->current].map_ptr, data, range.size);
+        return;
+    }
+
+    wined3d_buffer_gl_upload_ranges(buffer_gl, context, data, range.offset, 1, &range);
 }
 
 static void wined3d_buffer_init_data(struct wined3d_buffer *buffer,
@@ -3949,6 +3949,8 @@ static BOOL context_apply_draw_state(struct wined3d_context *context,
     unsigned int i;
     WORD map;
 
+    context->shader_compile_pending = 0;
+
     if (!have_framebuffer_attachment(gl_info->limits.buffers, fb->render_targets, fb->depth_stencil))
     {
         if (!gl_info->supported[ARB_FRAMEBUFFER_NO_ATTACHMENTS])
@@ -4015,6 +4017,14 @@ static BOOL context_apply_draw_state(struct wined3d_context *context,
     if (context->shader_update_mask & ~(1u << WINED3D_SHADER_TYPE_COMPUTE))
     {
         device->shader_backend->shader_select(device->shader_priv, context, state);
+        if (context->shader_compile_pending)
+        {
+            /* Leave the shaders dirty, the program is selected again on the next draw. */
+            TRACE_(d3d_perf)("Skipping draw while shaders are being compiled.\n");
+            ++device->cs->compile_skipped_draws;
+            context->numDirtyEntries = 0;
+            return FALSE;
+        }
         context->shader_update_mask &= 1u << WINED3D_SHADER_TYPE_COMPUTE;
     }
 
@@ -4898,8 +4908,9 @@ void draw_primitive(struct wined3d_device *device, const struct wined3d_state *s
 
     if (!context_apply_draw_state(context, device, state))
     {
+        if (!context->shader_compile_pending)
+            WARN("Unable to apply draw state, skipping draw.\n");
         context_release(context);
-        WARN("Unable to apply draw state, skipping draw.\n");
         return;
     }
 
@@ -21,6 +21,8 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_stats);
 
 #define WINED3D_INITIAL_CS_SIZE 4096
 
@@ -50,9 +52,7 @@ enum wined3d_cs_op
     WINED3D_CS_OP_SET_SHADER,
     WINED3D_CS_OP_SET_BLEND_STATE,
     WINED3D_CS_OP_SET_RASTERIZER_STATE,
-    WINED3D_CS_OP_SET_RENDER_STATE,
-    WINED3D_CS_OP_SET_TEXTURE_STATE,
-    WINED3D_CS_OP_SET_SAMPLER_STATE,
+    WINED3D_CS_OP_SET_STATES,
     WINED3D_CS_OP_SET_TRANSFORM,
     WINED3D_CS_OP_SET_CLIP_PLANE,
     WINED3D_CS_OP_SET_COLOR_KEY,
@@ -273,27 +273,11 @@ struct wined3d_cs_set_rasterizer_state
     struct wined3d_rasterizer_state *state;
 };
 
-struct wined3d_cs_set_render_state
+struct wined3d_cs_set_states
 {
     enum wined3d_cs_op opcode;
-    enum wined3d_render_state state;
-    DWORD value;
-};
-
-struct wined3d_cs_set_texture_state
-{
-    enum wined3d_cs_op opcode;
-    UINT stage;
-    enum wined3d_texture_stage_state state;
-    DWORD value;
-};
-
-struct wined3d_cs_set_sampler_state
-{
-    enum wined3d_cs_op opcode;
-    UINT sampler_idx;
-    enum wined3d_sampler_state state;
-    DWORD value;
+    unsigned int count;
+    struct wined3d_cs_state_change changes[1];
 };
 
 struct wined3d_cs_set_transform
@@ -409,6 +393,7 @@ struct wined3d_cs_update_sub_resource
     unsigned int sub_resource_idx;
     struct wined3d_box box;
     struct wined3d_sub_resource_data data;
+    void *converted;
 };
 
 struct wined3d_cs_add_dirty_texture_region
@@ -447,6 +432,8 @@ struct wined3d_cs_stop
 static inline void *wined3d_cs_require_space(struct wined3d_cs *cs,
         size_t size, enum wined3d_cs_queue_id queue_id)
 {
+    if (cs->pending_state_count)
+        wined3d_cs_emit_pending_states(cs);
     return cs->ops->require_space(cs, size, queue_id);
 }
 
@@ -484,9 +471,7 @@ static const char *debug_cs_op(enum wined3d_cs_op op)
         WINED3D_TO_STR(WINED3D_CS_OP_SET_SHADER);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_BLEND_STATE);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_RASTERIZER_STATE);
-        WINED3D_TO_STR(WINED3D_CS_OP_SET_RENDER_STATE);
-        WINED3D_TO_STR(WINED3D_CS_OP_SET_TEXTURE_STATE);
-        WINED3D_TO_STR(WINED3D_CS_OP_SET_SAMPLER_STATE);
+        WINED3D_TO_STR(WINED3D_CS_OP_SET_STATES);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_TRANSFORM);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_CLIP_PLANE);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_COLOR_KEY);
@@ -530,6 +515,14 @@ static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
 
     swapchain->swapchain_ops->swapchain_present(swapchain, &op->src_rect, &op->dst_rect, op->flags);
 
+    if (cs->compile_skipped_draws)
+    {
+        ++cs->compile_stalled_frames;
+        TRACE_(d3d_perf)("Skipped %u draws for shader compilation, %u frames affected so far.\n",
+                cs->compile_skipped_draws, cs->compile_stalled_frames);
+        cs->compile_skipped_draws = 0;
+    }
+
     wined3d_resource_release(&swapchain->front_buffer->resource);
     for (i = 0; i < swapchain->desc.backbuffer_count; ++i)
     {
@@ -539,6 +532,28 @@ static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
     InterlockedDecrement(&cs->pending_presents);
 }
 
+static void wined3d_cs_dump_state_stats(const struct wined3d_cs *cs)
+{
+    static const char * const group_names[] =
+    {
+        "render", "texture", "sampler", "transform", "viewport", "scissor",
+    };
+    const struct wined3d_state_stats *stats = &cs->stats;
+    unsigned int i;
+
+    C_ASSERT(ARRAY_SIZE(group_names) == WINED3D_STATE_GROUP_COUNT);
+
+    TRACE_(d3d_stats)("%u draws, %u state delta packets.\n", stats->draw_count, stats->delta_count);
+    for (i = 0; i < WINED3D_STATE_GROUP_COUNT; ++i)
+    {
+        if (!stats->changed[i] && !stats->redundant[i])
+            continue;
+        TRACE_(d3d_stats)("  %s: %u changed, %u redundant, %.2f changes per draw.\n", group_names[i],
+                stats->changed[i], stats->redundant[i],
+                stats->draw_count ? (float)stats->changed[i] / stats->draw_count : 0.0f);
+    }
+}
+
 void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *swapchain,
         const RECT *src_rect, const RECT *dst_rect, HWND dst_window_override,
         unsigned int swap_interval, DWORD flags)
@@ -566,6 +581,10 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 
+    if (TRACE_ON(d3d_stats))
+        wined3d_cs_dump_state_stats(cs);
+    memset(&cs->stats, 0, sizeof(cs->stats));
+
     /* Limit input latency by limiting the number of presents that we can get
      * ahead of the worker thread. */
     while (pending >= swapchain->max_frame_latency)
@@ -996,6 +1015,7 @@ void wined3d_cs_emit_draw(struct wined3d_cs *cs, GLenum primitive_type, unsigned
     acquire_graphics_pipeline_resources(state, indexed, d3d_info);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    ++cs->stats.draw_count;
 }
 
 void wined3d_cs_emit_draw_indirect(struct wined3d_cs *cs, GLenum primitive_type, unsigned int patch_vertex_count,
@@ -1018,6 +1038,7 @@ void wined3d_cs_emit_draw_indirect(struct wined3d_cs *cs, GLenum primitive_type,
     wined3d_resource_acquire(&buffer->resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    ++cs->stats.draw_count;
 }
 
 static void wined3d_cs_exec_flush(struct wined3d_cs *cs, const void *data)
@@ -1085,6 +1106,7 @@ void wined3d_cs_emit_set_viewports(struct wined3d_cs *cs, unsigned int viewport_
     op->viewport_count = viewport_count;
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    ++cs->stats.changed[WINED3D_STATE_GROUP_VIEWPORT];
 }
 
 static void wined3d_cs_exec_set_scissor_rects(struct wined3d_cs *cs, const void *data)
@@ -1110,6 +1132,7 @@ void wined3d_cs_emit_set_scissor_rects(struct wined3d_cs *cs, unsigned int rect_
     op->rect_count = rect_count;
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    ++cs->stats.changed[WINED3D_STATE_GROUP_SCISSOR];
 }
 
 static void wined3d_cs_exec_set_rendertarget_view(struct wined3d_cs *cs, const void *data)
@@ -1614,68 +1637,103 @@ void wined3d_cs_emit_set_rasterizer_state(struct wined3d_cs *cs,
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
-static void wined3d_cs_exec_set_render_state(struct wined3d_cs *cs, const void *data)
+static void wined3d_cs_exec_set_states(struct wined3d_cs *cs, const void *data)
 {
-    const struct wined3d_cs_set_render_state *op = data;
+    const struct wined3d_cs_set_states *op = data;
+    const struct wined3d_cs_state_change *change;
+    unsigned int i;
 
-    cs->state.render_states[op->state] = op->value;
-    device_invalidate_state(cs->device, STATE_RENDER(op->state));
-}
+    for (i = 0; i < op->count; ++i)
+    {
+        change = &op->changes[i];
+        switch (change->group)
+        {
+            case WINED3D_STATE_GROUP_RENDER:
+                cs->state.render_states[change->state] = change->value;
+                device_invalidate_state(cs->device, STATE_RENDER(change->state));
+                break;
 
-void wined3d_cs_emit_set_render_state(struct wined3d_cs *cs, enum wined3d_render_state state, DWORD value)
-{
-    struct wined3d_cs_set_render_state *op;
+            case WINED3D_STATE_GROUP_TEXTURE:
+                cs->state.texture_states[change->idx][change->state] = change->value;
+                device_invalidate_state(cs->device, STATE_TEXTURESTAGE(change->idx, change->state));
+                break;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_RENDER_STATE;
-    op->state = state;
-    op->value = value;
+            case WINED3D_STATE_GROUP_SAMPLER:
+                cs->state.sampler_states[change->idx][change->state] = change->value;
+                device_invalidate_state(cs->device, STATE_SAMPLER(change->idx));
+                break;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+            default:
+                ERR("Unhandled state group %#x.\n", change->group);
+                break;
+        }
+    }
 }
 
-static void wined3d_cs_exec_set_texture_state(struct wined3d_cs *cs, const void *data)
+void wined3d_cs_emit_pending_states(struct wined3d_cs *cs)
 {
-    const struct wined3d_cs_set_texture_state *op = data;
+    unsigned int count = cs->pending_state_count;
+    struct wined3d_cs_set_states *op;
+
+    /* Only the application thread queues state changes. */
+    if (!count || cs->thread_id == GetCurrentThreadId())
+        return;
+    cs->pending_state_count = 0;
+
+    op = cs->ops->require_space(cs, FIELD_OFFSET(struct wined3d_cs_set_states, changes[count]),
+            WINED3D_CS_QUEUE_DEFAULT);
+    op->opcode = WINED3D_CS_OP_SET_STATES;
+    op->count = count;
+    memcpy(op->changes, cs->pending_states, count * sizeof(*op->changes));
 
-    cs->state.texture_states[op->stage][op->state] = op->value;
-    device_invalidate_state(cs->device, STATE_TEXTURESTAGE(op->stage, op->state));
+    cs->ops->submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    ++cs->stats.delta_count;
 }
 
-void wined3d_cs_emit_set_texture_state(struct wined3d_cs *cs, UINT stage,
-        enum wined3d_texture_stage_state state, DWORD value)
+static void wined3d_cs_queue_state_change(struct wined3d_cs *cs, enum wined3d_state_group group,
+        unsigned int idx, unsigned int state, DWORD value)
 {
-    struct wined3d_cs_set_texture_state *op;
+    struct wined3d_cs_state_change *change;
+    unsigned int i;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_TEXTURE_STATE;
-    op->stage = stage;
-    op->state = state;
-    op->value = value;
+    ++cs->stats.changed[group];
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    /* A state set more than once between two commands only needs its last value. */
+    for (i = 0; i < cs->pending_state_count; ++i)
+    {
+        change = &cs->pending_states[i];
+        if (change->group == group && change->idx == idx && change->state == state)
+        {
+            change->value = value;
+            return;
+        }
+    }
+
+    if (cs->pending_state_count == ARRAY_SIZE(cs->pending_states))
+        wined3d_cs_emit_pending_states(cs);
+
+    change = &cs->pending_states[cs->pending_state_count++];
+    change->group = group;
+    change->idx = idx;
+    change->state = state;
+    change->value = value;
 }
 
-static void wined3d_cs_exec_set_sampler_state(struct wined3d_cs *cs, const void *data)
+void wined3d_cs_emit_set_render_state(struct wined3d_cs *cs, enum wined3d_render_state state, DWORD value)
 {
-    const struct wined3d_cs_set_sampler_state *op = data;
+    wined3d_cs_queue_state_change(cs, WINED3D_STATE_GROUP_RENDER, 0, state, value);
+}
 
-    cs->state.sampler_states[op->sampler_idx][op->state] = op->value;
-    device_invalidate_state(cs->device, STATE_SAMPLER(op->sampler_idx));
+void wined3d_cs_emit_set_texture_state(struct wined3d_cs *cs, UINT stage,
+        enum wined3d_texture_stage_state state, DWORD value)
+{
+    wined3d_cs_queue_state_change(cs, WINED3D_STATE_GROUP_TEXTURE, stage, state, value);
 }
 
 void wined3d_cs_emit_set_sampler_state(struct wined3d_cs *cs, UINT sampler_idx,
         enum wined3d_sampler_state state, DWORD value)
 {
-    struct wined3d_cs_set_sampler_state *op;
-
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_SAMPLER_STATE;
-    op->sampler_idx = sampler_idx;
-    op->state = state;
-    op->value = value;
-
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_queue_state_change(cs, WINED3D_STATE_GROUP_SAMPLER, sampler_idx, state, value);
 }
 
 static void wined3d_cs_exec_set_transform(struct wined3d_cs *cs, const void *data)
@@ -1698,6 +1756,7 @@ void wined3d_cs_emit_set_transform(struct wined3d_cs *cs, enum wined3d_transform
     op->matrix = *matrix;
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    ++cs->stats.changed[WINED3D_STATE_GROUP_TRANSFORM];
 }
 
 static void wined3d_cs_exec_set_clip_plane(struct wined3d_cs *cs, const void *data)
@@ -2317,9 +2376,11 @@ static void wined3d_cs_exec_update_sub_resource(struct wined3d_cs *cs, const voi
     struct wined3d_resource *resource = op->resource;
     const struct wined3d_box *box = &op->box;
     unsigned int width, height, depth, level;
+    const struct wined3d_format *format;
     struct wined3d_const_bo_address addr;
     struct wined3d_context *context;
     struct wined3d_texture *texture;
+    struct wined3d_format_gl f;
     struct wined3d_box src_box;
 
     context = context_acquire(cs->device, NULL, 0);
@@ -2357,8 +2418,18 @@ static void wined3d_cs_exec_update_sub_resource(struct wined3d_cs *cs, const voi
         wined3d_texture_load_location(texture, op->sub_resource_idx, context, WINED3D_LOCATION_TEXTURE_RGB);
     wined3d_texture_gl_bind_and_dirtify(wined3d_texture_gl(texture), context, FALSE);
 
+    format = texture->resource.format;
+    if (op->converted)
+    {
+        /* The data was already converted by wined3d_cs_emit_update_sub_resource(). */
+        f = *wined3d_format_gl(format);
+        f.f.byte_count = format->conv_byte_count;
+        f.f.upload = NULL;
+        format = &f.f;
+    }
+
     wined3d_box_set(&src_box, 0, 0, box->right - box->left, box->bottom - box->top, 0, box->back - box->front);
-    wined3d_texture_upload_data(texture, op->sub_resource_idx, context, texture->resource.format, &src_box,
+    wined3d_texture_upload_data(texture, op->sub_resource_idx, context, format, &src_box,
             &addr, op->data.row_pitch, op->data.slice_pitch, box->left, box->top, box->front, FALSE);
 
     wined3d_texture_validate_location(texture, op->sub_resource_idx, WINED3D_LOCATION_TEXTURE_RGB);
@@ -2367,16 +2438,63 @@ static void wined3d_cs_exec_update_sub_resource(struct wined3d_cs *cs, const voi
 done:
     context_release(context);
 
+    heap_free(op->converted);
     wined3d_resource_release(resource);
 }
 
+/* Formats that need a CPU conversion before they can be uploaded are
+ * converted on the calling thread, so that the CS thread only has to do the
+ * actual upload. */
+static void *wined3d_cs_convert_sub_resource_data(const struct wined3d_resource *resource,
+        const struct wined3d_box *box, const void *data, unsigned int *row_pitch, unsigned int *slice_pitch)
+{
+    const struct wined3d_format *format = resource->format;
+    unsigned int width, height, depth, dst_row_pitch, dst_slice_pitch;
+    struct wined3d_format f;
+    void *converted;
+
+    if (resource->type == WINED3D_RTYPE_BUFFER || !format->upload)
+        return NULL;
+    if (resource->format_flags & (WINED3DFMT_FLAG_BLOCKS | WINED3DFMT_FLAG_DECOMPRESS | WINED3DFMT_FLAG_HEIGHT_SCALE))
+        return NULL;
+
+    width = box->right - box->left;
+    height = box->bottom - box->top;
+    depth = box->back - box->front;
+
+    f = *format;
+    f.byte_count = format->conv_byte_count;
+    wined3d_format_calculate_pitch(&f, 1, width, height, &dst_row_pitch, &dst_slice_pitch);
+
+    if (!(converted = heap_calloc(depth, dst_slice_pitch)))
+        return NULL;
+
+    format->upload(data, converted, *row_pitch, *slice_pitch,
+            dst_row_pitch, dst_slice_pitch, width, height, depth);
+
+    *row_pitch = dst_row_pitch;
+    *slice_pitch = dst_slice_pitch;
+
+    return converted;
+}
+
 void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
         unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data, unsigned int row_pitch,
         unsigned int slice_pitch)
 {
+    enum wined3d_cs_queue_id queue_id = WINED3D_CS_QUEUE_MAP;
     struct wined3d_cs_update_sub_resource *op;
+    void *converted;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP);
+    /* The packet owns converted data, so it can go through the default
+     * queue like any other command, without waiting for the CS. */
+    if ((converted = wined3d_cs_convert_sub_resource_data(resource, box, data, &row_pitch, &slice_pitch)))
+    {
+        data = converted;
+        queue_id = WINED3D_CS_QUEUE_DEFAULT;
+    }
+
+    op = wined3d_cs_require_space(cs, sizeof(*op), queue_id);
     op->opcode = WINED3D_CS_OP_UPDATE_SUB_RESOURCE;
     op->resource = resource;
     op->sub_resource_idx = sub_resource_idx;
@@ -2384,13 +2502,15 @@ void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_r
     op->data.row_pitch = row_pitch;
     op->data.slice_pitch = slice_pitch;
     op->data.data = data;
+    op->converted = converted;
 
     wined3d_resource_acquire(resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_MAP);
+    wined3d_cs_submit(cs, queue_id);
     /* The data pointer may go away, so we need to wait until it is read.
      * Copying the data may be faster if it's small. */
-    wined3d_cs_finish(cs, WINED3D_CS_QUEUE_MAP);
+    if (!converted)
+        wined3d_cs_finish(cs, WINED3D_CS_QUEUE_MAP);
 }
 
 static void wined3d_cs_exec_add_dirty_texture_region(struct wined3d_cs *cs, const void *data)
@@ -2545,9 +2665,7 @@ static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void
     /* WINED3D_CS_OP_SET_SHADER                  */ wined3d_cs_exec_set_shader,
     /* WINED3D_CS_OP_SET_BLEND_STATE             */ wined3d_cs_exec_set_blend_state,
     /* WINED3D_CS_OP_SET_RASTERIZER_STATE        */ wined3d_cs_exec_set_rasterizer_state,
-    /* WINED3D_CS_OP_SET_RENDER_STATE            */ wined3d_cs_exec_set_render_state,
-    /* WINED3D_CS_OP_SET_TEXTURE_STATE           */ wined3d_cs_exec_set_texture_state,
-    /* WINED3D_CS_OP_SET_SAMPLER_STATE           */ wined3d_cs_exec_set_sampler_state,
+    /* WINED3D_CS_OP_SET_STATES                  */ wined3d_cs_exec_set_states,
     /* WINED3D_CS_OP_SET_TRANSFORM               */ wined3d_cs_exec_set_transform,
     /* WINED3D_CS_OP_SET_CLIP_PLANE              */ wined3d_cs_exec_set_clip_plane,
     /* WINED3D_CS_OP_SET_COLOR_KEY               */ wined3d_cs_exec_set_color_key,
@@ -1511,6 +1511,7 @@ void CDECL wined3d_device_set_transform(struct wined3d_device *device,
     if (!memcmp(&device->state.transforms[d3dts], matrix, sizeof(*matrix)))
     {
         TRACE("The application is setting the same matrix over again.\n");
+        ++device->cs->stats.redundant[WINED3D_STATE_GROUP_TRANSFORM];
         return;
     }
 
@@ -1922,6 +1923,14 @@ void CDECL wined3d_device_set_viewports(struct wined3d_device *device, unsigned
                 viewports[i].width, viewports[i].height, viewports[i].min_z, viewports[i].max_z);
     }
 
+    if (!device->recording && device->state.viewport_count == viewport_count
+            && (!viewport_count || !memcmp(device->state.viewports, viewports, viewport_count * sizeof(*viewports))))
+    {
+        TRACE("App is setting the old viewports over, nothing to do.\n");
+        ++device->cs->stats.redundant[WINED3D_STATE_GROUP_VIEWPORT];
+        return;
+    }
+
     if (viewport_count)
         memcpy(device->update_state->viewports, viewports, viewport_count * sizeof(*viewports));
     else
@@ -2060,9 +2069,14 @@ void CDECL wined3d_device_set_render_state(struct wined3d_device *device,
 
     /* Compared here and not before the assignment to allow proper stateblock recording. */
     if (value == old_value)
+    {
         TRACE("Application is setting the old value over, nothing to do.\n");
+        ++device->cs->stats.redundant[WINED3D_STATE_GROUP_RENDER];
+    }
     else
+    {
         wined3d_cs_emit_set_render_state(device->cs, state, value);
+    }
 
     if (state == WINED3D_RS_POINTSIZE && value == WINED3D_RESZ_CODE)
     {
@@ -2109,6 +2123,7 @@ void CDECL wined3d_device_set_sampler_state(struct wined3d_device *device,
     if (old_value == value)
     {
         TRACE("Application is setting the old value over, nothing to do.\n");
+        ++device->cs->stats.redundant[WINED3D_STATE_GROUP_SAMPLER];
         return;
     }
 
@@ -2152,6 +2167,7 @@ void CDECL wined3d_device_set_scissor_rects(struct wined3d_device *device, unsig
             && !memcmp(device->update_state->scissor_rects, rects, rect_count * sizeof(*rects)))
     {
         TRACE("App is setting the old scissor rectangles over, nothing to do.\n");
+        ++device->cs->stats.redundant[WINED3D_STATE_GROUP_SCISSOR];
         return;
     }
 
@@ -3065,14 +3081,17 @@ static unsigned int wined3d_get_flexible_vertex_size(DWORD fvf)
 static HRESULT process_vertices_strided(const struct wined3d_device *device, DWORD dwDestIndex, DWORD dwCount,
         const struct wined3d_stream_info *stream_info, struct wined3d_buffer *dest, DWORD flags, DWORD dst_fvf)
 {
+    const struct wined3d_stream_info_element *position, *normal, *diffuse, *specular;
     struct wined3d_matrix mat, proj_mat, view_mat, world_mat;
+    float vp_scale_x, vp_scale_y, vp_scale_z;
+    float vp_offset_x, vp_offset_y;
     struct wined3d_map_desc map_desc;
     struct wined3d_box box = {0};
     struct wined3d_viewport vp;
     unsigned int vertex_size;
     unsigned int i;
     BYTE *dest_ptr;
-    BOOL doClip;
+    BOOL doClip, transform;
     DWORD numTextures;
     HRESULT hr;
 
@@ -3149,14 +3168,28 @@ static HRESULT process_vertices_strided(const struct wined3d_device *device, DWO
 
     numTextures = (dst_fvf & WINED3DFVF_TEXCOUNT_MASK) >> WINED3DFVF_TEXCOUNT_SHIFT;
 
+    /* Everything that doesn't depend on the vertex is computed once, outside
+     * the loop. */
+    transform = (dst_fvf & WINED3DFVF_POSITION_MASK) == WINED3DFVF_XYZ
+            || (dst_fvf & WINED3DFVF_POSITION_MASK) == WINED3DFVF_XYZRHW;
+    vp_scale_x = vp.width / 2;
+    vp_scale_y = vp.height / 2;
+    vp_scale_z = vp.max_z - vp.min_z;
+    vp_offset_x = vp.width / 2 + vp.x;
+    vp_offset_y = vp.height / 2 + vp.y;
+
+    position = &stream_info->elements[WINED3D_FFP_POSITION];
+    normal = &stream_info->elements[WINED3D_FFP_NORMAL];
+    diffuse = &stream_info->elements[WINED3D_FFP_DIFFUSE];
+    specular = &stream_info->elements[WINED3D_FFP_SPECULAR];
+
     for (i = 0; i < dwCount; i+= 1) {
         unsigned int tex_index;
 
-        if ( ((dst_fvf & WINED3DFVF_POSITION_MASK) == WINED3DFVF_XYZ ) ||
-             ((dst_fvf & WINED3DFVF_POSITION_MASK) == WINED3DFVF_XYZRHW ) ) {
+        if (transform)
+        {
             /* The position first */
-            const struct wined3d_stream_info_element *element = &stream_info->elements[WINED3D_FFP_POSITION];
-            const float *p = (const float *)(element->data.addr + i * element->stride);
+            const float *p = (const float *)(position->data.addr + i * position->stride);
             float x, y, z, rhw;
             TRACE("In: ( %06.2f %06.2f %06.2f )\n", p[0], p[1], p[2]);
 
@@ -3211,12 +3244,12 @@ static HRESULT process_vertices_strided(const struct wined3d_device *device, DWO
 
                 y *= -1;
 
-                x *= vp.width / 2;
-                y *= vp.height / 2;
-                z *= vp.max_z - vp.min_z;
+                x *= vp_scale_x;
+                y *= vp_scale_y;
+                z *= vp_scale_z;
 
-                x += vp.width / 2 + vp.x;
-                y += vp.height / 2 + vp.y;
+                x += vp_offset_x;
+                y += vp_offset_y;
                 z += vp.min_z;
 
                 rhw = 1 / rhw;
@@ -3257,17 +3290,15 @@ static HRESULT process_vertices_strided(const struct wined3d_device *device, DWO
 
         if (dst_fvf & WINED3DFVF_NORMAL)
         {
-            const struct wined3d_stream_info_element *element = &stream_info->elements[WINED3D_FFP_NORMAL];
-            const float *normal = (const float *)(element->data.addr + i * element->stride);
+            const float *n = (const float *)(normal->data.addr + i * normal->stride);
             /* AFAIK this should go into the lighting information */
             FIXME("Didn't expect the destination to have a normal\n");
-            copy_and_next(dest_ptr, normal, 3 * sizeof(float));
+            copy_and_next(dest_ptr, n, 3 * sizeof(float));
         }
 
         if (dst_fvf & WINED3DFVF_DIFFUSE)
         {
-            const struct wined3d_stream_info_element *element = &stream_info->elements[WINED3D_FFP_DIFFUSE];
-            const DWORD *color_d = (const DWORD *)(element->data.addr + i * element->stride);
+            const DWORD *color_d = (const DWORD *)(diffuse->data.addr + i * diffuse->stride);
             if (!(stream_info->use_map & (1u << WINED3D_FFP_DIFFUSE)))
             {
                 static BOOL warned = FALSE;
@@ -3289,8 +3320,7 @@ static HRESULT process_vertices_strided(const struct wined3d_device *device, DWO
         if (dst_fvf & WINED3DFVF_SPECULAR)
         {
             /* What's the color value in the feedback buffer? */
-            const struct wined3d_stream_info_element *element = &stream_info->elements[WINED3D_FFP_SPECULAR];
-            const DWORD *color_s = (const DWORD *)(element->data.addr + i * element->stride);
+            const DWORD *color_s = (const DWORD *)(specular->data.addr + i * specular->stride);
             if (!(stream_info->use_map & (1u << WINED3D_FFP_SPECULAR)))
             {
                 static BOOL warned = FALSE;
@@ -3432,6 +3462,7 @@ void CDECL wined3d_device_set_texture_stage_state(struct wined3d_device *device,
     if (old_value == value)
     {
         TRACE("Application is setting the old value over, nothing to do.\n");
+        ++device->cs->stats.redundant[WINED3D_STATE_GROUP_TEXTURE];
         return;
     }
 
@@ -144,6 +144,8 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    struct glsl_program_cache *program_cache;
 };
 
 struct glsl_vs_program
@@ -258,7 +260,10 @@ struct glsl_shader_prog_link
     unsigned int constant_version;
     DWORD shader_controlled_clip_distances : 1;
     DWORD clip_distance_mask : 8; /* MAX_CLIP_DISTANCES, 8 */
-    DWORD padding : 23;
+    DWORD link_pending : 1;
+    DWORD padding : 22;
+    struct wined3d_shader *shaders[WINED3D_SHADER_TYPE_GRAPHICS_COUNT];
+    struct glsl_deferred_link *deferred_link;
 };
 
 struct glsl_program_key
@@ -275,7 +280,7 @@ struct shader_glsl_ctx_priv {
     const struct vs_compile_args    *cur_vs_args;
     const struct ds_compile_args    *cur_ds_args;
     const struct ps_compile_args    *cur_ps_args;
-    struct ps_np2fixup_info         *cur_np2fixup_info;
+    const struct ps_np2fixup_info   *cur_np2fixup_info;
     struct wined3d_string_buffer_list *string_buffers;
 };
 
@@ -286,39 +291,48 @@ struct glsl_context_data
     BOOL rasterization_disabled;
 };
 
+/* With the program cache, GL shaders are only generated and compiled when
+ * a program using them isn't found in the cache. Until then they are
+ * "pending". */
 struct glsl_ps_compiled_shader
 {
     struct ps_compile_args          args;
     struct ps_np2fixup_info         np2fixup;
     GLuint                          id;
+    BOOL                            pending;
 };
 
 struct glsl_vs_compiled_shader
 {
     struct vs_compile_args          args;
     GLuint                          id;
+    BOOL                            pending;
 };
 
 struct glsl_hs_compiled_shader
 {
     GLuint id;
+    BOOL pending;
 };
 
 struct glsl_ds_compiled_shader
 {
     struct ds_compile_args args;
     GLuint id;
+    BOOL pending;
 };
 
 struct glsl_gs_compiled_shader
 {
     struct gs_compile_args args;
     GLuint id;
+    BOOL pending;
 };
 
 struct glsl_cs_compiled_shader
 {
     GLuint id;
+    BOOL pending;
 };
 
 struct glsl_shader_private
@@ -333,6 +347,8 @@ struct glsl_shader_private
         struct glsl_cs_compiled_shader *cs;
     } gl_shaders;
     unsigned int num_gl_shaders, shader_array_size;
+    BOOL byte_code_hash_valid;
+    UINT64 byte_code_hash;
 };
 
 struct glsl_ffp_vertex_shader
@@ -514,6 +530,11 @@ void print_glsl_info_log(const struct wined3d_gl_info *gl_info, GLuint id, BOOL
     }
 }
 
+static BOOL shader_glsl_use_async_compile(const struct wined3d_gl_info *gl_info)
+{
+    return wined3d_settings.async_shader_compile && gl_info->supported[ARB_PARALLEL_SHADER_COMPILE];
+}
+
 /* Context activation is done by the caller. */
 static void shader_glsl_compile(const struct wined3d_gl_info *gl_info, GLuint shader, const char *src)
 {
@@ -531,7 +552,10 @@ static void shader_glsl_compile(const struct wined3d_gl_info *gl_info, GLuint sh
     checkGLcall("glShaderSource");
     GL_EXTCALL(glCompileShader(shader));
     checkGLcall("glCompileShader");
-    print_glsl_info_log(gl_info, shader, FALSE);
+    /* Querying the info log would wait for a parallel compile to finish.
+     * The log is printed when the program is validated instead. */
+    if (!shader_glsl_use_async_compile(gl_info))
+        print_glsl_info_log(gl_info, shader, FALSE);
 }
 
 /* Context activation is done by the caller. */
@@ -604,6 +628,860 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+/* On-disk cache of linked program binaries. Programs are keyed by the byte
+ * code hashes and compile arguments of their shaders, and by the identity of
+ * the GL driver and of wined3d itself, so a hit skips generating and
+ * compiling the GLSL shaders. The cache directory is indexed when the cache
+ * is created, so misses don't touch the disk. Writing files, updating their
+ * last use time and evicting the least recently used files when the cache
+ * grows beyond its size limit are done by a worker thread. */
+#define GLSL_PROGRAM_CACHE_MAGIC    0x43503357  /* "W3PC" */
+#define GLSL_PROGRAM_CACHE_VERSION  2
+#define GLSL_PROGRAM_CACHE_FNV_BASIS ((((UINT64)0xcbf29ce4) << 32) | 0x84222325)
+#define GLSL_PROGRAM_CACHE_FNV_PRIME ((((UINT64)0x100) << 32) | 0x1b3)
+
+#define GLSL_PROGRAM_CACHE_POINT_SIZE   0x1
+#define GLSL_PROGRAM_CACHE_FLATSHADING  0x2
+
+/* The on-disk layout, shared by 32-bit and 64-bit builds. */
+struct glsl_program_cache_header
+{
+    UINT32 magic;
+    UINT32 version;
+    UINT32 key_size;
+    UINT32 binary_format;
+    UINT32 binary_size;
+    UINT32 reserved;
+};
+C_ASSERT(sizeof(struct glsl_program_cache_header) == 24);
+
+/* Keys are cleared before they are filled in, so padding doesn't end up in
+ * the hash. */
+struct glsl_program_cache_key
+{
+    UINT64 driver_hash;
+    UINT32 flags;
+    UINT32 padding;
+    struct
+    {
+        UINT64 byte_code_hash;
+        UINT32 byte_code_size;
+        UINT32 padding;
+    } shaders[WINED3D_SHADER_TYPE_COUNT];
+    struct vs_compile_args vs_args;
+    struct ds_compile_args ds_args;
+    struct gs_compile_args gs_args;
+    struct ps_compile_args ps_args;
+};
+
+struct glsl_program_cache_entry
+{
+    struct wine_rb_entry entry;
+    UINT64 hash;
+    UINT64 last_use;
+    UINT32 size;
+};
+
+enum glsl_program_cache_task_type
+{
+    GLSL_PROGRAM_CACHE_TASK_STORE,
+    GLSL_PROGRAM_CACHE_TASK_TOUCH,
+    GLSL_PROGRAM_CACHE_TASK_DELETE,
+};
+
+struct glsl_program_cache_task
+{
+    struct list entry;
+    enum glsl_program_cache_task_type type;
+    UINT64 hash;
+    UINT32 size;
+    BYTE data[1];
+};
+
+struct glsl_program_cache
+{
+    LONG refcount;
+    HMODULE wined3d_module;
+    HANDLE thread;
+    HANDLE event;
+    HANDLE idle_event;
+
+    /* Protects everything below up to the driver hash. */
+    CRITICAL_SECTION cs;
+    struct list tasks;
+    BOOL stop;
+    struct wine_rb_tree entries;
+    unsigned int entry_count;
+    UINT64 total_size;
+    UINT64 size_limit;
+    unsigned int stores;
+    unsigned int evictions;
+
+    /* Only used by the thread using the shader backend. */
+    UINT64 module_hash;
+    BOOL driver_hash_valid;
+    UINT64 driver_hash;
+    unsigned int hits;
+    unsigned int misses;
+    LONGLONG hit_time;
+    LONGLONG miss_time;
+};
+
+static UINT64 glsl_program_cache_hash(UINT64 hash, const void *data, SIZE_T size)
+{
+    const BYTE *ptr = data;
+
+    while (size--)
+        hash = (hash ^ *ptr++) * GLSL_PROGRAM_CACHE_FNV_PRIME;
+    return hash;
+}
+
+static UINT64 glsl_program_cache_get_time(void)
+{
+    FILETIME ft;
+
+    GetSystemTimeAsFileTime(&ft);
+    return ((UINT64)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+}
+
+static int glsl_program_cache_entry_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct glsl_program_cache_entry *e = WINE_RB_ENTRY_VALUE(entry, struct glsl_program_cache_entry, entry);
+    UINT64 hash = *(const UINT64 *)key;
+
+    return hash < e->hash ? -1 : hash > e->hash;
+}
+
+static void glsl_program_cache_get_filename(char *filename, SIZE_T size, UINT64 hash)
+{
+    snprintf(filename, size, "%s\\%08x%08x.bin", wined3d_settings.shader_cache_path,
+            (unsigned int)(hash >> 32), (unsigned int)hash);
+}
+
+/* Creates "path" and its missing parent directories. The root of the path,
+ * either a drive ("C:\") or a share ("\\server\share\"), is left alone. */
+static void glsl_program_cache_create_directory(const char *path)
+{
+    char buffer[MAX_PATH], *p;
+
+    if (strlen(path) >= sizeof(buffer))
+        return;
+    strcpy(buffer, path);
+
+    p = buffer;
+    if (p[0] == '\\' && p[1] == '\\')
+    {
+        if (!(p = strchr(p + 2, '\\')) || !(p = strchr(p + 1, '\\')))
+            return;
+    }
+    else if (p[0] && p[1] == ':')
+    {
+        p += 2;
+    }
+    while (*p == '\\')
+        ++p;
+
+    for (; (p = strchr(p, '\\')); ++p)
+    {
+        *p = 0;
+        CreateDirectoryA(buffer, NULL);
+        *p = '\\';
+    }
+    CreateDirectoryA(buffer, NULL);
+}
+
+static BOOL glsl_program_cache_parse_filename(const char *name, UINT64 *hash)
+{
+    unsigned int i;
+    UINT64 h = 0;
+    char c;
+
+    for (i = 0; i < 16; ++i)
+    {
+        c = name[i];
+        if (c >= '0' && c <= '9')
+            h = (h << 4) | (c - '0');
+        else if (c >= 'a' && c <= 'f')
+            h = (h << 4) | (c - 'a' + 10);
+        else
+            return FALSE;
+    }
+    if (strcmp(name + 16, ".bin"))
+        return FALSE;
+    *hash = h;
+    return TRUE;
+}
+
+static void glsl_program_cache_add_entry(struct glsl_program_cache *cache,
+        UINT64 hash, UINT32 size, UINT64 last_use)
+{
+    struct glsl_program_cache_entry *entry;
+    struct wine_rb_entry *e;
+
+    if ((e = wine_rb_get(&cache->entries, &hash)))
+    {
+        entry = WINE_RB_ENTRY_VALUE(e, struct glsl_program_cache_entry, entry);
+        cache->total_size -= entry->size;
+    }
+    else
+    {
+        if (!(entry = heap_alloc(sizeof(*entry))))
+            return;
+        entry->hash = hash;
+        wine_rb_put(&cache->entries, &hash, &entry->entry);
+        ++cache->entry_count;
+    }
+    entry->size = size;
+    entry->last_use = last_use;
+    cache->total_size += size;
+}
+
+static void glsl_program_cache_remove_entry(struct glsl_program_cache *cache, struct glsl_program_cache_entry *entry)
+{
+    wine_rb_remove(&cache->entries, &entry->entry);
+    cache->total_size -= entry->size;
+    --cache->entry_count;
+    heap_free(entry);
+}
+
+static void glsl_program_cache_index(struct glsl_program_cache *cache)
+{
+    char pattern[MAX_PATH];
+    WIN32_FIND_DATAA data;
+    HANDLE find;
+    UINT64 hash;
+
+    snprintf(pattern, sizeof(pattern), "%s\\*.bin", wined3d_settings.shader_cache_path);
+    if ((find = FindFirstFileA(pattern, &data)) == INVALID_HANDLE_VALUE)
+        return;
+    do
+    {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY || data.nFileSizeHigh
+                || !glsl_program_cache_parse_filename(data.cFileName, &hash))
+            continue;
+        glsl_program_cache_add_entry(cache, hash, data.nFileSizeLow,
+                ((UINT64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+
+    TRACE("Found %u cached programs, %s bytes.\n", cache->entry_count, wine_dbgstr_longlong(cache->total_size));
+}
+
+/* Binaries built by an older or newer wined3d are rejected by the key, but
+ * they would still take up space until they are evicted. */
+static UINT64 glsl_program_cache_get_module_hash(HMODULE module)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    UINT64 hash = GLSL_PROGRAM_CACHE_FNV_BASIS;
+    WCHAR filename[MAX_PATH];
+    DWORD len;
+
+    hash = glsl_program_cache_hash(hash, PACKAGE_VERSION, sizeof(PACKAGE_VERSION));
+    len = GetModuleFileNameW(module, filename, ARRAY_SIZE(filename));
+    if (len && len < ARRAY_SIZE(filename) && GetFileAttributesExW(filename, GetFileExInfoStandard, &data))
+    {
+        hash = glsl_program_cache_hash(hash, &data.nFileSizeLow, sizeof(data.nFileSizeLow));
+        hash = glsl_program_cache_hash(hash, &data.ftLastWriteTime, sizeof(data.ftLastWriteTime));
+    }
+    return hash;
+}
+
+static int glsl_program_cache_entry_lru_compare(const void *a, const void *b)
+{
+    const struct glsl_program_cache_entry *e1 = *(const struct glsl_program_cache_entry * const *)a;
+    const struct glsl_program_cache_entry *e2 = *(const struct glsl_program_cache_entry * const *)b;
+
+    return e1->last_use < e2->last_use ? -1 : e1->last_use > e2->last_use;
+}
+
+/* Evicts the least recently used programs until the cache is at three
+ * quarters of its size limit, so that evictions don't happen on every store.
+ * Called from the worker thread. */
+static void glsl_program_cache_evict(struct glsl_program_cache *cache)
+{
+    struct glsl_program_cache_entry **entries, *entry;
+    unsigned int i, count = 0;
+    char filename[MAX_PATH];
+    UINT64 *hashes = NULL;
+    UINT64 target;
+
+    EnterCriticalSection(&cache->cs);
+    if (cache->total_size <= cache->size_limit
+            || !(entries = heap_calloc(cache->entry_count, sizeof(*entries))))
+    {
+        LeaveCriticalSection(&cache->cs);
+        return;
+    }
+    WINE_RB_FOR_EACH_ENTRY(entry, &cache->entries, struct glsl_program_cache_entry, entry)
+    {
+        entries[count++] = entry;
+    }
+    qsort(entries, count, sizeof(*entries), glsl_program_cache_entry_lru_compare);
+
+    target = cache->size_limit / 4 * 3;
+    if ((hashes = heap_calloc(count, sizeof(*hashes))))
+    {
+        for (i = 0; i < count && cache->total_size > target; ++i)
+        {
+            hashes[i] = entries[i]->hash;
+            glsl_program_cache_remove_entry(cache, entries[i]);
+        }
+        count = i;
+        cache->evictions += count;
+    }
+    LeaveCriticalSection(&cache->cs);
+    heap_free(entries);
+
+    if (!hashes)
+        return;
+    for (i = 0; i < count; ++i)
+    {
+        glsl_program_cache_get_filename(filename, sizeof(filename), hashes[i]);
+        TRACE("Evicting %s.\n", debugstr_a(filename));
+        DeleteFileA(filename);
+    }
+    heap_free(hashes);
+}
+
+/* Called from the worker thread. */
+static void glsl_program_cache_store_file(struct glsl_program_cache *cache,
+        const struct glsl_program_cache_task *task)
+{
+    char filename[MAX_PATH], tmp_filename[MAX_PATH];
+    HANDLE file;
+    DWORD size;
+    BOOL ret;
+
+    glsl_program_cache_get_filename(filename, sizeof(filename), task->hash);
+
+    /* Write to a temporary file first, other processes may be reading the cache. */
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.%x", filename, GetCurrentProcessId());
+    file = CreateFileA(tmp_filename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create %s, error %u.\n", debugstr_a(tmp_filename), GetLastError());
+        return;
+    }
+    ret = WriteFile(file, task->data, task->size, &size, NULL) && size == task->size;
+    CloseHandle(file);
+
+    if (!ret || !MoveFileExA(tmp_filename, filename, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to store program binary %s.\n", debugstr_a(filename));
+        DeleteFileA(tmp_filename);
+        return;
+    }
+
+    EnterCriticalSection(&cache->cs);
+    glsl_program_cache_add_entry(cache, task->hash, task->size, glsl_program_cache_get_time());
+    ++cache->stores;
+    LeaveCriticalSection(&cache->cs);
+
+    glsl_program_cache_evict(cache);
+}
+
+/* Called from the worker thread. */
+static void glsl_program_cache_touch_file(const struct glsl_program_cache_task *task)
+{
+    char filename[MAX_PATH];
+    FILETIME ft;
+    HANDLE file;
+
+    glsl_program_cache_get_filename(filename, sizeof(filename), task->hash);
+    file = CreateFileA(filename, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    GetSystemTimeAsFileTime(&ft);
+    SetFileTime(file, NULL, NULL, &ft);
+    CloseHandle(file);
+}
+
+static void glsl_program_cache_release(struct glsl_program_cache *cache)
+{
+    struct glsl_program_cache_task *task, *next;
+    struct glsl_program_cache_entry *entry, *entry2;
+
+    if (InterlockedDecrement(&cache->refcount))
+        return;
+
+    LIST_FOR_EACH_ENTRY_SAFE(task, next, &cache->tasks, struct glsl_program_cache_task, entry)
+    {
+        heap_free(task);
+    }
+    WINE_RB_FOR_EACH_ENTRY_DESTRUCTOR(entry, entry2, &cache->entries, struct glsl_program_cache_entry, entry)
+    {
+        heap_free(entry);
+    }
+    CloseHandle(cache->idle_event);
+    CloseHandle(cache->event);
+    cache->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(&cache->cs);
+    heap_free(cache);
+}
+
+static DWORD WINAPI glsl_program_cache_worker(void *ctx)
+{
+    struct glsl_program_cache *cache = ctx;
+    HMODULE wined3d_module = cache->wined3d_module;
+    struct glsl_program_cache_task *task;
+    char filename[MAX_PATH];
+    struct list *head;
+
+    TRACE("Started.\n");
+
+    EnterCriticalSection(&cache->cs);
+    for (;;)
+    {
+        if (!(head = list_head(&cache->tasks)))
+        {
+            if (cache->stop)
+                break;
+            LeaveCriticalSection(&cache->cs);
+            WaitForSingleObject(cache->event, INFINITE);
+            EnterCriticalSection(&cache->cs);
+            continue;
+        }
+        list_remove(head);
+        LeaveCriticalSection(&cache->cs);
+
+        task = LIST_ENTRY(head, struct glsl_program_cache_task, entry);
+        switch (task->type)
+        {
+            case GLSL_PROGRAM_CACHE_TASK_STORE:
+                glsl_program_cache_store_file(cache, task);
+                break;
+
+            case GLSL_PROGRAM_CACHE_TASK_TOUCH:
+                glsl_program_cache_touch_file(task);
+                break;
+
+            case GLSL_PROGRAM_CACHE_TASK_DELETE:
+                glsl_program_cache_get_filename(filename, sizeof(filename), task->hash);
+                DeleteFileA(filename);
+                break;
+        }
+        heap_free(task);
+
+        EnterCriticalSection(&cache->cs);
+    }
+    LeaveCriticalSection(&cache->cs);
+
+    SetEvent(cache->idle_event);
+    glsl_program_cache_release(cache);
+
+    TRACE("Stopped.\n");
+    FreeLibraryAndExitThread(wined3d_module, 0);
+}
+
+static void glsl_program_cache_queue_task(struct glsl_program_cache *cache, struct glsl_program_cache_task *task)
+{
+    EnterCriticalSection(&cache->cs);
+    list_add_tail(&cache->tasks, &task->entry);
+    LeaveCriticalSection(&cache->cs);
+    SetEvent(cache->event);
+}
+
+static void glsl_program_cache_queue_simple_task(struct glsl_program_cache *cache,
+        enum glsl_program_cache_task_type type, UINT64 hash)
+{
+    struct glsl_program_cache_task *task;
+
+    if (!(task = heap_alloc(sizeof(*task))))
+        return;
+    task->type = type;
+    task->hash = hash;
+    task->size = 0;
+    glsl_program_cache_queue_task(cache, task);
+}
+
+static struct glsl_program_cache *glsl_program_cache_create(const struct wined3d_gl_info *gl_info)
+{
+    struct glsl_program_cache *cache;
+
+    if (!wined3d_settings.shader_cache_path || !gl_info->supported[ARB_GET_PROGRAM_BINARY])
+        return NULL;
+
+    /* The worker thread can't be started while the loader lock is held. */
+    if (RtlIsCriticalSectionLockedByThread(NtCurrentTeb()->Peb->LoaderLock))
+    {
+        WARN("Not using the program cache while the loader lock is held.\n");
+        return NULL;
+    }
+
+    if (!(cache = heap_alloc_zero(sizeof(*cache))))
+        return NULL;
+
+    /* One reference for the shader backend, one for the worker thread. */
+    cache->refcount = 2;
+    list_init(&cache->tasks);
+    wine_rb_init(&cache->entries, glsl_program_cache_entry_compare);
+    cache->size_limit = (UINT64)wined3d_settings.shader_cache_size << 20;
+    InitializeCriticalSection(&cache->cs);
+    cache->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": glsl_program_cache.cs");
+
+    if (!(cache->event = CreateEventW(NULL, FALSE, FALSE, NULL))
+            || !(cache->idle_event = CreateEventW(NULL, TRUE, FALSE, NULL)))
+    {
+        ERR("Failed to create program cache events.\n");
+        goto fail;
+    }
+
+    if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+            (const WCHAR *)glsl_program_cache_worker, &cache->wined3d_module))
+    {
+        ERR("Failed to get wined3d module handle.\n");
+        goto fail;
+    }
+    cache->module_hash = glsl_program_cache_get_module_hash(cache->wined3d_module);
+
+    glsl_program_cache_create_directory(wined3d_settings.shader_cache_path);
+    glsl_program_cache_index(cache);
+
+    if (!(cache->thread = CreateThread(NULL, 0, glsl_program_cache_worker, cache, 0, NULL)))
+    {
+        ERR("Failed to create program cache thread.\n");
+        FreeLibrary(cache->wined3d_module);
+        goto fail;
+    }
+
+    return cache;
+
+fail:
+    cache->refcount = 1;
+    glsl_program_cache_release(cache);
+    return NULL;
+}
+
+static void glsl_program_cache_destroy(struct glsl_program_cache *cache)
+{
+    LARGE_INTEGER freq;
+
+    EnterCriticalSection(&cache->cs);
+    cache->stop = TRUE;
+    LeaveCriticalSection(&cache->cs);
+    SetEvent(cache->event);
+
+    /* Give the worker a chance to write out the programs stored last. It
+     * can't finish if the process is exiting. */
+    if (!RtlIsCriticalSectionLockedByThread(NtCurrentTeb()->Peb->LoaderLock))
+        WaitForSingleObject(cache->idle_event, 5000);
+    CloseHandle(cache->thread);
+
+    /* Compare the hit time with the miss time, which covers generating,
+     * compiling and linking the shaders. */
+    QueryPerformanceFrequency(&freq);
+    EnterCriticalSection(&cache->cs);
+    TRACE("Program cache: %u hits in %s us, %u misses in %s us, %u stores, %u evictions.\n",
+            cache->hits, wine_dbgstr_longlong(cache->hit_time * 1000000 / freq.QuadPart),
+            cache->misses, wine_dbgstr_longlong(cache->miss_time * 1000000 / freq.QuadPart),
+            cache->stores, cache->evictions);
+    LeaveCriticalSection(&cache->cs);
+
+    glsl_program_cache_release(cache);
+}
+
+static void glsl_program_cache_add_time(LONGLONG *time, const LARGE_INTEGER *start)
+{
+    LARGE_INTEGER end;
+
+    QueryPerformanceCounter(&end);
+    *time += end.QuadPart - start->QuadPart;
+}
+
+/* Context activation is done by the caller. */
+static UINT64 glsl_program_cache_get_driver_hash(struct glsl_program_cache *cache,
+        const struct wined3d_context *context)
+{
+    static const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    const struct wined3d_d3d_info *d3d_info = context->d3d_info;
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    UINT64 hash = cache->module_hash;
+    const char *str;
+    unsigned int i;
+
+    if (cache->driver_hash_valid)
+        return cache->driver_hash;
+
+    for (i = 0; i < ARRAY_SIZE(names); ++i)
+    {
+        if ((str = (const char *)gl_info->gl_ops.gl.p_glGetString(names[i])))
+            hash = glsl_program_cache_hash(hash, str, strlen(str) + 1);
+    }
+
+    /* The generated GLSL depends on the capabilities and quirks wined3d
+     * detected, and on the settings that affect shader translation. */
+    hash = glsl_program_cache_hash(hash, &gl_info->selected_gl_version, sizeof(gl_info->selected_gl_version));
+    hash = glsl_program_cache_hash(hash, &gl_info->glsl_version, sizeof(gl_info->glsl_version));
+    hash = glsl_program_cache_hash(hash, &gl_info->limits, sizeof(gl_info->limits));
+    hash = glsl_program_cache_hash(hash, &gl_info->quirks, sizeof(gl_info->quirks));
+    hash = glsl_program_cache_hash(hash, gl_info->supported, sizeof(gl_info->supported));
+    hash = glsl_program_cache_hash(hash, &d3d_info->limits, sizeof(d3d_info->limits));
+    hash = glsl_program_cache_hash(hash, &d3d_info->wined3d_creation_flags,
+            sizeof(d3d_info->wined3d_creation_flags));
+    hash = glsl_program_cache_hash(hash, &wined3d_settings.check_float_constants,
+            sizeof(wined3d_settings.check_float_constants));
+
+    cache->driver_hash = hash;
+    cache->driver_hash_valid = TRUE;
+    return hash;
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_program_cache_init_key(struct shader_glsl_priv *priv,
+        const struct wined3d_context *context, struct glsl_program_cache_key *key)
+{
+    if (!priv->program_cache)
+        return FALSE;
+
+    memset(key, 0, sizeof(*key));
+    key->driver_hash = glsl_program_cache_get_driver_hash(priv->program_cache, context);
+    return TRUE;
+}
+
+static UINT64 shader_glsl_get_byte_code_hash(struct wined3d_shader *shader)
+{
+    struct glsl_shader_private *shader_data = shader->backend_data;
+
+    if (!shader_data->byte_code_hash_valid)
+    {
+        shader_data->byte_code_hash = glsl_program_cache_hash(GLSL_PROGRAM_CACHE_FNV_BASIS,
+                shader->byte_code, shader->byte_code_size);
+        shader_data->byte_code_hash_valid = TRUE;
+    }
+    return shader_data->byte_code_hash;
+}
+
+/* Adds the byte code of "shader" and the compile arguments of its GL shader
+ * "id" to the key. */
+static void shader_glsl_program_cache_key_add_shader(struct glsl_program_cache_key *key,
+        struct wined3d_shader *shader, GLuint id)
+{
+    enum wined3d_shader_type type = shader->reg_maps.shader_version.type;
+    struct glsl_shader_private *shader_data = shader->backend_data;
+    unsigned int i;
+
+    key->shaders[type].byte_code_hash = shader_glsl_get_byte_code_hash(shader);
+    key->shaders[type].byte_code_size = shader->byte_code_size;
+
+    for (i = 0; i < shader_data->num_gl_shaders; ++i)
+    {
+        switch (type)
+        {
+            case WINED3D_SHADER_TYPE_VERTEX:
+                if (shader_data->gl_shaders.vs[i].id == id)
+                    key->vs_args = shader_data->gl_shaders.vs[i].args;
+                break;
+
+            case WINED3D_SHADER_TYPE_DOMAIN:
+                if (shader_data->gl_shaders.ds[i].id == id)
+                    key->ds_args = shader_data->gl_shaders.ds[i].args;
+                break;
+
+            case WINED3D_SHADER_TYPE_GEOMETRY:
+                if (shader_data->gl_shaders.gs[i].id == id)
+                    key->gs_args = shader_data->gl_shaders.gs[i].args;
+                break;
+
+            case WINED3D_SHADER_TYPE_PIXEL:
+                if (shader_data->gl_shaders.ps[i].id == id)
+                    key->ps_args = shader_data->gl_shaders.ps[i].args;
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_program_cache_load(const struct wined3d_gl_info *gl_info, struct glsl_program_cache *cache,
+        GLuint program, const struct glsl_program_cache_key *key, UINT64 hash)
+{
+    struct glsl_program_cache_header header;
+    struct glsl_program_cache_entry *entry;
+    char filename[MAX_PATH];
+    struct wine_rb_entry *e;
+    LARGE_INTEGER start;
+    char *data = NULL;
+    BOOL ret = FALSE;
+    HANDLE file;
+    DWORD size;
+    GLint tmp;
+
+    QueryPerformanceCounter(&start);
+
+    EnterCriticalSection(&cache->cs);
+    if ((e = wine_rb_get(&cache->entries, &hash)))
+    {
+        entry = WINE_RB_ENTRY_VALUE(e, struct glsl_program_cache_entry, entry);
+        entry->last_use = glsl_program_cache_get_time();
+    }
+    LeaveCriticalSection(&cache->cs);
+    if (!e)
+    {
+        ++cache->misses;
+        return FALSE;
+    }
+
+    glsl_program_cache_get_filename(filename, sizeof(filename), hash);
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        goto done;
+
+    if (!ReadFile(file, &header, sizeof(header), &size, NULL) || size != sizeof(header)
+            || header.magic != GLSL_PROGRAM_CACHE_MAGIC || header.version != GLSL_PROGRAM_CACHE_VERSION
+            || header.key_size != sizeof(*key) || !header.binary_size || header.binary_size > ~0u - sizeof(*key))
+        goto done;
+
+    if (!(data = heap_alloc(sizeof(*key) + header.binary_size)))
+        goto done;
+    if (!ReadFile(file, data, sizeof(*key) + header.binary_size, &size, NULL)
+            || size != sizeof(*key) + header.binary_size || memcmp(data, key, sizeof(*key)))
+        goto done;
+
+    GL_EXTCALL(glProgramBinary(program, header.binary_format, data + sizeof(*key), header.binary_size));
+    GL_EXTCALL(glGetProgramiv(program, GL_LINK_STATUS, &tmp));
+    checkGLcall("load program binary");
+    ret = !!tmp;
+
+done:
+    heap_free(data);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+
+    if (!ret)
+    {
+        WARN("Discarding cached program binary %s.\n", debugstr_a(filename));
+        EnterCriticalSection(&cache->cs);
+        if ((e = wine_rb_get(&cache->entries, &hash)))
+            glsl_program_cache_remove_entry(cache,
+                    WINE_RB_ENTRY_VALUE(e, struct glsl_program_cache_entry, entry));
+        LeaveCriticalSection(&cache->cs);
+        glsl_program_cache_queue_simple_task(cache, GLSL_PROGRAM_CACHE_TASK_DELETE, hash);
+        ++cache->misses;
+        return FALSE;
+    }
+
+    TRACE("Loaded program %u from %s.\n", program, debugstr_a(filename));
+    glsl_program_cache_queue_simple_task(cache, GLSL_PROGRAM_CACHE_TASK_TOUCH, hash);
+    ++cache->hits;
+    glsl_program_cache_add_time(&cache->hit_time, &start);
+    return TRUE;
+}
+
+/* Context activation is done by the caller. Only retrieving the binary has
+ * to be done here, writing it out is left to the worker thread. */
+static void shader_glsl_program_cache_store(const struct wined3d_gl_info *gl_info, struct glsl_program_cache *cache,
+        GLuint program, const struct glsl_program_cache_key *key, UINT64 hash)
+{
+    struct glsl_program_cache_header *header;
+    struct glsl_program_cache_task *task;
+    GLenum binary_format;
+    GLint binary_size;
+    UINT32 size;
+
+    GL_EXTCALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size));
+    if (binary_size <= 0 || binary_size > ~0u - sizeof(*header) - sizeof(*key))
+        return;
+    size = sizeof(*header) + sizeof(*key) + binary_size;
+    if (!(task = heap_alloc(FIELD_OFFSET(struct glsl_program_cache_task, data[size]))))
+        return;
+
+    header = (struct glsl_program_cache_header *)task->data;
+    GL_EXTCALL(glGetProgramBinary(program, binary_size, &binary_size, &binary_format,
+            task->data + sizeof(*header) + sizeof(*key)));
+    checkGLcall("get program binary");
+
+    header->magic = GLSL_PROGRAM_CACHE_MAGIC;
+    header->version = GLSL_PROGRAM_CACHE_VERSION;
+    header->key_size = sizeof(*key);
+    header->binary_format = binary_format;
+    header->binary_size = binary_size;
+    header->reserved = 0;
+    memcpy(task->data + sizeof(*header), key, sizeof(*key));
+
+    task->type = GLSL_PROGRAM_CACHE_TASK_STORE;
+    task->hash = hash;
+    task->size = sizeof(*header) + sizeof(*key) + binary_size;
+    glsl_program_cache_queue_task(cache, task);
+}
+
+/* Work that has to wait until a program finished linking, because querying
+ * the program would block on a parallel link. */
+struct glsl_deferred_link
+{
+    BOOL cacheable;
+    struct glsl_program_cache_key key;
+    UINT64 hash;
+};
+
+/* Context activation is done by the caller. */
+static void shader_glsl_print_attached_shader_logs(const struct wined3d_gl_info *gl_info, GLuint program)
+{
+    GLuint shaders[WINED3D_SHADER_TYPE_COUNT];
+    GLsizei count, i;
+
+    if (!WARN_ON(d3d_shader) && !FIXME_ON(d3d_shader))
+        return;
+
+    GL_EXTCALL(glGetAttachedShaders(program, ARRAY_SIZE(shaders), &count, shaders));
+    for (i = 0; i < count; ++i)
+        print_glsl_info_log(gl_info, shaders[i], FALSE);
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_finish_link(const struct wined3d_gl_info *gl_info, struct shader_glsl_priv *priv,
+        GLuint program, const struct glsl_deferred_link *deferred)
+{
+    GLint status;
+
+    if (shader_glsl_use_async_compile(gl_info))
+        shader_glsl_print_attached_shader_logs(gl_info, program);
+    shader_glsl_validate_link(gl_info, program);
+
+    if (!deferred || !deferred->cacheable)
+        return;
+
+    GL_EXTCALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+    if (status)
+        shader_glsl_program_cache_store(gl_info, priv->program_cache, program, &deferred->key, deferred->hash);
+}
+
+/* Context activation is done by the caller. "key" is NULL for programs that
+ * can't be cached. If "deferred" is non-NULL and programs are linked in
+ * parallel, validation and storing the program in the cache are left to
+ * shader_glsl_finish_link(), which the caller has to call once the link
+ * completed. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info, struct shader_glsl_priv *priv,
+        GLuint program, const struct glsl_program_cache_key *key, UINT64 hash,
+        struct glsl_deferred_link **deferred)
+{
+    struct glsl_deferred_link d, *ret;
+
+    if (deferred)
+        *deferred = NULL;
+
+    if ((d.cacheable = !!key))
+    {
+        GL_EXTCALL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        d.key = *key;
+        d.hash = hash;
+    }
+
+    GL_EXTCALL(glLinkProgram(program));
+
+    if (deferred && shader_glsl_use_async_compile(gl_info) && (ret = heap_alloc(sizeof(*ret))))
+    {
+        *ret = d;
+        *deferred = ret;
+        return;
+    }
+
+    shader_glsl_finish_link(gl_info, priv, program, &d);
+}
+
 static BOOL shader_glsl_use_layout_qualifier(const struct wined3d_gl_info *gl_info)
 {
     /* Layout qualifiers were introduced in GLSL 1.40. The Nvidia Legacy GPU
@@ -7047,6 +7925,7 @@ static void delete_glsl_program_entry(struct shader_glsl_priv *priv, const struc
         list_remove(&entry->ps.shader_entry);
     if (entry->cs.id)
         list_remove(&entry->cs.shader_entry);
+    heap_free(entry->deferred_link);
     heap_free(entry);
 }
 
@@ -7776,8 +8655,8 @@ static void shader_glsl_generate_ps_epilogue(const struct wined3d_gl_info *gl_in
 /* Context activation is done by the caller. */
 static GLuint shader_glsl_generate_pshader(const struct wined3d_context *context,
         struct wined3d_string_buffer *buffer, struct wined3d_string_buffer_list *string_buffers,
-        const struct wined3d_shader *shader,
-        const struct ps_compile_args *args, struct ps_np2fixup_info *np2fixup_info)
+        const struct wined3d_shader *shader, const struct ps_compile_args *args,
+        const struct ps_np2fixup_info *np2fixup_info, GLuint shader_id)
 {
     const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
     const struct wined3d_shader_version *version = &reg_maps->shader_version;
@@ -7786,7 +8665,6 @@ static GLuint shader_glsl_generate_pshader(const struct wined3d_context *context
     const BOOL legacy_syntax = needs_legacy_glsl_syntax(gl_info);
     unsigned int i, extra_constants_needed = 0;
     struct shader_glsl_ctx_priv priv_ctx;
-    GLuint shader_id;
     DWORD map;
 
     memset(&priv_ctx, 0, sizeof(priv_ctx));
@@ -7833,33 +8711,7 @@ static GLuint shader_glsl_generate_pshader(const struct wined3d_context *context
      * series and when forcing the ARB_npot extension off. Modern cards just
      * skip the code anyway, so put it inside a separate loop. */
     if (args->np2_fixup)
-    {
-        struct ps_np2fixup_info *fixup = priv_ctx.cur_np2fixup_info;
-        unsigned int cur = 0;
-
-        /* NP2/RECT textures in OpenGL use texcoords in the range [0,width]x[0,height]
-         * while D3D has them in the (normalized) [0,1]x[0,1] range.
-         * samplerNP2Fixup stores texture dimensions and is updated through
-         * shader_glsl_load_np2fixup_constants when the sampler changes. */
-
-        for (i = 0; i < shader->limits->sampler; ++i)
-        {
-            if (!reg_maps->resource_info[i].type || !(args->np2_fixup & (1u << i)))
-                continue;
-
-            if (reg_maps->resource_info[i].type != WINED3D_SHADER_RESOURCE_TEXTURE_2D)
-            {
-                FIXME("Non-2D texture is flagged for NP2 texcoord fixup.\n");
-                continue;
-            }
-
-            fixup->idx[i] = cur++;
-        }
-
-        fixup->num_consts = (cur + 1) >> 1;
-        fixup->active = args->np2_fixup;
-        shader_addline(buffer, "uniform vec4 %s_samplerNP2Fixup[%u];\n", prefix, fixup->num_consts);
-    }
+        shader_addline(buffer, "uniform vec4 %s_samplerNP2Fixup[%u];\n", prefix, np2fixup_info->num_consts);
 
     if (version->major < 3 || args->vp_mode != WINED3D_VP_MODE_SHADER)
     {
@@ -8075,7 +8927,6 @@ static GLuint shader_glsl_generate_pshader(const struct wined3d_context *context
 
     shader_addline(buffer, "}\n");
 
-    shader_id = GL_EXTCALL(glCreateShader(GL_FRAGMENT_SHADER));
     TRACE("Compiling shader object %u.\n", shader_id);
     shader_glsl_compile(gl_info, shader_id, buffer->buffer);
 
@@ -8126,8 +8977,8 @@ static void shader_glsl_generate_vs_epilogue(const struct wined3d_gl_info *gl_in
 }
 
 /* Context activation is done by the caller. */
-static GLuint shader_glsl_generate_vshader(const struct wined3d_context *context,
-        struct shader_glsl_priv *priv, const struct wined3d_shader *shader, const struct vs_compile_args *args)
+static GLuint shader_glsl_generate_vshader(const struct wined3d_context *context, struct shader_glsl_priv *priv,
+        const struct wined3d_shader *shader, const struct vs_compile_args *args, GLuint shader_id)
 {
     struct wined3d_string_buffer_list *string_buffers = &priv->string_buffers;
     const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
@@ -8135,7 +8986,6 @@ static GLuint shader_glsl_generate_vshader(const struct wined3d_context *context
     struct wined3d_string_buffer *buffer = &priv->shader_buffer;
     const struct wined3d_gl_info *gl_info = context->gl_info;
     struct shader_glsl_ctx_priv priv_ctx;
-    GLuint shader_id;
     unsigned int i;
 
     memset(&priv_ctx, 0, sizeof(priv_ctx));
@@ -8213,7 +9063,6 @@ static GLuint shader_glsl_generate_vshader(const struct wined3d_context *context
 
     shader_addline(buffer, "}\n");
 
-    shader_id = GL_EXTCALL(glCreateShader(GL_VERTEX_SHADER));
     TRACE("Compiling shader object %u.\n", shader_id);
     shader_glsl_compile(gl_info, shader_id, buffer->buffer);
 
@@ -8270,7 +9119,7 @@ static void shader_glsl_generate_shader_phase_invocation(struct wined3d_string_b
 }
 
 static GLuint shader_glsl_generate_hull_shader(const struct wined3d_context *context,
-        struct shader_glsl_priv *priv, const struct wined3d_shader *shader)
+        struct shader_glsl_priv *priv, const struct wined3d_shader *shader, GLuint shader_id)
 {
     struct wined3d_string_buffer_list *string_buffers = &priv->string_buffers;
     const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
@@ -8279,7 +9128,6 @@ static GLuint shader_glsl_generate_hull_shader(const struct wined3d_context *con
     const struct wined3d_hull_shader *hs = &shader->u.hs;
     const struct wined3d_shader_phase *phase;
     struct shader_glsl_ctx_priv priv_ctx;
-    GLuint shader_id;
     unsigned int i;
 
     memset(&priv_ctx, 0, sizeof(priv_ctx));
@@ -8348,7 +9196,6 @@ static GLuint shader_glsl_generate_hull_shader(const struct wined3d_context *con
     shader_addline(buffer, "setup_patch_constant_output();\n");
     shader_addline(buffer, "}\n");
 
-    shader_id = GL_EXTCALL(glCreateShader(GL_TESS_CONTROL_SHADER));
     TRACE("Compiling shader object %u.\n", shader_id);
     shader_glsl_compile(gl_info, shader_id, buffer->buffer);
 
@@ -8365,15 +9212,14 @@ static void shader_glsl_generate_ds_epilogue(const struct wined3d_gl_info *gl_in
         shader_glsl_fixup_position(buffer, FALSE);
 }
 
-static GLuint shader_glsl_generate_domain_shader(const struct wined3d_context *context,
-        struct shader_glsl_priv *priv, const struct wined3d_shader *shader, const struct ds_compile_args *args)
+static GLuint shader_glsl_generate_domain_shader(const struct wined3d_context *context, struct shader_glsl_priv *priv,
+        const struct wined3d_shader *shader, const struct ds_compile_args *args, GLuint shader_id)
 {
     struct wined3d_string_buffer_list *string_buffers = &priv->string_buffers;
     const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
     struct wined3d_string_buffer *buffer = &priv->shader_buffer;
     const struct wined3d_gl_info *gl_info = context->gl_info;
     struct shader_glsl_ctx_priv priv_ctx;
-    GLuint shader_id;
 
     memset(&priv_ctx, 0, sizeof(priv_ctx));
     priv_ctx.cur_ds_args = args;
@@ -8451,7 +9297,6 @@ static GLuint shader_glsl_generate_domain_shader(const struct wined3d_context *c
 
     shader_addline(buffer, "}\n");
 
-    shader_id = GL_EXTCALL(glCreateShader(GL_TESS_EVALUATION_SHADER));
     TRACE("Compiling shader object %u.\n", shader_id);
     shader_glsl_compile(gl_info, shader_id, buffer->buffer);
 
@@ -8459,8 +9304,8 @@ static GLuint shader_glsl_generate_domain_shader(const struct wined3d_context *c
 }
 
 /* Context activation is done by the caller. */
-static GLuint shader_glsl_generate_geometry_shader(const struct wined3d_context *context,
-        struct shader_glsl_priv *priv, const struct wined3d_shader *shader, const struct gs_compile_args *args)
+static GLuint shader_glsl_generate_geometry_shader(const struct wined3d_context *context, struct shader_glsl_priv *priv,
+        const struct wined3d_shader *shader, const struct gs_compile_args *args, GLuint shader_id)
 {
     struct wined3d_string_buffer_list *string_buffers = &priv->string_buffers;
     const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
@@ -8471,7 +9316,6 @@ static GLuint shader_glsl_generate_geometry_shader(const struct wined3d_context
     struct shader_glsl_ctx_priv priv_ctx;
     unsigned int max_vertices;
     unsigned int i, j;
-    GLuint shader_id;
 
     memset(&priv_ctx, 0, sizeof(priv_ctx));
     priv_ctx.string_buffers = string_buffers;
@@ -8553,7 +9397,6 @@ static GLuint shader_glsl_generate_geometry_shader(const struct wined3d_context
     }
     shader_addline(buffer, "}\n");
 
-    shader_id = GL_EXTCALL(glCreateShader(GL_GEOMETRY_SHADER));
     TRACE("Compiling shader object %u.\n", shader_id);
     shader_glsl_compile(gl_info, shader_id, buffer->buffer);
 
@@ -8567,73 +9410,198 @@ static void shader_glsl_generate_shader_epilogue(const struct wined3d_shader_con
     struct wined3d_string_buffer *buffer = ctx->buffer;
     const struct wined3d_shader *shader = ctx->shader;
 
-    switch (shader->reg_maps.shader_version.type)
-    {
-        case WINED3D_SHADER_TYPE_PIXEL:
-            shader_glsl_generate_ps_epilogue(gl_info, buffer, shader, priv->cur_ps_args, priv->string_buffers);
-            break;
-        case WINED3D_SHADER_TYPE_VERTEX:
-            shader_glsl_generate_vs_epilogue(gl_info, buffer, shader, priv->cur_vs_args);
-            break;
-        case WINED3D_SHADER_TYPE_DOMAIN:
-            shader_glsl_generate_ds_epilogue(gl_info, buffer, shader, priv->cur_ds_args);
-            break;
-        case WINED3D_SHADER_TYPE_GEOMETRY:
-        case WINED3D_SHADER_TYPE_COMPUTE:
-            break;
-        default:
-            FIXME("Unhandled shader type %#x.\n", shader->reg_maps.shader_version.type);
-            break;
+    switch (shader->reg_maps.shader_version.type)
+    {
+        case WINED3D_SHADER_TYPE_PIXEL:
+            shader_glsl_generate_ps_epilogue(gl_info, buffer, shader, priv->cur_ps_args, priv->string_buffers);
+            break;
+        case WINED3D_SHADER_TYPE_VERTEX:
+            shader_glsl_generate_vs_epilogue(gl_info, buffer, shader, priv->cur_vs_args);
+            break;
+        case WINED3D_SHADER_TYPE_DOMAIN:
+            shader_glsl_generate_ds_epilogue(gl_info, buffer, shader, priv->cur_ds_args);
+            break;
+        case WINED3D_SHADER_TYPE_GEOMETRY:
+        case WINED3D_SHADER_TYPE_COMPUTE:
+            break;
+        default:
+            FIXME("Unhandled shader type %#x.\n", shader->reg_maps.shader_version.type);
+            break;
+    }
+}
+
+/* Context activation is done by the caller. */
+static GLuint shader_glsl_generate_compute_shader(const struct wined3d_context *context,
+        struct wined3d_string_buffer *buffer, struct wined3d_string_buffer_list *string_buffers,
+        const struct wined3d_shader *shader, GLuint shader_id)
+{
+    const struct wined3d_shader_thread_group_size *thread_group_size = &shader->u.cs.thread_group_size;
+    const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    struct shader_glsl_ctx_priv priv_ctx;
+    unsigned int i;
+
+    memset(&priv_ctx, 0, sizeof(priv_ctx));
+    priv_ctx.string_buffers = string_buffers;
+
+    shader_glsl_add_version_declaration(buffer, gl_info);
+
+    shader_glsl_enable_extensions(buffer, gl_info);
+    shader_addline(buffer, "#extension GL_ARB_compute_shader : enable\n");
+
+    shader_generate_glsl_declarations(context, buffer, shader, reg_maps, &priv_ctx);
+
+    for (i = 0; i < reg_maps->tgsm_count; ++i)
+    {
+        if (reg_maps->tgsm[i].size)
+            shader_addline(buffer, "shared uint cs_g%u[%u];\n", i, reg_maps->tgsm[i].size);
+    }
+
+    shader_addline(buffer, "layout(local_size_x = %u, local_size_y = %u, local_size_z = %u) in;\n",
+            thread_group_size->x, thread_group_size->y, thread_group_size->z);
+
+    shader_addline(buffer, "void main()\n{\n");
+    shader_generate_code(shader, buffer, reg_maps, &priv_ctx, NULL, NULL);
+    shader_addline(buffer, "}\n");
+
+    TRACE("Compiling shader object %u.\n", shader_id);
+    shader_glsl_compile(gl_info, shader_id, buffer->buffer);
+
+    return shader_id;
+}
+
+/* Context activation is done by the caller. Generates and compiles the GL
+ * shader "id" of "shader" if that was deferred. */
+static void shader_glsl_compile_pending_shader(const struct wined3d_context *context,
+        struct shader_glsl_priv *priv, struct wined3d_shader *shader, GLuint id)
+{
+    struct glsl_shader_private *shader_data = shader->backend_data;
+    struct wined3d_string_buffer *buffer = &priv->shader_buffer;
+    unsigned int i;
+
+    for (i = 0; i < shader_data->num_gl_shaders; ++i)
+    {
+        switch (shader->reg_maps.shader_version.type)
+        {
+            case WINED3D_SHADER_TYPE_PIXEL:
+            {
+                struct glsl_ps_compiled_shader *gl_shader = &shader_data->gl_shaders.ps[i];
+
+                if (gl_shader->id != id || !gl_shader->pending)
+                    break;
+                pixelshader_update_resource_types(shader, gl_shader->args.tex_types);
+                string_buffer_clear(buffer);
+                shader_glsl_generate_pshader(context, buffer, &priv->string_buffers, shader,
+                        &gl_shader->args, &gl_shader->np2fixup, id);
+                gl_shader->pending = FALSE;
+                break;
+            }
+
+            case WINED3D_SHADER_TYPE_VERTEX:
+            {
+                struct glsl_vs_compiled_shader *gl_shader = &shader_data->gl_shaders.vs[i];
+
+                if (gl_shader->id != id || !gl_shader->pending)
+                    break;
+                string_buffer_clear(buffer);
+                shader_glsl_generate_vshader(context, priv, shader, &gl_shader->args, id);
+                gl_shader->pending = FALSE;
+                break;
+            }
+
+            case WINED3D_SHADER_TYPE_HULL:
+            {
+                struct glsl_hs_compiled_shader *gl_shader = &shader_data->gl_shaders.hs[i];
+
+                if (gl_shader->id != id || !gl_shader->pending)
+                    break;
+                string_buffer_clear(buffer);
+                shader_glsl_generate_hull_shader(context, priv, shader, id);
+                gl_shader->pending = FALSE;
+                break;
+            }
+
+            case WINED3D_SHADER_TYPE_DOMAIN:
+            {
+                struct glsl_ds_compiled_shader *gl_shader = &shader_data->gl_shaders.ds[i];
+
+                if (gl_shader->id != id || !gl_shader->pending)
+                    break;
+                string_buffer_clear(buffer);
+                shader_glsl_generate_domain_shader(context, priv, shader, &gl_shader->args, id);
+                gl_shader->pending = FALSE;
+                break;
+            }
+
+            case WINED3D_SHADER_TYPE_GEOMETRY:
+            {
+                struct glsl_gs_compiled_shader *gl_shader = &shader_data->gl_shaders.gs[i];
+
+                if (gl_shader->id != id || !gl_shader->pending)
+                    break;
+                string_buffer_clear(buffer);
+                shader_glsl_generate_geometry_shader(context, priv, shader, &gl_shader->args, id);
+                gl_shader->pending = FALSE;
+                break;
+            }
+
+            case WINED3D_SHADER_TYPE_COMPUTE:
+            {
+                struct glsl_cs_compiled_shader *gl_shader = &shader_data->gl_shaders.cs[i];
+
+                if (gl_shader->id != id || !gl_shader->pending)
+                    break;
+                string_buffer_clear(buffer);
+                shader_glsl_generate_compute_shader(context, buffer, &priv->string_buffers, shader, id);
+                gl_shader->pending = FALSE;
+                break;
+            }
+
+            default:
+                FIXME("Unhandled shader type %#x.\n", shader->reg_maps.shader_version.type);
+                break;
+        }
     }
 }
 
-/* Context activation is done by the caller. */
-static GLuint shader_glsl_generate_compute_shader(const struct wined3d_context *context,
-        struct wined3d_string_buffer *buffer, struct wined3d_string_buffer_list *string_buffers,
-        const struct wined3d_shader *shader)
+static void shader_glsl_init_np2fixup_info(const struct wined3d_shader *shader,
+        const struct ps_compile_args *args, struct ps_np2fixup_info *fixup)
 {
-    const struct wined3d_shader_thread_group_size *thread_group_size = &shader->u.cs.thread_group_size;
     const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
-    const struct wined3d_gl_info *gl_info = context->gl_info;
-    struct shader_glsl_ctx_priv priv_ctx;
-    GLuint shader_id;
-    unsigned int i;
-
-    memset(&priv_ctx, 0, sizeof(priv_ctx));
-    priv_ctx.string_buffers = string_buffers;
+    unsigned int i, cur = 0;
 
-    shader_glsl_add_version_declaration(buffer, gl_info);
-
-    shader_glsl_enable_extensions(buffer, gl_info);
-    shader_addline(buffer, "#extension GL_ARB_compute_shader : enable\n");
+    memset(fixup, 0, sizeof(*fixup));
+    if (!args->np2_fixup)
+        return;
 
-    shader_generate_glsl_declarations(context, buffer, shader, reg_maps, &priv_ctx);
+    /* NP2/RECT textures in OpenGL use texcoords in the range [0,width]x[0,height]
+     * while D3D has them in the (normalized) [0,1]x[0,1] range.
+     * samplerNP2Fixup stores texture dimensions and is updated through
+     * shader_glsl_load_np2fixup_constants when the sampler changes. */
 
-    for (i = 0; i < reg_maps->tgsm_count; ++i)
+    for (i = 0; i < shader->limits->sampler; ++i)
     {
-        if (reg_maps->tgsm[i].size)
-            shader_addline(buffer, "shared uint cs_g%u[%u];\n", i, reg_maps->tgsm[i].size);
-    }
-
-    shader_addline(buffer, "layout(local_size_x = %u, local_size_y = %u, local_size_z = %u) in;\n",
-            thread_group_size->x, thread_group_size->y, thread_group_size->z);
+        if (!reg_maps->resource_info[i].type || !(args->np2_fixup & (1u << i)))
+            continue;
 
-    shader_addline(buffer, "void main()\n{\n");
-    shader_generate_code(shader, buffer, reg_maps, &priv_ctx, NULL, NULL);
-    shader_addline(buffer, "}\n");
+        if (reg_maps->resource_info[i].type != WINED3D_SHADER_RESOURCE_TEXTURE_2D)
+        {
+            FIXME("Non-2D texture is flagged for NP2 texcoord fixup.\n");
+            continue;
+        }
 
-    shader_id = GL_EXTCALL(glCreateShader(GL_COMPUTE_SHADER));
-    TRACE("Compiling shader object %u.\n", shader_id);
-    shader_glsl_compile(gl_info, shader_id, buffer->buffer);
+        fixup->idx[i] = cur++;
+    }
 
-    return shader_id;
+    fixup->num_consts = (cur + 1) >> 1;
+    fixup->active = args->np2_fixup;
 }
 
-static GLuint find_glsl_pshader(const struct wined3d_context *context,
-        struct wined3d_string_buffer *buffer, struct wined3d_string_buffer_list *string_buffers,
-        struct wined3d_shader *shader,
-        const struct ps_compile_args *args, const struct ps_np2fixup_info **np2fixup_info)
+static GLuint find_glsl_pshader(const struct wined3d_context *context, struct shader_glsl_priv *priv,
+        struct wined3d_shader *shader, const struct ps_compile_args *args,
+        const struct ps_np2fixup_info **np2fixup_info)
 {
+    const struct wined3d_gl_info *gl_info = context->gl_info;
     struct glsl_ps_compiled_shader *gl_shaders, *new_array;
     struct glsl_shader_private *shader_data;
     struct ps_np2fixup_info *np2fixup;
@@ -8692,14 +9660,16 @@ static GLuint find_glsl_pshader(const struct wined3d_context *context,
     gl_shaders[shader_data->num_gl_shaders].args = *args;
 
     np2fixup = &gl_shaders[shader_data->num_gl_shaders].np2fixup;
-    memset(np2fixup, 0, sizeof(*np2fixup));
     *np2fixup_info = args->np2_fixup ? np2fixup : NULL;
 
     pixelshader_update_resource_types(shader, args->tex_types);
+    shader_glsl_init_np2fixup_info(shader, args, np2fixup);
 
-    string_buffer_clear(buffer);
-    ret = shader_glsl_generate_pshader(context, buffer, string_buffers, shader, args, np2fixup);
-    gl_shaders[shader_data->num_gl_shaders++].id = ret;
+    ret = GL_EXTCALL(glCreateShader(GL_FRAGMENT_SHADER));
+    gl_shaders[shader_data->num_gl_shaders].id = ret;
+    gl_shaders[shader_data->num_gl_shaders++].pending = TRUE;
+    if (!priv->program_cache)
+        shader_glsl_compile_pending_shader(context, priv, shader, ret);
 
     return ret;
 }
@@ -8732,6 +9702,7 @@ static GLuint find_glsl_vshader(const struct wined3d_context *context, struct sh
     UINT i;
     DWORD new_size;
     DWORD use_map = context->stream_info.use_map;
+    const struct wined3d_gl_info *gl_info = context->gl_info;
     struct glsl_vs_compiled_shader *gl_shaders, *new_array;
     struct glsl_shader_private *shader_data;
     GLuint ret;
@@ -8783,9 +9754,11 @@ static GLuint find_glsl_vshader(const struct wined3d_context *context, struct sh
 
     gl_shaders[shader_data->num_gl_shaders].args = *args;
 
-    string_buffer_clear(&priv->shader_buffer);
-    ret = shader_glsl_generate_vshader(context, priv, shader, args);
-    gl_shaders[shader_data->num_gl_shaders++].id = ret;
+    ret = GL_EXTCALL(glCreateShader(GL_VERTEX_SHADER));
+    gl_shaders[shader_data->num_gl_shaders].id = ret;
+    gl_shaders[shader_data->num_gl_shaders++].pending = TRUE;
+    if (!priv->program_cache)
+        shader_glsl_compile_pending_shader(context, priv, shader, ret);
 
     return ret;
 }
@@ -8793,6 +9766,7 @@ static GLuint find_glsl_vshader(const struct wined3d_context *context, struct sh
 static GLuint find_glsl_hull_shader(const struct wined3d_context *context,
         struct shader_glsl_priv *priv, struct wined3d_shader *shader)
 {
+    const struct wined3d_gl_info *gl_info = context->gl_info;
     struct glsl_hs_compiled_shader *gl_shaders, *new_array;
     struct glsl_shader_private *shader_data;
     unsigned int new_size;
@@ -8828,9 +9802,11 @@ static GLuint find_glsl_hull_shader(const struct wined3d_context *context,
     shader_data->shader_array_size = new_size;
     gl_shaders = new_array;
 
-    string_buffer_clear(&priv->shader_buffer);
-    ret = shader_glsl_generate_hull_shader(context, priv, shader);
-    gl_shaders[shader_data->num_gl_shaders++].id = ret;
+    ret = GL_EXTCALL(glCreateShader(GL_TESS_CONTROL_SHADER));
+    gl_shaders[shader_data->num_gl_shaders].id = ret;
+    gl_shaders[shader_data->num_gl_shaders++].pending = TRUE;
+    if (!priv->program_cache)
+        shader_glsl_compile_pending_shader(context, priv, shader, ret);
 
     return ret;
 }
@@ -8838,6 +9814,7 @@ static GLuint find_glsl_hull_shader(const struct wined3d_context *context,
 static GLuint find_glsl_domain_shader(const struct wined3d_context *context,
         struct shader_glsl_priv *priv, struct wined3d_shader *shader, const struct ds_compile_args *args)
 {
+    const struct wined3d_gl_info *gl_info = context->gl_info;
     struct glsl_ds_compiled_shader *gl_shaders, *new_array;
     struct glsl_shader_private *shader_data;
     unsigned int i, new_size;
@@ -8882,10 +9859,12 @@ static GLuint find_glsl_domain_shader(const struct wined3d_context *context,
     shader_data->shader_array_size = new_size;
     gl_shaders = new_array;
 
-    string_buffer_clear(&priv->shader_buffer);
-    ret = shader_glsl_generate_domain_shader(context, priv, shader, args);
+    ret = GL_EXTCALL(glCreateShader(GL_TESS_EVALUATION_SHADER));
     gl_shaders[shader_data->num_gl_shaders].args = *args;
-    gl_shaders[shader_data->num_gl_shaders++].id = ret;
+    gl_shaders[shader_data->num_gl_shaders].id = ret;
+    gl_shaders[shader_data->num_gl_shaders++].pending = TRUE;
+    if (!priv->program_cache)
+        shader_glsl_compile_pending_shader(context, priv, shader, ret);
 
     return ret;
 }
@@ -8893,6 +9872,7 @@ static GLuint find_glsl_domain_shader(const struct wined3d_context *context,
 static GLuint find_glsl_geometry_shader(const struct wined3d_context *context,
         struct shader_glsl_priv *priv, struct wined3d_shader *shader, const struct gs_compile_args *args)
 {
+    const struct wined3d_gl_info *gl_info = context->gl_info;
     struct glsl_gs_compiled_shader *gl_shaders, *new_array;
     struct glsl_shader_private *shader_data;
     unsigned int i, new_size;
@@ -8937,10 +9917,12 @@ static GLuint find_glsl_geometry_shader(const struct wined3d_context *context,
     shader_data->shader_array_size = new_size;
     gl_shaders = new_array;
 
-    string_buffer_clear(&priv->shader_buffer);
-    ret = shader_glsl_generate_geometry_shader(context, priv, shader, args);
+    ret = GL_EXTCALL(glCreateShader(GL_GEOMETRY_SHADER));
     gl_shaders[shader_data->num_gl_shaders].args = *args;
-    gl_shaders[shader_data->num_gl_shaders++].id = ret;
+    gl_shaders[shader_data->num_gl_shaders].id = ret;
+    gl_shaders[shader_data->num_gl_shaders++].pending = TRUE;
+    if (!priv->program_cache)
+        shader_glsl_compile_pending_shader(context, priv, shader, ret);
 
     return ret;
 }
@@ -10226,12 +11208,15 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
         const struct wined3d_context *context, struct wined3d_shader *shader)
 {
     struct glsl_context_data *ctx_data = context->shader_backend_data;
-    struct wined3d_string_buffer *buffer = &priv->shader_buffer;
     const struct wined3d_gl_info *gl_info = context->gl_info;
+    struct glsl_program_cache_key cache_key;
     struct glsl_cs_compiled_shader *gl_shaders;
     struct glsl_shader_private *shader_data;
     struct glsl_shader_prog_link *entry;
     GLuint shader_id, program_id;
+    UINT64 cache_hash = 0;
+    LARGE_INTEGER start;
+    BOOL cacheable;
 
     if (!(entry = heap_alloc(sizeof(*entry))))
     {
@@ -10261,9 +11246,9 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
 
     TRACE("Compiling compute shader %p.\n", shader);
 
-    string_buffer_clear(buffer);
-    shader_id = shader_glsl_generate_compute_shader(context, buffer, &priv->string_buffers, shader);
-    gl_shaders[shader_data->num_gl_shaders++].id = shader_id;
+    shader_id = GL_EXTCALL(glCreateShader(GL_COMPUTE_SHADER));
+    gl_shaders[shader_data->num_gl_shaders].id = shader_id;
+    gl_shaders[shader_data->num_gl_shaders++].pending = TRUE;
 
     program_id = GL_EXTCALL(glCreateProgram());
     TRACE("Created new GLSL shader program %u.\n", program_id);
@@ -10277,18 +11262,34 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
     entry->cs.id = shader_id;
     entry->constant_version = 0;
     entry->shader_controlled_clip_distances = 0;
+    entry->link_pending = 0;
+    entry->deferred_link = NULL;
     entry->ps.np2_fixup_info = NULL;
     add_glsl_program_entry(priv, entry);
 
-    TRACE("Attaching GLSL shader object %u to program %u.\n", shader_id, program_id);
-    GL_EXTCALL(glAttachShader(program_id, shader_id));
-    checkGLcall("glAttachShader");
-
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    if ((cacheable = shader_glsl_program_cache_init_key(priv, context, &cache_key)))
+    {
+        QueryPerformanceCounter(&start);
+        shader_glsl_program_cache_key_add_shader(&cache_key, shader, shader_id);
+        cache_hash = glsl_program_cache_hash(GLSL_PROGRAM_CACHE_FNV_BASIS, &cache_key, sizeof(cache_key));
+    }
+
+    if (!cacheable || !shader_glsl_program_cache_load(gl_info, priv->program_cache,
+            program_id, &cache_key, cache_hash))
+    {
+        shader_glsl_compile_pending_shader(context, priv, shader, shader_id);
+
+        TRACE("Attaching GLSL shader object %u to program %u.\n", shader_id, program_id);
+        GL_EXTCALL(glAttachShader(program_id, shader_id));
+        checkGLcall("glAttachShader");
+
+        TRACE("Linking GLSL shader program %u.\n", program_id);
+        shader_glsl_link_program(gl_info, priv, program_id, cacheable ? &cache_key : NULL, cache_hash, NULL);
+        if (cacheable)
+            glsl_program_cache_add_time(&priv->program_cache->miss_time, &start);
+    }
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -10297,54 +11298,233 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
 
     entry->constant_update_mask = 0;
 
-    GL_EXTCALL(glUseProgram(ctx_data->glsl_program ? ctx_data->glsl_program->id : 0));
-    checkGLcall("glUseProgram");
-    return WINED3D_OK;
-}
+    GL_EXTCALL(glUseProgram(ctx_data->glsl_program ? ctx_data->glsl_program->id : 0));
+    checkGLcall("glUseProgram");
+    return WINED3D_OK;
+}
+
+static GLuint find_glsl_compute_shader(const struct wined3d_context *context,
+        struct shader_glsl_priv *priv, struct wined3d_shader *shader)
+{
+    struct glsl_shader_private *shader_data;
+
+    if (!shader->backend_data)
+    {
+        WARN("Failed to find GLSL program for compute shader %p.\n", shader);
+        if (FAILED(shader_glsl_compile_compute_shader(priv, context, shader)))
+        {
+            ERR("Failed to compile compute shader %p.\n", shader);
+            return 0;
+        }
+    }
+    shader_data = shader->backend_data;
+    return shader_data->gl_shaders.cs[0].id;
+}
+
+/* Context activation is done by the caller. */
+static void set_glsl_compute_shader_program(const struct wined3d_context *context,
+        const struct wined3d_state *state, struct shader_glsl_priv *priv, struct glsl_context_data *ctx_data)
+{
+    struct glsl_shader_prog_link *entry;
+    struct wined3d_shader *shader;
+    struct glsl_program_key key;
+    GLuint cs_id;
+
+    if (!(context->shader_update_mask & (1u << WINED3D_SHADER_TYPE_COMPUTE)))
+        return;
+
+    if (!(shader = state->shader[WINED3D_SHADER_TYPE_COMPUTE]))
+    {
+        WARN("Compute shader is NULL.\n");
+        ctx_data->glsl_program = NULL;
+        return;
+    }
+
+    cs_id = find_glsl_compute_shader(context, priv, shader);
+    memset(&key, 0, sizeof(key));
+    key.cs_id = cs_id;
+    if (!(entry = get_glsl_program_entry(priv, &key)))
+        ERR("Failed to find GLSL program for compute shader %p.\n", shader);
+    ctx_data->glsl_program = entry;
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_init_graphics_program(const struct wined3d_context *context,
+        struct shader_glsl_priv *priv, struct glsl_shader_prog_link *entry)
+{
+    struct wined3d_shader *vshader = entry->shaders[WINED3D_SHADER_TYPE_VERTEX];
+    struct wined3d_shader *hshader = entry->shaders[WINED3D_SHADER_TYPE_HULL];
+    struct wined3d_shader *dshader = entry->shaders[WINED3D_SHADER_TYPE_DOMAIN];
+    struct wined3d_shader *gshader = entry->shaders[WINED3D_SHADER_TYPE_GEOMETRY];
+    struct wined3d_shader *pshader = entry->shaders[WINED3D_SHADER_TYPE_PIXEL];
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    const struct wined3d_shader *pre_rasterization_shader;
+    GLuint program_id = entry->id;
+    unsigned int i;
+
+    shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
+            vshader ? vshader->limits->constant_float : 0);
+    shader_glsl_init_ds_uniform_locations(gl_info, priv, program_id, &entry->ds);
+    shader_glsl_init_gs_uniform_locations(gl_info, priv, program_id, &entry->gs);
+    shader_glsl_init_ps_uniform_locations(gl_info, priv, program_id, &entry->ps,
+            pshader ? pshader->limits->constant_float : 0);
+    checkGLcall("find glsl program uniform locations");
+
+    pre_rasterization_shader = gshader ? gshader : dshader ? dshader : vshader;
+    if (pre_rasterization_shader && pre_rasterization_shader->reg_maps.shader_version.major >= 4)
+    {
+        unsigned int clip_distance_count = wined3d_popcount(pre_rasterization_shader->reg_maps.clip_distance_mask);
+        entry->shader_controlled_clip_distances = 1;
+        entry->clip_distance_mask = (1u << clip_distance_count) - 1;
+    }
+
+    if (needs_legacy_glsl_syntax(gl_info))
+    {
+        if (pshader && pshader->reg_maps.shader_version.major >= 3
+                && pshader->u.ps.declared_in_count > vec4_varyings(3, gl_info))
+        {
+            TRACE("Shader %d needs vertex color clamping disabled.\n", program_id);
+            entry->vs.vertex_color_clamp = GL_FALSE;
+        }
+        else
+        {
+            entry->vs.vertex_color_clamp = GL_FIXED_ONLY_ARB;
+        }
+    }
+    else
+    {
+        /* With core profile we never change vertex_color_clamp from
+         * GL_FIXED_ONLY_MODE (which is also the initial value) so we never call
+         * glClampColorARB(). */
+        entry->vs.vertex_color_clamp = GL_FIXED_ONLY_ARB;
+    }
+
+    /* Set the shader to allow uniform loading on it */
+    GL_EXTCALL(glUseProgram(program_id));
+    checkGLcall("glUseProgram");
+
+    entry->constant_update_mask = 0;
+    if (vshader)
+    {
+        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_F;
+        if (vshader->reg_maps.integer_constants)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_I;
+        if (vshader->reg_maps.boolean_constants)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_B;
+        if (entry->vs.pos_fixup_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
+        if (entry->vs.base_vertex_id_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_BASE_VERTEX_ID;
+
+        shader_glsl_load_program_resources(context, priv, program_id, vshader);
+    }
+    else
+    {
+        entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_MODELVIEW
+                | WINED3D_SHADER_CONST_FFP_PROJ;
+
+        for (i = 1; i < MAX_VERTEX_BLENDS; ++i)
+        {
+            if (entry->vs.modelview_matrix_location[i] != -1)
+            {
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_VERTEXBLEND;
+                break;
+            }
+        }
+
+        for (i = 0; i < MAX_TEXTURES; ++i)
+        {
+            if (entry->vs.texture_matrix_location[i] != -1)
+            {
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_TEXMATRIX;
+                break;
+            }
+        }
+        if (entry->vs.material_ambient_location != -1 || entry->vs.material_diffuse_location != -1
+                || entry->vs.material_specular_location != -1
+                || entry->vs.material_emissive_location != -1
+                || entry->vs.material_shininess_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_MATERIAL;
+        if (entry->vs.light_ambient_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_LIGHTS;
+    }
+    if (entry->vs.clip_planes_location != -1)
+        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_CLIP_PLANES;
+    if (entry->vs.pointsize_min_location != -1)
+        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_POINTSIZE;
+
+    if (hshader)
+        shader_glsl_load_program_resources(context, priv, program_id, hshader);
+
+    if (dshader)
+    {
+        if (entry->ds.pos_fixup_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
+
+        shader_glsl_load_program_resources(context, priv, program_id, dshader);
+    }
+
+    if (gshader)
+    {
+        if (entry->gs.pos_fixup_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
+
+        shader_glsl_load_program_resources(context, priv, program_id, gshader);
+    }
+
+    if (entry->ps.id)
+    {
+        if (pshader)
+        {
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_F;
+            if (pshader->reg_maps.integer_constants)
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_I;
+            if (pshader->reg_maps.boolean_constants)
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_B;
+            if (entry->ps.ycorrection_location != -1)
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_Y_CORR;
+
+            shader_glsl_load_program_resources(context, priv, program_id, pshader);
+            shader_glsl_load_images(gl_info, priv, program_id, &pshader->reg_maps);
+        }
+        else
+        {
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_PS;
 
-static GLuint find_glsl_compute_shader(const struct wined3d_context *context,
-        struct shader_glsl_priv *priv, struct wined3d_shader *shader)
-{
-    struct glsl_shader_private *shader_data;
+            shader_glsl_load_samplers(context, priv, program_id, NULL);
+        }
 
-    if (!shader->backend_data)
-    {
-        WARN("Failed to find GLSL program for compute shader %p.\n", shader);
-        if (FAILED(shader_glsl_compile_compute_shader(priv, context, shader)))
+        for (i = 0; i < MAX_TEXTURES; ++i)
         {
-            ERR("Failed to compile compute shader %p.\n", shader);
-            return 0;
+            if (entry->ps.bumpenv_mat_location[i] != -1)
+            {
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_BUMP_ENV;
+                break;
+            }
         }
+
+        if (entry->ps.fog_color_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_FOG;
+        if (entry->ps.alpha_test_ref_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_ALPHA_TEST;
+        if (entry->ps.np2_fixup_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_NP2_FIXUP;
+        if (entry->ps.color_key_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_COLOR_KEY;
     }
-    shader_data = shader->backend_data;
-    return shader_data->gl_shaders.cs[0].id;
 }
 
 /* Context activation is done by the caller. */
-static void set_glsl_compute_shader_program(const struct wined3d_context *context,
-        const struct wined3d_state *state, struct shader_glsl_priv *priv, struct glsl_context_data *ctx_data)
+static BOOL shader_glsl_program_link_pending(const struct wined3d_gl_info *gl_info, GLuint program_id)
 {
-    struct glsl_shader_prog_link *entry;
-    struct wined3d_shader *shader;
-    struct glsl_program_key key;
-    GLuint cs_id;
+    GLint status;
 
-    if (!(context->shader_update_mask & (1u << WINED3D_SHADER_TYPE_COMPUTE)))
-        return;
-
-    if (!(shader = state->shader[WINED3D_SHADER_TYPE_COMPUTE]))
-    {
-        WARN("Compute shader is NULL.\n");
-        ctx_data->glsl_program = NULL;
-        return;
-    }
+    if (!shader_glsl_use_async_compile(gl_info))
+        return FALSE;
 
-    cs_id = find_glsl_compute_shader(context, priv, shader);
-    memset(&key, 0, sizeof(key));
-    key.cs_id = cs_id;
-    if (!(entry = get_glsl_program_entry(priv, &key)))
-        ERR("Failed to find GLSL program for compute shader %p.\n", shader);
-    ctx_data->glsl_program = entry;
+    GL_EXTCALL(glGetProgramiv(program_id, GL_COMPLETION_STATUS_ARB, &status));
+    checkGLcall("GL_COMPLETION_STATUS_ARB");
+    return !status;
 }
 
 /* Context activation is done by the caller. */
@@ -10353,14 +11533,17 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
 {
     const struct wined3d_d3d_info *d3d_info = context->d3d_info;
     const struct wined3d_gl_info *gl_info = context->gl_info;
-    const struct wined3d_shader *pre_rasterization_shader;
     const struct ps_np2fixup_info *np2fixup_info = NULL;
     struct wined3d_shader *hshader, *dshader, *gshader;
     struct glsl_shader_prog_link *entry = NULL;
     struct wined3d_shader *vshader = NULL;
     struct wined3d_shader *pshader = NULL;
+    struct glsl_program_cache_key cache_key;
+    BOOL cacheable, point_size, flatshading;
     GLuint reorder_shader_id = 0;
     struct glsl_program_key key;
+    UINT64 cache_hash = 0;
+    LARGE_INTEGER start;
     GLuint program_id;
     unsigned int i;
     GLuint vs_id = 0;
@@ -10452,8 +11635,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
         struct ps_compile_args ps_compile_args;
         pshader = state->shader[WINED3D_SHADER_TYPE_PIXEL];
         find_ps_compile_args(state, pshader, context->stream_info.position_transformed, &ps_compile_args, context);
-        ps_id = find_glsl_pshader(context, &priv->shader_buffer, &priv->string_buffers,
-                pshader, &ps_compile_args, &np2fixup_info);
+        ps_id = find_glsl_pshader(context, priv, pshader, &ps_compile_args, &np2fixup_info);
         ps_list = &pshader->linked_programs;
     }
     else if (priv->fragment_pipe == &glsl_fragment_pipe
@@ -10476,6 +11658,15 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     key.cs_id = 0;
     if ((!vs_id && !hs_id && !ds_id && !gs_id && !ps_id) || (entry = get_glsl_program_entry(priv, &key)))
     {
+        if (entry && entry->link_pending && !shader_glsl_program_link_pending(gl_info, entry->id))
+        {
+            TRACE("Program %u finished linking.\n", entry->id);
+            entry->link_pending = 0;
+            shader_glsl_finish_link(gl_info, priv, entry->id, entry->deferred_link);
+            heap_free(entry->deferred_link);
+            entry->deferred_link = NULL;
+            shader_glsl_init_graphics_program(context, priv, entry);
+        }
         ctx_data->glsl_program = entry;
         return;
     }
@@ -10496,20 +11687,77 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     entry->constant_version = 0;
     entry->shader_controlled_clip_distances = 0;
     entry->ps.np2_fixup_info = np2fixup_info;
+    entry->shaders[WINED3D_SHADER_TYPE_VERTEX] = vshader;
+    entry->shaders[WINED3D_SHADER_TYPE_HULL] = hshader;
+    entry->shaders[WINED3D_SHADER_TYPE_DOMAIN] = dshader;
+    entry->shaders[WINED3D_SHADER_TYPE_GEOMETRY] = gshader;
+    entry->shaders[WINED3D_SHADER_TYPE_PIXEL] = pshader;
+    entry->link_pending = 0;
+    entry->deferred_link = NULL;
     /* Add the hash table entry */
     add_glsl_program_entry(priv, entry);
 
     /* Set the current program */
     ctx_data->glsl_program = entry;
 
+    if (vs_id)
+        list_add_head(vs_list, &entry->vs.shader_entry);
+    if (hshader)
+        list_add_head(&hshader->linked_programs, &entry->hs.shader_entry);
+    if (dshader)
+        list_add_head(&dshader->linked_programs, &entry->ds.shader_entry);
+    if (gshader)
+        list_add_head(&gshader->linked_programs, &entry->gs.shader_entry);
+    if (ps_id)
+        list_add_head(ps_list, &entry->ps.shader_entry);
+
+    point_size = vshader && state->gl_primitive_type == GL_POINTS && vshader->reg_maps.point_size;
+    flatshading = d3d_info->emulated_flatshading
+            && state->render_states[WINED3D_RS_SHADEMODE] == WINED3D_SHADE_FLAT;
+
+    /* Programs using fixed function shaders or transform feedback aren't
+     * cached, the key doesn't describe them. */
+    if ((cacheable = shader_glsl_program_cache_init_key(priv, context, &cache_key)
+            && (!vs_id || vshader) && (!ps_id || pshader)
+            && (!gshader || !gshader->u.gs.so_desc.element_count)))
+    {
+        QueryPerformanceCounter(&start);
+        if (vshader)
+        {
+            shader_glsl_program_cache_key_add_shader(&cache_key, vshader, vs_id);
+            if (vshader->reg_maps.shader_version.major < 4)
+            {
+                if (point_size)
+                    cache_key.flags |= GLSL_PROGRAM_CACHE_POINT_SIZE;
+                if (flatshading)
+                    cache_key.flags |= GLSL_PROGRAM_CACHE_FLATSHADING;
+            }
+        }
+        if (hshader)
+            shader_glsl_program_cache_key_add_shader(&cache_key, hshader, hs_id);
+        if (dshader)
+            shader_glsl_program_cache_key_add_shader(&cache_key, dshader, ds_id);
+        if (gshader)
+            shader_glsl_program_cache_key_add_shader(&cache_key, gshader, gs_id);
+        if (pshader && ps_id)
+            shader_glsl_program_cache_key_add_shader(&cache_key, pshader, ps_id);
+        cache_hash = glsl_program_cache_hash(GLSL_PROGRAM_CACHE_FNV_BASIS, &cache_key, sizeof(cache_key));
+
+        if (shader_glsl_program_cache_load(gl_info, priv->program_cache, program_id, &cache_key, cache_hash))
+        {
+            shader_glsl_init_graphics_program(context, priv, entry);
+            return;
+        }
+    }
+
     /* Attach GLSL vshader */
     if (vs_id)
     {
+        if (vshader)
+            shader_glsl_compile_pending_shader(context, priv, vshader, vs_id);
         TRACE("Attaching GLSL shader object %u to program %u.\n", vs_id, program_id);
         GL_EXTCALL(glAttachShader(program_id, vs_id));
         checkGLcall("glAttachShader");
-
-        list_add_head(vs_list, &entry->vs.shader_entry);
     }
 
     if (vshader)
@@ -10518,9 +11766,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
         if (vshader->reg_maps.shader_version.major < 4)
         {
             reorder_shader_id = shader_glsl_generate_vs3_rasterizer_input_setup(priv, vshader, pshader,
-                    state->gl_primitive_type == GL_POINTS && vshader->reg_maps.point_size,
-                    d3d_info->emulated_flatshading
-                    && state->render_states[WINED3D_RS_SHADEMODE] == WINED3D_SHADE_FLAT, gl_info);
+                    point_size, flatshading, gl_info);
             TRACE("Attaching GLSL shader object %u to program %u.\n", reorder_shader_id, program_id);
             GL_EXTCALL(glAttachShader(program_id, reorder_shader_id));
             checkGLcall("glAttachShader");
@@ -10577,198 +11823,62 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
 
     if (hshader)
     {
+        shader_glsl_compile_pending_shader(context, priv, hshader, hs_id);
         TRACE("Attaching GLSL tessellation control shader object %u to program %u.\n", hs_id, program_id);
         GL_EXTCALL(glAttachShader(program_id, hs_id));
         checkGLcall("glAttachShader");
-
-        list_add_head(&hshader->linked_programs, &entry->hs.shader_entry);
     }
 
     if (dshader)
     {
+        shader_glsl_compile_pending_shader(context, priv, dshader, ds_id);
         TRACE("Attaching GLSL tessellation evaluation shader object %u to program %u.\n", ds_id, program_id);
         GL_EXTCALL(glAttachShader(program_id, ds_id));
         checkGLcall("glAttachShader");
-
-        list_add_head(&dshader->linked_programs, &entry->ds.shader_entry);
     }
 
     if (gshader)
     {
+        shader_glsl_compile_pending_shader(context, priv, gshader, gs_id);
         TRACE("Attaching GLSL geometry shader object %u to program %u.\n", gs_id, program_id);
         GL_EXTCALL(glAttachShader(program_id, gs_id));
         checkGLcall("glAttachShader");
 
         shader_glsl_init_transform_feedback(context, priv, program_id, gshader);
-
-        list_add_head(&gshader->linked_programs, &entry->gs.shader_entry);
     }
 
     /* Attach GLSL pshader */
     if (ps_id)
     {
+        if (pshader)
+            shader_glsl_compile_pending_shader(context, priv, pshader, ps_id);
         TRACE("Attaching GLSL shader object %u to program %u.\n", ps_id, program_id);
         GL_EXTCALL(glAttachShader(program_id, ps_id));
         checkGLcall("glAttachShader");
-
-        list_add_head(ps_list, &entry->ps.shader_entry);
     }
 
-    /* Link the program */
     TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
-
-    shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
-            vshader ? vshader->limits->constant_float : 0);
-    shader_glsl_init_ds_uniform_locations(gl_info, priv, program_id, &entry->ds);
-    shader_glsl_init_gs_uniform_locations(gl_info, priv, program_id, &entry->gs);
-    shader_glsl_init_ps_uniform_locations(gl_info, priv, program_id, &entry->ps,
-            pshader ? pshader->limits->constant_float : 0);
-    checkGLcall("find glsl program uniform locations");
-
-    pre_rasterization_shader = gshader ? gshader : dshader ? dshader : vshader;
-    if (pre_rasterization_shader && pre_rasterization_shader->reg_maps.shader_version.major >= 4)
-    {
-        unsigned int clip_distance_count = wined3d_popcount(pre_rasterization_shader->reg_maps.clip_distance_mask);
-        entry->shader_controlled_clip_distances = 1;
-        entry->clip_distance_mask = (1u << clip_distance_count) - 1;
-    }
-
-    if (needs_legacy_glsl_syntax(gl_info))
-    {
-        if (pshader && pshader->reg_maps.shader_version.major >= 3
-                && pshader->u.ps.declared_in_count > vec4_varyings(3, gl_info))
-        {
-            TRACE("Shader %d needs vertex color clamping disabled.\n", program_id);
-            entry->vs.vertex_color_clamp = GL_FALSE;
-        }
-        else
-        {
-            entry->vs.vertex_color_clamp = GL_FIXED_ONLY_ARB;
-        }
-    }
-    else
-    {
-        /* With core profile we never change vertex_color_clamp from
-         * GL_FIXED_ONLY_MODE (which is also the initial value) so we never call
-         * glClampColorARB(). */
-        entry->vs.vertex_color_clamp = GL_FIXED_ONLY_ARB;
-    }
-
-    /* Set the shader to allow uniform loading on it */
-    GL_EXTCALL(glUseProgram(program_id));
-    checkGLcall("glUseProgram");
-
-    entry->constant_update_mask = 0;
-    if (vshader)
-    {
-        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_F;
-        if (vshader->reg_maps.integer_constants)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_I;
-        if (vshader->reg_maps.boolean_constants)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_B;
-        if (entry->vs.pos_fixup_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
-        if (entry->vs.base_vertex_id_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_BASE_VERTEX_ID;
-
-        shader_glsl_load_program_resources(context, priv, program_id, vshader);
-    }
-    else
-    {
-        entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_MODELVIEW
-                | WINED3D_SHADER_CONST_FFP_PROJ;
-
-        for (i = 1; i < MAX_VERTEX_BLENDS; ++i)
-        {
-            if (entry->vs.modelview_matrix_location[i] != -1)
-            {
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_VERTEXBLEND;
-                break;
-            }
-        }
-
-        for (i = 0; i < MAX_TEXTURES; ++i)
-        {
-            if (entry->vs.texture_matrix_location[i] != -1)
-            {
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_TEXMATRIX;
-                break;
-            }
-        }
-        if (entry->vs.material_ambient_location != -1 || entry->vs.material_diffuse_location != -1
-                || entry->vs.material_specular_location != -1
-                || entry->vs.material_emissive_location != -1
-                || entry->vs.material_shininess_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_MATERIAL;
-        if (entry->vs.light_ambient_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_LIGHTS;
-    }
-    if (entry->vs.clip_planes_location != -1)
-        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_CLIP_PLANES;
-    if (entry->vs.pointsize_min_location != -1)
-        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_POINTSIZE;
+    shader_glsl_link_program(gl_info, priv, program_id, cacheable ? &cache_key : NULL, cache_hash,
+            &entry->deferred_link);
+    if (cacheable)
+        glsl_program_cache_add_time(&priv->program_cache->miss_time, &start);
 
-    if (hshader)
-        shader_glsl_load_program_resources(context, priv, program_id, hshader);
-
-    if (dshader)
-    {
-        if (entry->ds.pos_fixup_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
-
-        shader_glsl_load_program_resources(context, priv, program_id, dshader);
-    }
-
-    if (gshader)
+    /* With parallel shader compilation the driver links in the background,
+     * and querying the program would block until it is done. */
+    if (shader_glsl_program_link_pending(gl_info, program_id))
     {
-        if (entry->gs.pos_fixup_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
-
-        shader_glsl_load_program_resources(context, priv, program_id, gshader);
+        TRACE("Program %u is still being linked.\n", program_id);
+        entry->link_pending = 1;
+        return;
     }
 
-    if (ps_id)
+    if (entry->deferred_link)
     {
-        if (pshader)
-        {
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_F;
-            if (pshader->reg_maps.integer_constants)
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_I;
-            if (pshader->reg_maps.boolean_constants)
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_B;
-            if (entry->ps.ycorrection_location != -1)
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_Y_CORR;
-
-            shader_glsl_load_program_resources(context, priv, program_id, pshader);
-            shader_glsl_load_images(gl_info, priv, program_id, &pshader->reg_maps);
-        }
-        else
-        {
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_PS;
-
-            shader_glsl_load_samplers(context, priv, program_id, NULL);
-        }
-
-        for (i = 0; i < MAX_TEXTURES; ++i)
-        {
-            if (entry->ps.bumpenv_mat_location[i] != -1)
-            {
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_BUMP_ENV;
-                break;
-            }
-        }
-
-        if (entry->ps.fog_color_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_FOG;
-        if (entry->ps.alpha_test_ref_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_ALPHA_TEST;
-        if (entry->ps.np2_fixup_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_NP2_FIXUP;
-        if (entry->ps.color_key_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_COLOR_KEY;
+        shader_glsl_finish_link(gl_info, priv, program_id, entry->deferred_link);
+        heap_free(entry->deferred_link);
+        entry->deferred_link = NULL;
     }
+    shader_glsl_init_graphics_program(context, priv, entry);
 }
 
 static void shader_glsl_precompile(void *shader_priv, struct wined3d_shader *shader)
@@ -10791,17 +11901,28 @@ static void shader_glsl_select(void *shader_priv, struct wined3d_context *contex
     struct glsl_context_data *ctx_data = context->shader_backend_data;
     const struct wined3d_gl_info *gl_info = context->gl_info;
     struct shader_glsl_priv *priv = shader_priv;
-    struct glsl_shader_prog_link *glsl_program;
+    struct glsl_shader_prog_link *glsl_program, *prev_program;
     GLenum current_vertex_color_clamp;
     GLuint program_id, prev_id;
 
     priv->vertex_pipe->vp_enable(gl_info, !use_vs(state));
     priv->fragment_pipe->enable_extension(gl_info, !use_ps(state));
 
-    prev_id = ctx_data->glsl_program ? ctx_data->glsl_program->id : 0;
+    prev_program = ctx_data->glsl_program;
+    prev_id = prev_program ? prev_program->id : 0;
     set_glsl_shader_program(context, state, priv, ctx_data);
     glsl_program = ctx_data->glsl_program;
 
+    if (glsl_program && glsl_program->link_pending)
+    {
+        /* Keep the previous program bound; the draw will be skipped and the
+         * program looked up again by the next one. */
+        TRACE("GLSL program %u is not ready yet.\n", glsl_program->id);
+        ctx_data->glsl_program = prev_program;
+        context->shader_compile_pending = 1;
+        return;
+    }
+
     if (glsl_program)
     {
         program_id = glsl_program->id;
@@ -11212,6 +12333,7 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
     fragment_pipe->get_caps(gl_info, &fragment_caps);
     priv->ffp_proj_control = fragment_caps.wined3d_caps & WINED3D_FRAGMENT_CAP_PROJ_CONTROL;
     priv->legacy_lighting = device->wined3d->flags & WINED3D_LEGACY_FFP_LIGHTING;
+    priv->program_cache = glsl_program_cache_create(gl_info);
 
     device->vertex_priv = vertex_priv;
     device->fragment_priv = fragment_priv;
@@ -11235,6 +12357,8 @@ static void shader_glsl_free(struct wined3d_device *device)
 {
     struct shader_glsl_priv *priv = device->shader_priv;
 
+    if (priv->program_cache)
+        glsl_program_cache_destroy(priv->program_cache);
     wine_rb_destroy(&priv->program_lookup, NULL, NULL);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
@@ -11270,6 +12394,12 @@ static void shader_glsl_init_context_state(struct wined3d_context *context)
 
     gl_info->gl_ops.gl.p_glEnable(GL_PROGRAM_POINT_SIZE);
     checkGLcall("GL_PROGRAM_POINT_SIZE");
+
+    if (shader_glsl_use_async_compile(gl_info))
+    {
+        GL_EXTCALL(glMaxShaderCompilerThreadsARB(~0u));
+        checkGLcall("glMaxShaderCompilerThreadsARB");
+    }
 }
 
 static unsigned int shader_glsl_get_shader_model(const struct wined3d_gl_info *gl_info)
@@ -90,6 +90,9 @@ struct wined3d_settings wined3d_settings =
     ~0U,            /* No PS shader model limit by default. */
     ~0u,            /* No CS shader model limit by default. */
     FALSE,          /* 3D support enabled by default. */
+    NULL,           /* Default shader cache path is set in wined3d_dll_init. */
+    128,            /* Limit the shader cache to 128 MiB. */
+    FALSE,          /* Compile shaders synchronously by default. */
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -142,6 +145,23 @@ success:
     return 0;
 }
 
+static char *get_default_shader_cache_path(void)
+{
+    static const char suffix[] = "\\wine\\wined3d";
+    char buffer[MAX_PATH];
+    DWORD len;
+    char *path;
+
+    len = GetEnvironmentVariableA("LOCALAPPDATA", buffer, ARRAY_SIZE(buffer));
+    if (!len || len + sizeof(suffix) > ARRAY_SIZE(buffer))
+        return NULL;
+    if (!(path = heap_alloc(len + sizeof(suffix))))
+        return NULL;
+    memcpy(path, buffer, len);
+    memcpy(path + len, suffix, sizeof(suffix));
+    return path;
+}
+
 static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
 {
     DWORD wined3d_context_tls_idx;
@@ -150,6 +170,7 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
     HKEY hkey = 0;
     HKEY appkey = 0;
     DWORD len, tmpvalue;
+    BOOL shader_cache = FALSE;
     WNDCLASSA wc;
 
     wined3d_context_tls_idx = TlsAlloc();
@@ -312,7 +333,32 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             TRACE("Disabling 3D support.\n");
             wined3d_settings.no_3d = TRUE;
         }
+        if (!get_config_key(hkey, appkey, "ShaderCache", buffer, size) && !strcmp(buffer, "enabled"))
+        {
+            TRACE("Enabling the shader cache.\n");
+            shader_cache = TRUE;
+        }
+        if (shader_cache && !get_config_key(hkey, appkey, "ShaderCachePath", buffer, size))
+        {
+            size_t len = strlen(buffer) + 1;
+
+            if (!(wined3d_settings.shader_cache_path = heap_alloc(len)))
+                ERR("Failed to allocate shader cache path memory.\n");
+            else
+                memcpy(wined3d_settings.shader_cache_path, buffer, len);
+        }
+        if (shader_cache && !get_config_key_dword(hkey, appkey, "ShaderCacheSize",
+                &wined3d_settings.shader_cache_size))
+            TRACE("Limiting the shader cache to %u MiB.\n", wined3d_settings.shader_cache_size);
+        if (!get_config_key(hkey, appkey, "AsyncShaderCompile", buffer, size) && !strcmp(buffer, "enabled"))
+        {
+            TRACE("Skipping draws while their shaders are being compiled.\n");
+            wined3d_settings.async_shader_compile = TRUE;
+        }
     }
+    if (shader_cache && !wined3d_settings.shader_cache_path)
+        wined3d_settings.shader_cache_path = get_default_shader_cache_path();
+    TRACE("Shader cache path %s.\n", debugstr_a(wined3d_settings.shader_cache_path));
 
     if (appkey) RegCloseKey( appkey );
     if (hkey) RegCloseKey( hkey );
@@ -344,6 +390,7 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     heap_free(wndproc_table.entries);
 
     heap_free(wined3d_settings.logo);
+    heap_free(wined3d_settings.shader_cache_path);
     UnregisterClassA(WINED3D_OPENGL_WINDOW_CLASS_NAME, hInstDLL);
 
     DeleteCriticalSection(&wined3d_wndproc_cs);
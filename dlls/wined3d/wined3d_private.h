@@ -398,6 +398,9 @@ struct wined3d_settings
     unsigned int max_sm_ps;
     unsigned int max_sm_cs;
     BOOL no_3d;
+    char *shader_cache_path;
+    unsigned int shader_cache_size;
+    BOOL async_shader_compile;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
@@ -1707,6 +1710,8 @@ struct wined3d_fence
 HRESULT wined3d_fence_create(struct wined3d_device *device, struct wined3d_fence **fence) DECLSPEC_HIDDEN;
 void wined3d_fence_destroy(struct wined3d_fence *fence) DECLSPEC_HIDDEN;
 void wined3d_fence_issue(struct wined3d_fence *fence, const struct wined3d_device *device) DECLSPEC_HIDDEN;
+enum wined3d_fence_result wined3d_fence_test(const struct wined3d_fence *fence,
+        const struct wined3d_device *device, DWORD flags) DECLSPEC_HIDDEN;
 enum wined3d_fence_result wined3d_fence_wait(const struct wined3d_fence *fence,
         const struct wined3d_device *device) DECLSPEC_HIDDEN;
 
@@ -1920,7 +1925,8 @@ struct wined3d_context
     DWORD shader_update_mask : 6; /* WINED3D_SHADER_TYPE_COUNT, 6 */
     DWORD clip_distance_mask : 8; /* MAX_CLIP_DISTANCES, 8 */
     DWORD num_untracked_materials : 2;  /* Max value 2 */
-    DWORD padding : 7;
+    DWORD shader_compile_pending : 1;
+    DWORD padding : 6;
 
     DWORD constant_update_mask;
     DWORD numbered_array_mask;
@@ -3614,6 +3620,35 @@ struct wined3d_cs_queue
     BYTE data[WINED3D_CS_QUEUE_SIZE];
 };
 
+enum wined3d_state_group
+{
+    WINED3D_STATE_GROUP_RENDER,
+    WINED3D_STATE_GROUP_TEXTURE,
+    WINED3D_STATE_GROUP_SAMPLER,
+    WINED3D_STATE_GROUP_TRANSFORM,
+    WINED3D_STATE_GROUP_VIEWPORT,
+    WINED3D_STATE_GROUP_SCISSOR,
+    WINED3D_STATE_GROUP_COUNT,
+};
+
+struct wined3d_state_stats
+{
+    unsigned int draw_count;
+    unsigned int delta_count;
+    unsigned int changed[WINED3D_STATE_GROUP_COUNT];
+    unsigned int redundant[WINED3D_STATE_GROUP_COUNT];
+};
+
+#define WINED3D_CS_MAX_PENDING_STATES 32
+
+struct wined3d_cs_state_change
+{
+    enum wined3d_state_group group;
+    unsigned int idx;
+    unsigned int state;
+    DWORD value;
+};
+
 struct wined3d_cs_ops
 {
     void *(*require_space)(struct wined3d_cs *cs, size_t size, enum wined3d_cs_queue_id queue_id);
@@ -3642,6 +3677,16 @@ struct wined3d_cs
     HANDLE event;
     BOOL waiting_for_event;
     LONG pending_presents;
+
+    /* Render, texture stage and sampler states are sent to the worker
+     * thread in batches, right before the next command that needs them. */
+    struct wined3d_cs_state_change pending_states[WINED3D_CS_MAX_PENDING_STATES];
+    unsigned int pending_state_count;
+    struct wined3d_state_stats stats;
+
+    /* Draws skipped because their shaders were still being compiled. */
+    unsigned int compile_skipped_draws;
+    unsigned int compile_stalled_frames;
 };
 
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device) DECLSPEC_HIDDEN;
@@ -3673,6 +3718,7 @@ void wined3d_cs_emit_draw_indirect(struct wined3d_cs *cs, GLenum primitive_type,
         struct wined3d_buffer *buffer, unsigned int offset, BOOL indexed) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_flush(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_generate_mipmaps(struct wined3d_cs *cs, struct wined3d_shader_resource_view *view) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_pending_states(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_preload_resource(struct wined3d_cs *cs, struct wined3d_resource *resource) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *swapchain, const RECT *src_rect,
         const RECT *dst_rect, HWND dst_window_override, unsigned int swap_interval, DWORD flags) DECLSPEC_HIDDEN;
@@ -3740,6 +3786,8 @@ HRESULT wined3d_cs_unmap(struct wined3d_cs *cs, struct wined3d_resource *resourc
 
 static inline void wined3d_cs_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
 {
+    if (cs->pending_state_count)
+        wined3d_cs_emit_pending_states(cs);
     cs->ops->finish(cs, queue_id);
 }
 
@@ -3769,6 +3817,12 @@ enum wined3d_buffer_conversion_type
     CONV_POSITIONT,
 };
 
+struct wined3d_buffer_conversion
+{
+    unsigned int offset, size;
+    void (*convert)(BYTE *data, unsigned int stride, unsigned int count);
+};
+
 struct wined3d_map_range
 {
     UINT offset;
@@ -3794,6 +3848,8 @@ struct wined3d_buffer
     UINT stride;                                            /* 0 if no conversion */
     enum wined3d_buffer_conversion_type *conversion_map;    /* NULL if no conversion */
     UINT conversion_stride;                                 /* 0 if no shifted conversion */
+    struct wined3d_buffer_conversion *conversions;          /* Decoded from conversion_map on upload. */
+    SIZE_T conversions_size;
 };
 
 static inline struct wined3d_buffer *buffer_from_resource(struct wined3d_resource *resource)
@@ -3821,6 +3877,9 @@ struct wined3d_buffer_gl
     GLuint buffer_object;
     GLenum buffer_object_usage;
     GLenum buffer_type_hint;
+
+    /* Persistently mapped buffer objects for dynamic buffers. */
+    struct wined3d_buffer_gl_stream *stream;
 };
 
 static inline struct wined3d_buffer_gl *wined3d_buffer_gl(struct wined3d_buffer *buffer)
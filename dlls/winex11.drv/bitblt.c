@@ -1067,10 +1067,11 @@ static inline BOOL image_needs_byteswap( XImage *image, BOOL is_r8g8b8, int bit_
 
 /* copy image bits with byte swapping and/or pixel mapping */
 static void copy_image_byteswap( BITMAPINFO *info, const unsigned char *src, unsigned char *dst,
-                                 int src_stride, int dst_stride, int height, BOOL byteswap,
+                                 int src_stride, int dst_stride, int width, int height, BOOL byteswap,
                                  const int *mapping, unsigned int zeropad_mask, unsigned int alpha_bits )
 {
     int x, y, padding_pos = abs(dst_stride) / sizeof(unsigned int) - 1;
+    int width_bytes = (width * info->bmiHeader.biBitCount + 7) / 8;
 
     if (!byteswap && !mapping)  /* simply copy */
     {
@@ -1078,8 +1079,8 @@ static void copy_image_byteswap( BITMAPINFO *info, const unsigned char *src, uns
         {
             for (y = 0; y < height; y++, src += src_stride, dst += dst_stride)
             {
-                memcpy( dst, src, src_stride );
-                ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
+                memcpy( dst, src, width_bytes );
+                if (zeropad_mask != ~0u) ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
             }
         }
         else if (zeropad_mask != ~0u)  /* only need to clear the padding */
@@ -1095,8 +1096,8 @@ static void copy_image_byteswap( BITMAPINFO *info, const unsigned char *src, uns
     case 1:
         for (y = 0; y < height; y++, src += src_stride, dst += dst_stride)
         {
-            for (x = 0; x < src_stride; x++) dst[x] = bit_swap[src[x]];
-            ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
+            for (x = 0; x < width_bytes; x++) dst[x] = bit_swap[src[x]];
+            if (zeropad_mask != ~0u) ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
         }
         break;
     case 4:
@@ -1105,49 +1106,49 @@ static void copy_image_byteswap( BITMAPINFO *info, const unsigned char *src, uns
             if (mapping)
             {
                 if (byteswap)
-                    for (x = 0; x < src_stride; x++)
+                    for (x = 0; x < width_bytes; x++)
                         dst[x] = (mapping[src[x] & 0x0f] << 4) | mapping[src[x] >> 4];
                 else
-                    for (x = 0; x < src_stride; x++)
+                    for (x = 0; x < width_bytes; x++)
                         dst[x] = mapping[src[x] & 0x0f] | (mapping[src[x] >> 4] << 4);
             }
             else
-                for (x = 0; x < src_stride; x++)
+                for (x = 0; x < width_bytes; x++)
                     dst[x] = (src[x] << 4) | (src[x] >> 4);
-            ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
+            if (zeropad_mask != ~0u) ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
         }
         break;
     case 8:
         for (y = 0; y < height; y++, src += src_stride, dst += dst_stride)
         {
-            for (x = 0; x < src_stride; x++) dst[x] = mapping[src[x]];
-            ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
+            for (x = 0; x < width_bytes; x++) dst[x] = mapping[src[x]];
+            if (zeropad_mask != ~0u) ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
         }
         break;
     case 16:
         for (y = 0; y < height; y++, src += src_stride, dst += dst_stride)
         {
-            for (x = 0; x < info->bmiHeader.biWidth; x++)
+            for (x = 0; x < width; x++)
                 ((USHORT *)dst)[x] = RtlUshortByteSwap( ((const USHORT *)src)[x] );
-            ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
+            if (zeropad_mask != ~0u) ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
         }
         break;
     case 24:
         for (y = 0; y < height; y++, src += src_stride, dst += dst_stride)
         {
-            for (x = 0; x < info->bmiHeader.biWidth; x++)
+            for (x = 0; x < width; x++)
             {
                 unsigned char tmp = src[3 * x];
                 dst[3 * x]     = src[3 * x + 2];
                 dst[3 * x + 1] = src[3 * x + 1];
                 dst[3 * x + 2] = tmp;
             }
-            ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
+            if (zeropad_mask != ~0u) ((unsigned int *)dst)[padding_pos] &= zeropad_mask;
         }
         break;
     case 32:
         for (y = 0; y < height; y++, src += src_stride, dst += dst_stride)
-            for (x = 0; x < info->bmiHeader.biWidth; x++)
+            for (x = 0; x < width; x++)
                 ((ULONG *)dst)[x] = RtlUlongByteSwap( ((const ULONG *)src)[x] | alpha_bits );
         break;
     }
@@ -1199,8 +1200,8 @@ DWORD copy_image_bits( BITMAPINFO *info, BOOL is_r8g8b8, XImage *image,
         width_bytes = -width_bytes;
     }
 
-    copy_image_byteswap( info, src, dst, image->bytes_per_line, width_bytes, height,
-                         need_byteswap, mapping, zeropad_mask, 0 );
+    copy_image_byteswap( info, src, dst, image->bytes_per_line, width_bytes, info->bmiHeader.biWidth,
+                         height, need_byteswap, mapping, zeropad_mask, 0 );
     return ERROR_SUCCESS;
 }
 
@@ -1569,6 +1570,8 @@ struct x11drv_window_surface
     COLORREF              color_key;
     HRGN                  region;
     void                 *bits;
+    void                 *shadow;     /* contents of the bits at the last flush, if they need conversion */
+    BOOL                  flush_all;  /* window contents were lost, don't trust the shadow */
 #ifdef HAVE_LIBXXSHM
     XShmSegmentInfo       shminfo;
 #endif
@@ -1576,6 +1579,11 @@ struct x11drv_window_surface
     BITMAPINFO            info;   /* variable size, must be last */
 };
 
+/* flushes are compared against the previous contents in tiles of this size, and the
+ * modified tiles are merged into at most MAX_FLUSH_RECTS rectangles */
+#define SURFACE_TILE_SIZE 64
+#define MAX_FLUSH_RECTS   32
+
 static struct x11drv_window_surface *get_x11_surface( struct window_surface *surface )
 {
     return (struct x11drv_window_surface *)surface;
@@ -1882,18 +1890,162 @@ static void x11drv_surface_set_region( struct window_surface *window_surface, HR
             HeapFree( GetProcessHeap(), 0, data );
         }
     }
+    surface->flush_all = TRUE;
     window_surface->funcs->unlock( window_surface );
 }
 
+/***********************************************************************
+ *           add_dirty_span
+ *
+ * Add a span of modified tiles, extending a rectangle of the previous tile row if possible.
+ */
+static int add_dirty_span( RECT *rects, int count, int left, int top, int right, int bottom )
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (rects[i].left != left || rects[i].right != right || rects[i].bottom != top) continue;
+        rects[i].bottom = bottom;
+        return count;
+    }
+    if (count == MAX_FLUSH_RECTS) return -1;
+    SetRect( &rects[count], left, top, right, bottom );
+    return count + 1;
+}
+
+/***********************************************************************
+ *           get_dirty_rects
+ *
+ * Find the parts of the visible rectangle that changed since the last flush.
+ * Returns the number of rectangles, or -1 if the whole rectangle should be flushed.
+ */
+static int get_dirty_rects( struct x11drv_window_surface *surface, const RECT *visrect, RECT *rects )
+{
+    int width_bytes = surface->image->bytes_per_line;
+    int height = surface->header.rect.bottom - surface->header.rect.top;
+    int tile_bytes = SURFACE_TILE_SIZE * surface->info.bmiHeader.biBitCount / 8;
+    const unsigned char *src = surface->bits, *shadow;
+    int x, y, start, offset, len, bottom, count = 0;
+    BOOL dirty;
+
+    if (surface->flush_all)
+    {
+        surface->flush_all = FALSE;
+        return -1;
+    }
+    /* surfaces drawn directly into the image don't need a conversion pass, and keeping a
+     * shadow copy of them would double their memory just to save a part of the upload */
+    if (surface->bits == surface->image->data) return -1;
+    /* not worth it for small updates */
+    if ((visrect->right - visrect->left) * (visrect->bottom - visrect->top) <=
+        4 * SURFACE_TILE_SIZE * SURFACE_TILE_SIZE) return -1;
+
+    if (!surface->shadow)
+    {
+        /* everything outside the bounds has been flushed already */
+        if (!(surface->shadow = HeapAlloc( GetProcessHeap(), 0, surface->info.bmiHeader.biSizeImage )))
+            return -1;
+        memcpy( surface->shadow, surface->bits, surface->info.bmiHeader.biSizeImage );
+        return -1;
+    }
+    shadow = surface->shadow;
+
+    for (y = visrect->top - visrect->top % SURFACE_TILE_SIZE; y < visrect->bottom; y += SURFACE_TILE_SIZE)
+    {
+        bottom = min( y + SURFACE_TILE_SIZE, height );
+        start = -1;
+        for (x = visrect->left - visrect->left % SURFACE_TILE_SIZE; x < visrect->right; x += SURFACE_TILE_SIZE)
+        {
+            int row;
+
+            offset = x / SURFACE_TILE_SIZE * tile_bytes;
+            len = min( tile_bytes, width_bytes - offset );
+            for (row = y, dirty = FALSE; row < bottom && !dirty; row++)
+                dirty = memcmp( src + row * width_bytes + offset, shadow + row * width_bytes + offset, len );
+
+            if (dirty)
+            {
+                if (start == -1) start = x;
+            }
+            else if (start != -1)
+            {
+                if ((count = add_dirty_span( rects, count, start, y, x, bottom )) == -1) return -1;
+                start = -1;
+            }
+        }
+        if (start != -1 && (count = add_dirty_span( rects, count, start, y, x, bottom )) == -1) return -1;
+    }
+    for (x = 0; x < count; x++) IntersectRect( &rects[x], &rects[x], visrect );
+    return count;
+}
+
+/***********************************************************************
+ *           flush_rect
+ */
+static void flush_rect( struct x11drv_window_surface *surface, const RECT *rect )
+{
+    unsigned char *src = surface->bits;
+    unsigned char *dst = (unsigned char *)surface->image->data;
+    int y, width_bytes = surface->image->bytes_per_line;
+    int bpp = surface->info.bmiHeader.biBitCount;
+    /* byte range covering the rect, rounded out to whole bytes for depths below 8 */
+    int left = rect->left * bpp / 8, right = (rect->right * bpp + 7) / 8;
+
+    if (src != dst)
+    {
+        const int *mapping = NULL;
+        int offset = rect->top * width_bytes + left;
+
+        if (surface->image->bits_per_pixel == 4 || surface->image->bits_per_pixel == 8)
+            mapping = X11DRV_PALETTE_PaletteToXPixel;
+
+        copy_image_byteswap( &surface->info, src + offset, dst + offset, width_bytes, width_bytes,
+                             (right - left) * 8 / bpp, rect->bottom - rect->top,
+                             surface->byteswap, mapping, ~0u, surface->alpha_bits );
+    }
+    else if (surface->alpha_bits)
+    {
+        int x, stride = surface->image->bytes_per_line / sizeof(ULONG);
+        ULONG *ptr = (ULONG *)dst + rect->top * stride;
+
+        for (y = rect->top; y < rect->bottom; y++, ptr += stride)
+            for (x = rect->left; x < rect->right; x++)
+                ptr[x] |= surface->alpha_bits;
+    }
+
+#ifdef HAVE_LIBXXSHM
+    if (surface->shminfo.shmid != -1)
+        XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
+                      rect->left, rect->top,
+                      surface->header.rect.left + rect->left,
+                      surface->header.rect.top + rect->top,
+                      rect->right - rect->left, rect->bottom - rect->top, False );
+    else
+#endif
+    XPutImage( gdi_display, surface->window, surface->gc, surface->image,
+               rect->left, rect->top,
+               surface->header.rect.left + rect->left,
+               surface->header.rect.top + rect->top,
+               rect->right - rect->left, rect->bottom - rect->top );
+
+    if (surface->shadow)
+    {
+        for (y = rect->top; y < rect->bottom; y++)
+            memcpy( (char *)surface->shadow + y * width_bytes + left, src + y * width_bytes + left,
+                    right - left );
+    }
+}
+
 /***********************************************************************
  *           x11drv_surface_flush
  */
 static void x11drv_surface_flush( struct window_surface *window_surface )
 {
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
-    unsigned char *src = surface->bits;
-    unsigned char *dst = (unsigned char *)surface->image->data;
     struct bitblt_coords coords;
+    RECT rects[MAX_FLUSH_RECTS];
+    int i, count;
 
     window_surface->funcs->lock( window_surface );
     coords.x = 0;
@@ -1909,47 +2061,15 @@ static void x11drv_surface_flush( struct window_surface *window_surface )
 
         if (surface->is_argb || surface->color_key != CLR_INVALID) update_surface_region( surface );
 
-        if (src != dst)
+        if ((count = get_dirty_rects( surface, &coords.visrect, rects )) == -1)
         {
-            const int *mapping = NULL;
-            int width_bytes = surface->image->bytes_per_line;
-
-            if (surface->image->bits_per_pixel == 4 || surface->image->bits_per_pixel == 8)
-                mapping = X11DRV_PALETTE_PaletteToXPixel;
-
-            src += coords.visrect.top * width_bytes;
-            dst += coords.visrect.top * width_bytes;
-            copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
-                                 coords.visrect.bottom - coords.visrect.top,
-                                 surface->byteswap, mapping, ~0u, surface->alpha_bits );
-        }
-        else if (surface->alpha_bits)
-        {
-            int x, y, stride = surface->image->bytes_per_line / sizeof(ULONG);
-            ULONG *ptr = (ULONG *)dst + coords.visrect.top * stride;
-
-            for (y = coords.visrect.top; y < coords.visrect.bottom; y++, ptr += stride)
-                for (x = coords.visrect.left; x < coords.visrect.right; x++)
-                    ptr[x] |= surface->alpha_bits;
+            rects[0] = coords.visrect;
+            count = 1;
         }
+        else TRACE( "%p: %d dirty rects\n", surface, count );
 
-#ifdef HAVE_LIBXXSHM
-        if (surface->shminfo.shmid != -1)
-            XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                          coords.visrect.left, coords.visrect.top,
-                          surface->header.rect.left + coords.visrect.left,
-                          surface->header.rect.top + coords.visrect.top,
-                          coords.visrect.right - coords.visrect.left,
-                          coords.visrect.bottom - coords.visrect.top, False );
-        else
-#endif
-        XPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                   coords.visrect.left, coords.visrect.top,
-                   surface->header.rect.left + coords.visrect.left,
-                   surface->header.rect.top + coords.visrect.top,
-                   coords.visrect.right - coords.visrect.left,
-                   coords.visrect.bottom - coords.visrect.top );
-        XFlush( gdi_display );
+        for (i = 0; i < count; i++) flush_rect( surface, &rects[i] );
+        if (count) XFlush( gdi_display );
     }
     reset_bounds( &surface->bounds );
     window_surface->funcs->unlock( window_surface );
@@ -1967,6 +2087,7 @@ static void x11drv_surface_destroy( struct window_surface *window_surface )
     if (surface->image)
     {
         if (surface->image->data != surface->bits) HeapFree( GetProcessHeap(), 0, surface->bits );
+        HeapFree( GetProcessHeap(), 0, surface->shadow );
 #ifdef HAVE_LIBXXSHM
         if (surface->shminfo.shmid != -1)
         {
@@ -2099,6 +2220,7 @@ HRGN expose_surface( struct window_surface *window_surface, const RECT *rect )
     window_surface->funcs->lock( window_surface );
     OffsetRect( &rc, -window_surface->rect.left, -window_surface->rect.top );
     add_bounds_rect( &surface->bounds, &rc );
+    surface->flush_all = TRUE;
     if (surface->region)
     {
         region = CreateRectRgnIndirect( rect );
@@ -350,6 +350,17 @@ typedef union
 } message_data_t;
 
 
+typedef struct
+{
+    unsigned int         seq;
+    int                  cursor_x;
+    int                  cursor_y;
+    unsigned int         cursor_last_change;
+    user_handle_t        foreground;
+    unsigned char        keystate[256];
+} desktop_shm_t;
+
+
 typedef struct
 {
     WCHAR          ch;
@@ -4124,6 +4135,20 @@ struct set_thread_desktop_reply
 
 
 
+struct get_desktop_shared_memory_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_desktop_shared_memory_reply
+{
+    struct reply_header __header;
+    obj_handle_t handle;
+    char __pad_12[4];
+};
+
+
+
 struct enum_desktop_request
 {
     struct request_header __header;
@@ -5864,6 +5889,7 @@ enum request
     REQ_close_desktop,
     REQ_get_thread_desktop,
     REQ_set_thread_desktop,
+    REQ_get_desktop_shared_memory,
     REQ_enum_desktop,
     REQ_set_user_object_info,
     REQ_register_hotkey,
@@ -6162,6 +6188,7 @@ union generic_request
     struct close_desktop_request close_desktop_request;
     struct get_thread_desktop_request get_thread_desktop_request;
     struct set_thread_desktop_request set_thread_desktop_request;
+    struct get_desktop_shared_memory_request get_desktop_shared_memory_request;
     struct enum_desktop_request enum_desktop_request;
     struct set_user_object_info_request set_user_object_info_request;
     struct register_hotkey_request register_hotkey_request;
@@ -6458,6 +6485,7 @@ union generic_reply
     struct close_desktop_reply close_desktop_reply;
     struct get_thread_desktop_reply get_thread_desktop_reply;
     struct set_thread_desktop_reply set_thread_desktop_reply;
+    struct get_desktop_shared_memory_reply get_desktop_shared_memory_reply;
     struct enum_desktop_reply enum_desktop_reply;
     struct set_user_object_info_reply set_user_object_info_reply;
     struct register_hotkey_reply register_hotkey_reply;
@@ -6553,6 +6581,6 @@ union generic_reply
     struct terminate_job_reply terminate_job_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 571
+#define SERVER_PROTOCOL_VERSION 572
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -43,10 +43,21 @@
 #include "security.h"
 
 
+#define MIN_NAMESPACE_HASH_SIZE 7
+#define MAX_NAMESPACE_HASH_SIZE 0x10000
+
 struct namespace
 {
     unsigned int        hash_size;       /* size of hash table */
-    struct list         names[1];        /* array of hash entry lists */
+    unsigned int        count;           /* number of names in the namespace */
+    unsigned int        max_count;       /* highest number of names seen so far */
+    unsigned int        resizes;         /* number of times the hash table was grown */
+    unsigned int        lookups;         /* number of find_object calls */
+    unsigned int        probes;          /* number of names compared by find_object */
+    unsigned int        cache_index;     /* index of the cached enumeration position */
+    unsigned int        cache_bucket;    /* bucket of the cached enumeration position */
+    struct object_name *cache_name;      /* name at the cached enumeration position */
+    struct list        *names;           /* array of hash entry lists */
 };
 
 
@@ -127,19 +138,74 @@ void *memdup( const void *data, size_t len )
 
 /*****************************************************************/
 
-static int get_name_hash( const struct namespace *namespace, const WCHAR *name, data_size_t len )
+/* case-insensitive FNV-1a hash of the full name */
+static unsigned int hash_name( const WCHAR *name, data_size_t len )
 {
-    WCHAR hash = 0;
+    unsigned int hash = 2166136261u;
     len /= sizeof(WCHAR);
-    while (len--) hash ^= tolowerW(*name++);
-    return hash % namespace->hash_size;
+    while (len--)
+    {
+        hash ^= tolowerW(*name++);
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+static inline unsigned int get_name_hash( const struct namespace *namespace, const WCHAR *name,
+                                          data_size_t len )
+{
+    return hash_name( name, len ) % namespace->hash_size;
+}
+
+static inline void invalidate_index_cache( struct namespace *namespace )
+{
+    namespace->cache_name = NULL;
+}
+
+/* grow the hash table once the average chain gets too long */
+static void grow_namespace( struct namespace *namespace )
+{
+    unsigned int i, new_size = namespace->hash_size * 4 + 1;
+    struct object_name *ptr, *next;
+    struct list *names;
+
+    if (new_size > MAX_NAMESPACE_HASH_SIZE) new_size = MAX_NAMESPACE_HASH_SIZE;
+    if (new_size <= namespace->hash_size) return;
+    /* failing to grow is not fatal, we simply keep the current table */
+    if (!(names = malloc( new_size * sizeof(*names) ))) return;
+    for (i = 0; i < new_size; i++) list_init( &names[i] );
+
+    for (i = 0; i < namespace->hash_size; i++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE( ptr, next, &namespace->names[i], struct object_name, entry )
+        {
+            list_remove( &ptr->entry );
+            list_add_tail( &names[hash_name( ptr->name, ptr->len ) % new_size], &ptr->entry );
+        }
+    }
+
+    if (debug_level)
+        fprintf( stderr, "namespace %p: grown from %u to %u buckets for %u names\n",
+                 namespace, namespace->hash_size, new_size, namespace->count );
+
+    free( namespace->names );
+    namespace->names     = names;
+    namespace->hash_size = new_size;
+    namespace->resizes++;
+    invalidate_index_cache( namespace );
 }
 
 void namespace_add( struct namespace *namespace, struct object_name *ptr )
 {
-    int hash = get_name_hash( namespace, ptr->name, ptr->len );
+    unsigned int hash;
 
+    if (namespace->count >= namespace->hash_size * 2) grow_namespace( namespace );
+
+    hash = get_name_hash( namespace, ptr->name, ptr->len );
     list_add_head( &namespace->names[hash], &ptr->entry );
+    ptr->namespace = namespace;
+    if (++namespace->count > namespace->max_count) namespace->max_count = namespace->count;
+    invalidate_index_cache( namespace );
 }
 
 /* allocate a name for an object */
@@ -151,6 +217,7 @@ static struct object_name *alloc_name( const struct unicode_str *name )
     {
         ptr->len = name->len;
         ptr->parent = NULL;
+        ptr->namespace = NULL;
         memcpy( ptr->name, name->str, name->len );
     }
     return ptr;
@@ -432,7 +499,7 @@ void release_object( void *ptr )
 }
 
 /* find an object by its name; the refcount is incremented */
-struct object *find_object( const struct namespace *namespace, const struct unicode_str *name,
+struct object *find_object( struct namespace *namespace, const struct unicode_str *name,
                             unsigned int attributes )
 {
     const struct list *list;
@@ -440,10 +507,12 @@ struct object *find_object( const struct namespace *namespace, const struct unic
 
     if (!name || !name->len) return NULL;
 
+    namespace->lookups++;
     list = &namespace->names[ get_name_hash( namespace, name->str, name->len ) ];
     LIST_FOR_EACH( p, list )
     {
         const struct object_name *ptr = LIST_ENTRY( p, struct object_name, entry );
+        namespace->probes++;
         if (ptr->len != name->len) continue;
         if (attributes & OBJ_CASE_INSENSITIVE)
         {
@@ -460,21 +529,47 @@ struct object *find_object( const struct namespace *namespace, const struct unic
 }
 
 /* find an object by its index; the refcount is incremented */
-struct object *find_object_index( const struct namespace *namespace, unsigned int index )
+struct object *find_object_index( struct namespace *namespace, unsigned int index )
 {
-    unsigned int i;
+    struct object_name *ptr;
+    unsigned int i, pos;
+    struct list *p;
 
-    /* FIXME: not efficient at all */
-    for (i = 0; i < namespace->hash_size; i++)
+    /* resume from the last returned position, which makes sequential enumeration linear */
+    if (namespace->cache_name && index >= namespace->cache_index)
+    {
+        i   = namespace->cache_bucket;
+        pos = namespace->cache_index;
+        p   = &namespace->cache_name->entry;
+    }
+    else
+    {
+        i   = 0;
+        pos = 0;
+        p   = list_head( &namespace->names[0] );
+    }
+
+    for (;;)
     {
-        const struct object_name *ptr;
-        LIST_FOR_EACH_ENTRY( ptr, &namespace->names[i], const struct object_name, entry )
+        while (!p)
         {
-            if (!index--) return grab_object( ptr->obj );
+            if (++i >= namespace->hash_size)
+            {
+                set_error( STATUS_NO_MORE_ENTRIES );
+                return NULL;
+            }
+            p = list_head( &namespace->names[i] );
         }
+        if (pos == index) break;
+        p = list_next( &namespace->names[i], p );
+        pos++;
     }
-    set_error( STATUS_NO_MORE_ENTRIES );
-    return NULL;
+
+    ptr = LIST_ENTRY( p, struct object_name, entry );
+    namespace->cache_index  = index;
+    namespace->cache_bucket = i;
+    namespace->cache_name   = ptr;
+    return grab_object( ptr->obj );
 }
 
 /* allocate a namespace */
@@ -483,15 +578,54 @@ struct namespace *create_namespace( unsigned int hash_size )
     struct namespace *namespace;
     unsigned int i;
 
-    namespace = mem_alloc( sizeof(*namespace) + (hash_size - 1) * sizeof(namespace->names[0]) );
-    if (namespace)
+    if (hash_size < MIN_NAMESPACE_HASH_SIZE) hash_size = MIN_NAMESPACE_HASH_SIZE;
+    if (!(namespace = mem_alloc( sizeof(*namespace) ))) return NULL;
+    if (!(namespace->names = mem_alloc( hash_size * sizeof(namespace->names[0]) )))
     {
-        namespace->hash_size      = hash_size;
-        for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
+        free( namespace );
+        return NULL;
     }
+    namespace->hash_size    = hash_size;
+    namespace->count        = 0;
+    namespace->max_count    = 0;
+    namespace->resizes      = 0;
+    namespace->lookups      = 0;
+    namespace->probes       = 0;
+    namespace->cache_index  = 0;
+    namespace->cache_bucket = 0;
+    namespace->cache_name   = NULL;
+    for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
     return namespace;
 }
 
+/* dump the occupancy statistics of a namespace */
+void dump_namespace_stats( const struct namespace *namespace )
+{
+    unsigned int i, len, used = 0, longest = 0;
+    struct list *p;
+
+    for (i = 0; i < namespace->hash_size; i++)
+    {
+        len = 0;
+        LIST_FOR_EACH( p, &namespace->names[i] ) len++;
+        if (len) used++;
+        if (len > longest) longest = len;
+    }
+    fprintf( stderr, "namespace %p: %u names (max %u) in %u/%u buckets, longest chain %u, "
+             "%u resizes, %u lookups, %u probes\n",
+             namespace, namespace->count, namespace->max_count, used, namespace->hash_size,
+             longest, namespace->resizes, namespace->lookups, namespace->probes );
+}
+
+/* free a namespace; it must not contain any names */
+void free_namespace( struct namespace *namespace )
+{
+    if (!namespace) return;
+    if (debug_level > 1 && namespace->lookups) dump_namespace_stats( namespace );
+    free( namespace->names );
+    free( namespace );
+}
+
 /* functions for unimplemented/default object operations */
 
 struct object_type *no_get_type( struct object *obj )
@@ -683,6 +817,12 @@ int no_link_name( struct object *obj, struct object_name *name, struct object *p
 void default_unlink_name( struct object *obj, struct object_name *name )
 {
     list_remove( &name->entry );
+    if (name->namespace)
+    {
+        name->namespace->count--;
+        invalidate_index_cache( name->namespace );
+        name->namespace = NULL;
+    }
 }
 
 struct object *no_open_file( struct object *obj, unsigned int access, unsigned int sharing,
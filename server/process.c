@@ -521,6 +521,8 @@ struct process *create_process( int fd, struct process *parent, int inherit_all,
     process->token           = NULL;
     process->trace_data      = 0;
     process->rawinput_mouse  = NULL;
+    process->profile_requests = 0;
+    process->profile_time    = 0;
     process->rawinput_kbd    = NULL;
     list_init( &process->thread_list );
     list_init( &process->locks );
@@ -96,6 +96,8 @@ struct process
     struct list          rawinput_devices;/* list of registered rawinput devices */
     const struct rawinput_device *rawinput_mouse; /* rawinput mouse device, if any */
     const struct rawinput_device *rawinput_kbd;   /* rawinput keyboard device, if any */
+    unsigned int         profile_requests;/* number of requests profiled for this process */
+    timeout_t            profile_time;    /* time spent in its request handlers, in nanoseconds */
 };
 
 struct process_snapshot
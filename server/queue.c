@@ -50,6 +50,13 @@
 enum message_kind { SEND_MESSAGE, POST_MESSAGE };
 #define NB_MSG_KINDS (POST_MESSAGE+1)
 
+/* posted messages are also indexed by message range, so that filtered lookups
+ * don't need to walk over messages that cannot possibly match */
+enum post_range { POST_RANGE_SYSTEM, POST_RANGE_USER, POST_RANGE_APP, POST_RANGE_STRING };
+#define NB_POST_RANGES (POST_RANGE_STRING+1)
+
+static const unsigned int post_range_first[NB_POST_RANGES] = { 0, WM_USER, WM_APP, MAXINTATOM };
+
 
 struct message_result
 {
@@ -72,6 +79,8 @@ struct message_result
 struct message
 {
     struct list            entry;     /* entry in message list */
+    struct list            range_entry; /* entry in posted message range list */
+    unsigned int           serial;    /* posting order for posted messages */
     enum message_type      type;      /* message type */
     user_handle_t          win;       /* window handle */
     unsigned int           msg;       /* message code */
@@ -130,6 +139,8 @@ struct msg_queue
     int                    exit_code;       /* exit code of pending quit message */
     int                    cursor_count;    /* per-queue cursor show count */
     struct list            msg_list[NB_MSG_KINDS];  /* lists of messages */
+    struct list            post_ranges[NB_POST_RANGES];  /* posted messages indexed by range */
+    unsigned int           post_serial;     /* serial number of the next posted message */
     struct list            send_result;     /* stack of sent messages waiting for result */
     struct list            callback_result; /* list of callback messages waiting for result */
     struct message_result *recv_result;     /* stack of received messages waiting for result */
@@ -298,11 +309,13 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->input           = (struct thread_input *)grab_object( input );
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
+        queue->post_serial     = 0;
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
         list_init( &queue->expired_timers );
         for (i = 0; i < NB_MSG_KINDS; i++) list_init( &queue->msg_list[i] );
+        for (i = 0; i < NB_POST_RANGES; i++) list_init( &queue->post_ranges[i] );
 
         thread->queue = queue;
     }
@@ -364,6 +377,28 @@ static struct message *alloc_hardware_message( lparam_t info, struct hw_msg_sour
     return msg;
 }
 
+/* update the desktop state shared with the clients */
+static void update_desktop_shared( struct desktop *desktop )
+{
+    desktop_shm_t *shared = desktop->shared;
+    user_handle_t foreground = desktop->foreground_input ? desktop->foreground_input->active : 0;
+
+    if (!shared) return;
+    if (shared->cursor_x == desktop->cursor.x && shared->cursor_y == desktop->cursor.y &&
+        shared->cursor_last_change == desktop->cursor.last_change && shared->foreground == foreground &&
+        !memcmp( shared->keystate, desktop->keystate, sizeof(shared->keystate) ))
+        return;
+
+    /* the sequence number is odd while the update is in progress */
+    interlocked_xchg_add( (int *)&shared->seq, 1 );
+    shared->cursor_x           = desktop->cursor.x;
+    shared->cursor_y           = desktop->cursor.y;
+    shared->cursor_last_change = desktop->cursor.last_change;
+    shared->foreground         = foreground;
+    memcpy( shared->keystate, desktop->keystate, sizeof(shared->keystate) );
+    interlocked_xchg_add( (int *)&shared->seq, 1 );
+}
+
 /* set the cursor position and queue the corresponding mouse message */
 static void set_cursor_pos( struct desktop *desktop, int x, int y )
 {
@@ -422,6 +457,7 @@ static void set_foreground_input( struct desktop *desktop, struct thread_input *
     if (desktop->foreground_input == input) return;
     set_clip_rectangle( desktop, NULL, 1 );
     desktop->foreground_input = input;
+    update_desktop_shared( desktop );
 }
 
 /* get the hook table for a given thread */
@@ -473,6 +509,23 @@ static inline int check_msg_filter( unsigned int msg, unsigned int first, unsign
     return (msg >= first && msg <= last);
 }
 
+/* get the posted message range index for a given message */
+static inline enum post_range get_post_range( unsigned int msg )
+{
+    if (msg >= MAXINTATOM) return POST_RANGE_STRING;
+    if (msg >= WM_APP) return POST_RANGE_APP;
+    if (msg >= WM_USER) return POST_RANGE_USER;
+    return POST_RANGE_SYSTEM;
+}
+
+/* check whether a message filter intersects a given posted message range */
+static inline int filter_contains_post_range( enum post_range range, unsigned int first, unsigned int last )
+{
+    if (last < post_range_first[range]) return 0;
+    if (range < POST_RANGE_STRING && first >= post_range_first[range + 1]) return 0;
+    return 1;
+}
+
 /* check whether a message filter contains at least one potential hardware message */
 static inline int filter_contains_hw_range( unsigned int first, unsigned int last )
 {
@@ -513,12 +566,59 @@ static inline unsigned int get_unique_id(void)
     return id;
 }
 
+/* add a message to the posted message lists of a queue */
+static void link_posted_message( struct msg_queue *queue, struct message *msg )
+{
+    msg->serial = queue->post_serial++;
+    list_add_tail( &queue->msg_list[POST_MESSAGE], &msg->entry );
+    list_add_tail( &queue->post_ranges[get_post_range( msg->msg )], &msg->range_entry );
+}
+
+/* check whether a message is a relative raw mouse motion without buttons or wheel data */
+static inline int is_rawinput_mouse_move( const struct message *msg )
+{
+    const struct hardware_msg_data *data = msg->data;
+
+    if (msg->msg != WM_INPUT || !data) return 0;
+    return data->rawinput.type == RIM_TYPEMOUSE && data->flags == MOUSEEVENTF_MOVE;
+}
+
+/* merge a raw mouse motion with the previous one that hasn't been retrieved yet */
+static int merge_rawinput_mouse_move( struct thread_input *input, const struct message *msg )
+{
+    struct hardware_msg_data *prev_data, *msg_data = msg->data;
+    struct message *prev;
+    struct list *ptr;
+
+    for (ptr = list_tail( &input->msg_list ); ptr; ptr = list_prev( &input->msg_list, ptr ))
+    {
+        prev = LIST_ENTRY( ptr, struct message, entry );
+        if (prev->msg != WM_MOUSEMOVE) break;
+    }
+    if (!ptr) return 0;
+    if (prev->result || prev->unique_id) return 0;
+    if (prev->win != msg->win) return 0;
+    if (!is_rawinput_mouse_move( prev )) return 0;
+    prev_data = prev->data;
+    if (prev_data->rawinput.mouse.data != msg_data->rawinput.mouse.data) return 0;
+    if (memcmp( &prev_data->source, &msg_data->source, sizeof(prev_data->source) )) return 0;
+    /* now we can merge it */
+    prev->time = msg->time;
+    prev_data->info = msg_data->info;
+    prev_data->rawinput.mouse.x += msg_data->rawinput.mouse.x;
+    prev_data->rawinput.mouse.y += msg_data->rawinput.mouse.y;
+    list_remove( ptr );
+    list_add_tail( &input->msg_list, ptr );
+    return 1;
+}
+
 /* try to merge a message with the last in the list; return 1 if successful */
 static int merge_message( struct thread_input *input, const struct message *msg )
 {
     struct message *prev;
     struct list *ptr;
 
+    if (is_rawinput_mouse_move( msg )) return merge_rawinput_mouse_move( input, msg );
     if (msg->msg != WM_MOUSEMOVE) return 0;
     for (ptr = list_tail( &input->msg_list ); ptr; ptr = list_prev( &input->msg_list, ptr ))
     {
@@ -637,6 +737,7 @@ static void remove_queue_message( struct msg_queue *queue, struct message *msg,
         if (list_empty( &queue->msg_list[kind] )) clear_queue_bits( queue, QS_SENDMESSAGE );
         break;
     case POST_MESSAGE:
+        list_remove( &msg->range_entry );
         if (list_empty( &queue->msg_list[kind] ) && !queue->quit_message)
             clear_queue_bits( queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
         if (msg->msg == WM_HOTKEY && --queue->hotkey_count == 0)
@@ -794,19 +895,25 @@ static int get_posted_message( struct msg_queue *queue, user_handle_t win,
                                unsigned int first, unsigned int last, unsigned int flags,
                                struct get_message_reply *reply )
 {
-    struct message *msg;
+    struct message *msg, *found = NULL;
+    unsigned int i;
 
-    /* check against the filters */
-    LIST_FOR_EACH_ENTRY( msg, &queue->msg_list[POST_MESSAGE], struct message, entry )
+    /* check against the filters, looking for the oldest match in the relevant ranges */
+    for (i = 0; i < NB_POST_RANGES; i++)
     {
-        if (!match_window( win, msg->win )) continue;
-        if (!check_msg_filter( msg->msg, first, last )) continue;
-        goto found; /* found one */
+        if (!filter_contains_post_range( i, first, last )) continue;
+        LIST_FOR_EACH_ENTRY( msg, &queue->post_ranges[i], struct message, range_entry )
+        {
+            if (found && (int)(msg->serial - found->serial) > 0) break;
+            if (!match_window( win, msg->win )) continue;
+            if (!check_msg_filter( msg->msg, first, last )) continue;
+            found = msg;
+            break;
+        }
     }
-    return 0;
+    if (!(msg = found)) return 0;
 
     /* return it to the app */
-found:
     reply->total = msg->data_size;
     if (msg->data_size > get_reply_max_size())
     {
@@ -1044,7 +1151,11 @@ static inline void thread_input_cleanup_window( struct msg_queue *queue, user_ha
 
     if (window == input->focus) input->focus = 0;
     if (window == input->capture) input->capture = 0;
-    if (window == input->active) input->active = 0;
+    if (window == input->active)
+    {
+        input->active = 0;
+        update_desktop_shared( input->desktop );
+    }
     if (window == input->menu_owner) input->menu_owner = 0;
     if (window == input->move_size) input->move_size = 0;
     if (window == input->caret) set_caret_window( input, 0 );
@@ -1103,6 +1214,7 @@ int attach_thread_input( struct thread *thread_from, struct thread *thread_to )
 
     ret = assign_thread_input( thread_from, input );
     if (ret) memset( input->keystate, 0, sizeof(input->keystate) );
+    update_desktop_shared( input->desktop );
     release_object( input );
     return ret;
 }
@@ -1134,6 +1246,7 @@ void detach_thread_input( struct thread *thread_from )
             release_object( thread );
         }
         assign_thread_input( thread_from, input );
+        update_desktop_shared( input->desktop );
         release_object( input );
     }
 }
@@ -1403,7 +1516,7 @@ found:
     msg->data      = NULL;
     msg->data_size = 0;
 
-    list_add_tail( &hotkey->queue->msg_list[POST_MESSAGE], &msg->entry );
+    link_posted_message( hotkey->queue, msg );
     set_queue_bits( hotkey->queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE|QS_HOTKEY );
     hotkey->queue->hotkey_count++;
     return 1;
@@ -1486,6 +1599,7 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
     unsigned int msg_code;
 
     update_input_key_state( desktop, desktop->keystate, msg );
+    update_desktop_shared( desktop );
     last_input_time = get_tick_count();
     if (msg->msg != WM_MOUSEMOVE) always_queue = 1;
 
@@ -1506,6 +1620,7 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
             desktop->cursor.x = x;
             desktop->cursor.y = y;
             desktop->cursor.last_change = get_tick_count();
+            update_desktop_shared( desktop );
         }
         if (desktop->keystate[VK_LBUTTON] & 0x80)  msg->wparam |= MK_LBUTTON;
         if (desktop->keystate[VK_MBUTTON] & 0x80)  msg->wparam |= MK_MBUTTON;
@@ -1623,6 +1738,7 @@ static int queue_mouse_message( struct desktop *desktop, user_handle_t win, cons
     };
 
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shared( desktop );
     flags = input->mouse.flags;
     time  = input->mouse.time;
     if (!time) time = desktop->cursor.last_change;
@@ -2060,7 +2176,7 @@ void post_message( user_handle_t win, unsigned int message, lparam_t wparam, lpa
 
         get_message_defaults( thread->queue, &msg->x, &msg->y, &msg->time );
 
-        list_add_tail( &thread->queue->msg_list[POST_MESSAGE], &msg->entry );
+        link_posted_message( thread->queue, msg );
         set_queue_bits( thread->queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
         if (message == WM_HOTKEY)
         {
@@ -2301,7 +2417,7 @@ DECL_HANDLER(send_message)
             set_queue_bits( recv_queue, QS_SENDMESSAGE );
             break;
         case MSG_POSTED:
-            list_add_tail( &recv_queue->msg_list[POST_MESSAGE], &msg->entry );
+            link_posted_message( recv_queue, msg );
             set_queue_bits( recv_queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
             if (msg->msg == WM_HOTKEY)
             {
@@ -2842,6 +2958,7 @@ DECL_HANDLER(get_key_state)
         {
             reply->state = desktop->keystate[req->key & 0xff];
             desktop->keystate[req->key & 0xff] &= ~0x40;
+            if (reply->state & 0x40) update_desktop_shared( desktop );
         }
         set_reply_data( desktop->keystate, size );
         release_object( desktop );
@@ -2883,6 +3000,7 @@ DECL_HANDLER(set_key_state)
     {
         if (!(desktop = get_thread_desktop( current, 0 ))) return;
         memcpy( desktop->keystate, get_req_data(), size );
+        update_desktop_shared( desktop );
         release_object( desktop );
     }
     else
@@ -2892,6 +3010,7 @@ DECL_HANDLER(set_key_state)
         if (req->async && (desktop = get_thread_desktop( thread, 0 )))
         {
             memcpy( desktop->keystate, get_req_data(), size );
+            update_desktop_shared( desktop );
             release_object( desktop );
         }
         release_object( thread );
@@ -2951,6 +3070,7 @@ DECL_HANDLER(set_active_window)
         {
             reply->previous = queue->input->active;
             queue->input->active = get_user_full_handle( req->handle );
+            update_desktop_shared( queue->input->desktop );
         }
         else set_error( STATUS_INVALID_HANDLE );
     }
@@ -92,6 +92,19 @@ struct region
 
 #define RGN_DEFAULT_RECTS 2
 
+/* released rectangle arrays are kept in a small pool so that the region operations, */
+/* which need a fresh array for their result, don't go through malloc every time; */
+/* large arrays are freed right away so the pool stays small (at most 16 * 64 rects) */
+#define RECT_POOL_SIZE      16
+#define RECT_POOL_MAX_RECTS 64
+
+static struct
+{
+    rectangle_t *rects;
+    int          size;
+} rect_pool[RECT_POOL_SIZE];
+static int rect_pool_count;
+
 #define EXTENTCHECK(r1, r2) \
     ((r1)->right > (r2)->left && \
     (r1)->left < (r2)->right && \
@@ -105,6 +118,38 @@ typedef int (*non_overlap_func_t)( struct region *reg, const rectangle_t *r,
 
 static const rectangle_t empty_rect;  /* all-zero rectangle for empty regions */
 
+/* get a rectangle array of at least *size entries, returning the actual size in *size */
+static rectangle_t *alloc_rects( int *size )
+{
+    int i, best = -1;
+
+    for (i = 0; i < rect_pool_count; i++)
+    {
+        if (rect_pool[i].size < *size) continue;
+        if (best == -1 || rect_pool[i].size < rect_pool[best].size) best = i;
+    }
+    if (best != -1)
+    {
+        rectangle_t *rects = rect_pool[best].rects;
+        *size = rect_pool[best].size;
+        rect_pool[best] = rect_pool[--rect_pool_count];
+        return rects;
+    }
+    return mem_alloc( *size * sizeof(rectangle_t) );
+}
+
+/* release a rectangle array, keeping it in the pool if possible */
+static void free_rects( rectangle_t *rects, int size )
+{
+    if (rect_pool_count < RECT_POOL_SIZE && size <= RECT_POOL_MAX_RECTS)
+    {
+        rect_pool[rect_pool_count].rects = rects;
+        rect_pool[rect_pool_count].size  = size;
+        rect_pool_count++;
+    }
+    else free( rects );
+}
+
 /* add a rectangle to a region */
 static inline rectangle_t *add_rect( struct region *reg )
 {
@@ -219,14 +264,19 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
     const rectangle_t *r1End = r1 + reg1->num_rects;
     const rectangle_t *r2End = r2 + reg2->num_rects;
 
-    rectangle_t *new_rects, *old_rects = newReg->rects;
-    int new_size, ret = 0;
+    rectangle_t *new_rects, *old_rects = NULL;
+    int new_size, old_size = 0, ret = 0;
 
     new_size = max( reg1->num_rects, reg2->num_rects ) * 2;
-    if (!(new_rects = mem_alloc( new_size * sizeof(*newReg->rects) ))) return 0;
-
-    newReg->size = new_size;
-    newReg->rects = new_rects;
+    if (newReg == reg1 || newReg == reg2 || newReg->size < new_size)
+    {
+        if (!(new_rects = alloc_rects( &new_size ))) return 0;
+        old_rects = newReg->rects;
+        old_size = newReg->size;
+        newReg->size = new_size;
+        newReg->rects = new_rects;
+    }
+    /* otherwise the destination array is large enough to be filled in place */
     newReg->num_rects = 0;
 
     if (reg1->extents.top < reg2->extents.top)
@@ -321,7 +371,7 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
 
     if (newReg->num_rects != curBand) coalesce_region(newReg, prevBand, curBand);
 
-    if ((newReg->num_rects < (newReg->size / 2)) && (newReg->size > 2))
+    if ((newReg->num_rects < (newReg->size / 2)) && (newReg->size > RECT_POOL_MAX_RECTS))
     {
         new_size = max( newReg->num_rects, RGN_DEFAULT_RECTS );
         if ((new_rects = realloc( newReg->rects, sizeof(*newReg->rects) * new_size )))
@@ -332,7 +382,7 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
     }
     ret = 1;
 done:
-    free( old_rects );
+    if (old_rects) free_rects( old_rects, old_size );
     return ret;
 }
 
@@ -567,12 +617,12 @@ struct region *create_empty_region(void)
     struct region *region;
 
     if (!(region = mem_alloc( sizeof(*region) ))) return NULL;
-    if (!(region->rects = mem_alloc( RGN_DEFAULT_RECTS * sizeof(*region->rects) )))
+    region->size = RGN_DEFAULT_RECTS;
+    if (!(region->rects = alloc_rects( &region->size )))
     {
         free( region );
         return NULL;
     }
-    region->size = RGN_DEFAULT_RECTS;
     region->num_rects = 0;
     region->extents.left = 0;
     region->extents.top = 0;
@@ -584,7 +634,6 @@ struct region *create_empty_region(void)
 /* create a region from request data */
 struct region *create_region_from_req_data( const void *data, data_size_t size )
 {
-    unsigned int alloc_rects;
     struct region *region;
     const rectangle_t *rects = data;
     int nb_rects = size / sizeof(rectangle_t);
@@ -600,13 +649,12 @@ struct region *create_region_from_req_data( const void *data, data_size_t size )
 
     if (!(region = mem_alloc( sizeof(*region) ))) return NULL;
 
-    alloc_rects = max( nb_rects, RGN_DEFAULT_RECTS );
-    if (!(region->rects = mem_alloc( alloc_rects * sizeof(*region->rects) )))
+    region->size = max( nb_rects, RGN_DEFAULT_RECTS );
+    if (!(region->rects = alloc_rects( &region->size )))
     {
         free( region );
         return NULL;
     }
-    region->size = alloc_rects;
     region->num_rects = nb_rects;
     memcpy( region->rects, rects, nb_rects * sizeof(*rects) );
     set_region_extents( region );
@@ -616,7 +664,7 @@ struct region *create_region_from_req_data( const void *data, data_size_t size )
 /* free a region */
 void free_region( struct region *region )
 {
-    free( region->rects );
+    free_rects( region->rects, region->size );
     free( region );
 }
 
@@ -771,6 +819,14 @@ struct region *intersect_region( struct region *dst, const struct region *src1,
         dst->extents.bottom = 0;
         return dst;
     }
+    if (src1->num_rects == 1 && src2->num_rects == 1)
+    {
+        rectangle_t rect;
+
+        intersect_rect( &rect, &src1->extents, &src2->extents );
+        set_region_rect( dst, &rect );
+        return dst;
+    }
     if (!region_op( dst, src1, src2, intersect_overlapping, NULL, NULL )) return NULL;
     set_region_extents( dst );
     return dst;
@@ -783,6 +839,16 @@ struct region *subtract_region( struct region *dst, const struct region *src1,
     if (!src1->num_rects || !src2->num_rects || !EXTENTCHECK(&src1->extents, &src2->extents))
         return copy_region( dst, src1 );
 
+    if ((src2->num_rects == 1) &&
+        (src2->extents.left <= src1->extents.left) &&
+        (src2->extents.top <= src1->extents.top) &&
+        (src2->extents.right >= src1->extents.right) &&
+        (src2->extents.bottom >= src1->extents.bottom))
+    {
+        set_region_rect( dst, &empty_rect );
+        return dst;
+    }
+
     if (!region_op( dst, src1, src2, subtract_overlapping,
                     subtract_non_overlapping, NULL )) return NULL;
     set_region_extents( dst );
@@ -292,11 +292,152 @@ static void send_reply( union generic_reply *reply )
         fatal_protocol_error( current, "reply write: %s\n", strerror( errno ));
 }
 
+/* request profiling, toggled with SIGUSR1 */
+
+#define PROFILE_BUCKETS 16  /* latency histogram buckets, in powers of two of microseconds */
+
+struct request_profile
+{
+    unsigned int count;                        /* number of calls */
+    timeout_t    total_time;                   /* total handler time in nanoseconds */
+    timeout_t    max_time;                     /* max handler time in nanoseconds */
+    timeout_t    reply_bytes;                  /* total size of the reply data */
+    unsigned int histogram[PROFILE_BUCKETS];   /* handler time distribution */
+};
+
+static struct request_profile request_profiles[REQ_NB_REQUESTS];
+static int profile_requests;        /* is profiling enabled? */
+static timeout_t profile_start;     /* time when profiling was enabled */
+
+/* get a monotonic time stamp in nanoseconds for profiling purposes */
+static timeout_t get_profile_time(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+
+    if (!timebase.denom) mach_timebase_info( &timebase );
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timeval now;
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+
+    if (!clock_gettime( CLOCK_MONOTONIC, &ts ))
+        return (timeout_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+    gettimeofday( &now, NULL );
+    return (timeout_t)now.tv_sec * 1000000000 + now.tv_usec * 1000;
+#endif
+}
+
+/* account a finished request in the profile */
+static void profile_request( enum request req, struct process *process, timeout_t time,
+                             data_size_t reply_size )
+{
+    struct request_profile *profile = &request_profiles[req];
+    timeout_t usecs = time / 1000;
+    unsigned int bucket = 0;
+
+    while (usecs && bucket < PROFILE_BUCKETS - 1)
+    {
+        usecs >>= 1;
+        bucket++;
+    }
+    profile->count++;
+    profile->total_time += time;
+    if (time > profile->max_time) profile->max_time = time;
+    profile->reply_bytes += reply_size;
+    profile->histogram[bucket]++;
+
+    if (process)
+    {
+        process->profile_requests++;
+        process->profile_time += time;
+    }
+}
+
+static int compare_request_profiles( const void *p1, const void *p2 )
+{
+    const struct request_profile *prof1 = &request_profiles[*(const enum request *)p1];
+    const struct request_profile *prof2 = &request_profiles[*(const enum request *)p2];
+
+    if (prof1->total_time > prof2->total_time) return -1;
+    if (prof1->total_time < prof2->total_time) return 1;
+    return 0;
+}
+
+/* print and reset the per-process statistics */
+static int dump_process_profile( struct process *process, void *arg )
+{
+    if (process->profile_requests)
+    {
+        fprintf( stderr, "%04x: unix pid %d: %u requests, %u us in handlers\n", process->id,
+                 process->unix_pid, process->profile_requests,
+                 (unsigned int)(process->profile_time / 1000) );
+        process->profile_requests = 0;
+        process->profile_time = 0;
+    }
+    return 0;
+}
+
+/* print the collected statistics and reset them */
+static void dump_request_profile(void)
+{
+    enum request order[REQ_NB_REQUESTS];
+    unsigned int i, j, count = 0;
+    timeout_t total = 0;
+
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        if (!request_profiles[i].count) continue;
+        total += request_profiles[i].total_time;
+        order[count++] = i;
+    }
+    qsort( order, count, sizeof(order[0]), compare_request_profiles );
+
+    fprintf( stderr, "wineserver: request profile over %u ms, %u.%03u ms in handlers\n",
+             (unsigned int)((get_profile_time() - profile_start) / 1000000),
+             (unsigned int)(total / 1000000), (unsigned int)(total / 1000 % 1000) );
+    fprintf( stderr, "%-32s %10s %12s %8s %8s %12s  histogram (1us, 2us, 4us, ...)\n",
+             "request", "count", "total (us)", "avg (us)", "max (us)", "reply bytes" );
+    for (i = 0; i < count; i++)
+    {
+        const struct request_profile *profile = &request_profiles[order[i]];
+
+        fprintf( stderr, "%-32s %10u %12u %8u %8u %12u ", get_request_name( order[i] ),
+                 profile->count, (unsigned int)(profile->total_time / 1000),
+                 (unsigned int)(profile->total_time / profile->count / 1000),
+                 (unsigned int)(profile->max_time / 1000), (unsigned int)profile->reply_bytes );
+        for (j = 0; j < PROFILE_BUCKETS; j++) fprintf( stderr, " %u", profile->histogram[j] );
+        fputc( '\n', stderr );
+    }
+    enum_processes( dump_process_profile, NULL );
+    memset( request_profiles, 0, sizeof(request_profiles) );
+}
+
+/* start profiling requests, or stop and dump the results if already running */
+void toggle_request_profile(void)
+{
+    if (profile_requests)
+    {
+        dump_request_profile();
+        profile_requests = 0;
+    }
+    else
+    {
+        fprintf( stderr, "wineserver: request profiling enabled\n" );
+        profile_start = get_profile_time();
+        profile_requests = 1;
+    }
+}
+
 /* call a request handler */
 static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    struct process *process = thread->process;
+    timeout_t start = 0;
 
     current = thread;
     current->reply_size = 0;
@@ -305,11 +446,17 @@ static void call_req_handler( struct thread *thread )
 
     if (debug_level) trace_request();
 
+    if (profile_requests) start = get_profile_time();
+
     if (req < REQ_NB_REQUESTS)
         req_handlers[req]( &current->req, &reply );
     else
         set_error( STATUS_NOT_IMPLEMENTED );
 
+    if (profile_requests && req < REQ_NB_REQUESTS)
+        profile_request( req, current ? process : NULL, get_profile_time() - start,
+                         current ? current->reply_size : 0 );
+
     if (current)
     {
         if (current->reply_fd)
@@ -62,8 +62,10 @@ extern int wait_for_lock(void);
 extern int kill_lock_owner( int sig );
 extern int server_dir_fd, config_dir_fd;
 
+extern void toggle_request_profile(void);
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
+extern const char *get_request_name( enum request req );
 
 /* get the request vararg data */
 static inline const void *get_req_data(void)
@@ -310,6 +312,7 @@ DECL_HANDLER(open_input_desktop);
 DECL_HANDLER(close_desktop);
 DECL_HANDLER(get_thread_desktop);
 DECL_HANDLER(set_thread_desktop);
+DECL_HANDLER(get_desktop_shared_memory);
 DECL_HANDLER(enum_desktop);
 DECL_HANDLER(set_user_object_info);
 DECL_HANDLER(register_hotkey);
@@ -607,6 +610,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_close_desktop,
     (req_handler)req_get_thread_desktop,
     (req_handler)req_set_thread_desktop,
+    (req_handler)req_get_desktop_shared_memory,
     (req_handler)req_enum_desktop,
     (req_handler)req_set_user_object_info,
     (req_handler)req_register_hotkey,
@@ -1888,6 +1892,9 @@ C_ASSERT( FIELD_OFFSET(struct get_thread_desktop_reply, handle) == 8 );
 C_ASSERT( sizeof(struct get_thread_desktop_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_thread_desktop_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_thread_desktop_request) == 16 );
+C_ASSERT( sizeof(struct get_desktop_shared_memory_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_desktop_shared_memory_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_desktop_shared_memory_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct enum_desktop_request, winstation) == 12 );
 C_ASSERT( FIELD_OFFSET(struct enum_desktop_request, index) == 16 );
 C_ASSERT( sizeof(struct enum_desktop_request) == 24 );
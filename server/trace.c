@@ -3492,6 +3492,15 @@ static void dump_set_thread_desktop_request( const struct set_thread_desktop_req
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_desktop_shared_memory_request( const struct get_desktop_shared_memory_request *req )
+{
+}
+
+static void dump_get_desktop_shared_memory_reply( const struct get_desktop_shared_memory_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_enum_desktop_request( const struct enum_desktop_request *req )
 {
     fprintf( stderr, " winstation=%04x", req->winstation );
@@ -4740,6 +4749,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_close_desktop_request,
     (dump_func)dump_get_thread_desktop_request,
     (dump_func)dump_set_thread_desktop_request,
+    (dump_func)dump_get_desktop_shared_memory_request,
     (dump_func)dump_enum_desktop_request,
     (dump_func)dump_set_user_object_info_request,
     (dump_func)dump_register_hotkey_request,
@@ -5034,6 +5044,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_get_thread_desktop_reply,
     NULL,
+    (dump_func)dump_get_desktop_shared_memory_reply,
     (dump_func)dump_enum_desktop_reply,
     (dump_func)dump_set_user_object_info_reply,
     (dump_func)dump_register_hotkey_reply,
@@ -5328,6 +5339,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "close_desktop",
     "get_thread_desktop",
     "set_thread_desktop",
+    "get_desktop_shared_memory",
     "enum_desktop",
     "set_user_object_info",
     "register_hotkey",
@@ -5648,3 +5660,8 @@ void trace_reply( enum request req, const union generic_reply *reply )
     else fprintf( stderr, "%04x: %d() = %s\n",
                   current->id, req, get_status_name(current->error) );
 }
+
+const char *get_request_name( enum request req )
+{
+    return req < REQ_NB_REQUESTS ? req_names[req] : "?";
+}
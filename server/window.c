@@ -74,6 +74,8 @@ struct window
     rectangle_t      client_rect;     /* client rectangle (relative to parent client area) */
     struct region   *win_region;      /* region for shaped windows (relative to window rect) */
     struct region   *update_region;   /* update region (relative to window rect) */
+    struct region   *vis_cache;       /* cached visible region (relative to window) */
+    unsigned int     vis_cache_flags; /* DCX flags the cached region was computed with */
     unsigned int     style;           /* window style */
     unsigned int     ex_style;        /* window extended style */
     unsigned int     id;              /* window id */
@@ -81,6 +83,7 @@ struct window
     unsigned int     is_unicode : 1;  /* ANSI or unicode */
     unsigned int     is_linked : 1;   /* is it linked into the parent z-order list? */
     unsigned int     is_layered : 1;  /* has layered info been set? */
+    unsigned int     vis_cache_valid : 1; /* is the cached visible region up to date? */
     unsigned int     color_key;       /* color key for a layered window */
     unsigned int     alpha;           /* alpha value for a layered window */
     unsigned int     layered_flags;   /* flags for a layered window */
@@ -187,6 +190,46 @@ static unsigned int get_monitor_dpi( struct window *win )
     return win->dpi ? win->dpi : USER_DEFAULT_SCREEN_DPI;
 }
 
+/* check if a window can clip out part of a rectangle, both relative to the parent client area */
+static inline int window_overlaps_rect( const struct window *win, const rectangle_t *rect )
+{
+    rectangle_t tmp;
+
+    return intersect_rect( &tmp, &win->window_rect, rect ) || intersect_rect( &tmp, &win->visible_rect, rect );
+}
+
+/* flush the cached visible regions of a window and of all its children */
+static void invalidate_visible_region_tree( struct window *win )
+{
+    struct window *child;
+
+    win->vis_cache_valid = 0;
+    LIST_FOR_EACH_ENTRY( child, &win->children, struct window, entry )
+        invalidate_visible_region_tree( child );
+}
+
+/* flush the cached visible regions that can depend on the position, z-order, style or region
+ * of a window: its own and its children's, its ancestors', and those of the siblings overlapping
+ * either its current rectangles or old_rect, along with their children */
+static void invalidate_visible_regions( struct window *win, const rectangle_t *old_rect )
+{
+    struct window *ptr;
+
+    invalidate_visible_region_tree( win );
+    for (ptr = win->parent; ptr; ptr = ptr->parent) ptr->vis_cache_valid = 0;
+
+    /* top-level siblings don't clip each other, and unlinked windows don't clip anything */
+    if (!win->parent || is_desktop_window( win->parent ) || !win->is_linked) return;
+
+    LIST_FOR_EACH_ENTRY( ptr, &win->parent->children, struct window, entry )
+    {
+        if (ptr == win) continue;
+        if (window_overlaps_rect( ptr, &win->window_rect ) || window_overlaps_rect( ptr, &win->visible_rect ) ||
+            (old_rect && window_overlaps_rect( ptr, old_rect )))
+            invalidate_visible_region_tree( ptr );
+    }
+}
+
 /* link a window at the right place in the siblings list */
 static void link_window( struct window *win, struct window *previous )
 {
@@ -240,6 +283,7 @@ static void link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    invalidate_visible_regions( win, NULL );
 }
 
 /* change the parent of a window (or unlink the window if the new parent is NULL) */
@@ -257,6 +301,9 @@ static int set_parent_window( struct window *win, struct window *parent )
         }
     }
 
+    /* flush the regions depending on the window at its old place in the tree */
+    invalidate_visible_regions( win, NULL );
+
     if (parent)
     {
         win->parent = parent;
@@ -494,6 +541,8 @@ static struct window *create_window( struct window *parent, struct window *owner
     win->atom           = atom;
     win->last_active    = win->handle;
     win->win_region     = NULL;
+    win->vis_cache      = NULL;
+    win->vis_cache_valid = 0;
     win->update_region  = NULL;
     win->style          = 0;
     win->ex_style       = 0;
@@ -1016,7 +1065,7 @@ static inline struct window *get_top_clipping_window( struct window *win )
 
 
 /* compute the visible region of a window, in window coordinates */
-static struct region *get_visible_region( struct window *win, unsigned int flags )
+static struct region *compute_visible_region( struct window *win, unsigned int flags )
 {
     struct region *tmp = NULL, *region;
     int offset_x, offset_y;
@@ -1095,6 +1144,42 @@ error:
 }
 
 
+/* get the visible region of a window, in window coordinates; the caller must free it */
+static struct region *get_visible_region( struct window *win, unsigned int flags )
+{
+    struct region *region, *cache;
+
+    flags &= DCX_WINDOW | DCX_PARENTCLIP | DCX_CLIPCHILDREN;
+
+    if (win->vis_cache && win->vis_cache_valid && win->vis_cache_flags == flags)
+    {
+        if (!(region = create_empty_region())) return NULL;
+        if (copy_region( region, win->vis_cache )) return region;
+        free_region( region );
+        return NULL;
+    }
+
+    if (!(region = compute_visible_region( win, flags ))) return NULL;
+
+    if ((cache = win->vis_cache) || (cache = create_empty_region()))
+    {
+        if (copy_region( cache, region ))
+        {
+            win->vis_cache = cache;
+            win->vis_cache_flags = flags;
+            win->vis_cache_valid = 1;
+        }
+        else
+        {
+            free_region( cache );
+            win->vis_cache = NULL;
+            clear_error();
+        }
+    }
+    return region;
+}
+
+
 /* clip all children with a custom pixel format out of the visible region */
 static struct region *clip_pixel_format_children( struct window *parent, struct region *parent_clip,
                                                   struct region *region, int offset_x, int offset_y )
@@ -1700,6 +1785,11 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (!(swp_flags & SWP_NOZORDER) && win->parent) link_window( win, previous );
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    rect.left   = min( old_window_rect.left, old_visible_rect.left );
+    rect.top    = min( old_window_rect.top, old_visible_rect.top );
+    rect.right  = max( old_window_rect.right, old_visible_rect.right );
+    rect.bottom = max( old_window_rect.bottom, old_visible_rect.bottom );
+    invalidate_visible_regions( win, &rect );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -1855,6 +1945,7 @@ static void set_window_region( struct window *win, struct region *region, int re
 
     if (win->win_region) free_region( win->win_region );
     win->win_region = region;
+    invalidate_visible_regions( win, NULL );
 
     /* expose anything revealed by the change */
     if (old_vis_rgn && ((exposed_rgn = expose_window( win, &win->window_rect, old_vis_rgn ))))
@@ -1876,6 +1967,7 @@ void destroy_window( struct window *win )
     {
         struct region *vis_rgn = get_visible_region( win, DCX_WINDOW );
         win->style &= ~WS_VISIBLE;
+        invalidate_visible_regions( win, NULL );
         if (vis_rgn)
         {
             struct region *exposed_rgn = expose_window( win, &win->window_rect, vis_rgn );
@@ -1901,6 +1993,7 @@ void destroy_window( struct window *win )
     cleanup_clipboard_window( win->desktop, win->handle );
     free_user_handle( win->handle );
     destroy_properties( win );
+    invalidate_visible_regions( win, NULL );
     list_remove( &win->entry );
     if (is_desktop_window(win))
     {
@@ -1917,6 +2010,7 @@ void destroy_window( struct window *win )
     detach_window_thread( win );
     if (win->win_region) free_region( win->win_region );
     if (win->update_region) free_region( win->update_region );
+    if (win->vis_cache) free_region( win->vis_cache );
     if (win->class) release_class( win->class );
     free( win->text );
     memset( win, 0x55, sizeof(*win) + win->nb_extra_bytes - 1 );
@@ -2129,6 +2223,7 @@ DECL_HANDLER(set_window_info)
     reply->old_id        = win->id;
     reply->old_instance  = win->instance;
     reply->old_user_data = win->user_data;
+    if (req->flags & (SET_WIN_STYLE | SET_WIN_EXSTYLE)) invalidate_visible_regions( win, NULL );
     if (req->flags & SET_WIN_STYLE) win->style = req->style;
     if (req->flags & SET_WIN_EXSTYLE)
     {
@@ -2673,6 +2768,7 @@ DECL_HANDLER(update_window_zorder)
         {
             list_remove( &win->entry );
             list_add_before( &ptr->entry, &win->entry );
+            invalidate_visible_regions( win, NULL );
         }
         break;
     }
@@ -23,6 +23,9 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -180,7 +183,7 @@ static void winstation_destroy( struct object *obj )
     list_remove( &winstation->entry );
     if (winstation->clipboard) release_object( winstation->clipboard );
     if (winstation->atom_table) release_object( winstation->atom_table );
-    free( winstation->desktop_names );
+    free_namespace( winstation->desktop_names );
 }
 
 static unsigned int winstation_map_access( struct object *obj, unsigned int access )
@@ -230,6 +233,15 @@ static struct desktop *create_desktop( const struct unicode_str *name, unsigned
             memset( desktop->keystate, 0, sizeof(desktop->keystate) );
             list_add_tail( &winstation->desktops, &desktop->entry );
             list_init( &desktop->hotkeys );
+            /* the shared state is only an optimization, clients fall back to server calls without it */
+            if ((desktop->shared_mapping = create_shared_mapping( sizeof(*desktop->shared),
+                                                                  (void **)&desktop->shared )))
+                memset( (void *)desktop->shared, 0, sizeof(*desktop->shared) );
+            else
+            {
+                desktop->shared = NULL;
+                clear_error();
+            }
         }
         else clear_error();
     }
@@ -290,6 +302,8 @@ static void desktop_destroy( struct object *obj )
     if (desktop->global_hooks) release_object( desktop->global_hooks );
     if (desktop->close_timeout) remove_timeout_user( desktop->close_timeout );
     list_remove( &desktop->entry );
+    if (desktop->shared) munmap( (void *)desktop->shared, sizeof(*desktop->shared) );
+    if (desktop->shared_mapping) release_object( desktop->shared_mapping );
     release_object( desktop->winstation );
 }
 
@@ -633,6 +647,21 @@ DECL_HANDLER(set_thread_desktop)
 }
 
 
+/* get a handle to the shared memory of the thread current desktop */
+DECL_HANDLER(get_desktop_shared_memory)
+{
+    struct desktop *desktop;
+
+    if (!(desktop = get_thread_desktop( current, 0 ))) return;
+    if (desktop->shared_mapping)
+        reply->handle = alloc_handle( current->process, desktop->shared_mapping,
+                                      SECTION_MAP_READ | SECTION_QUERY, 0 );
+    else
+        set_error( STATUS_NOT_SUPPORTED );
+    release_object( desktop );
+}
+
+
 /* get/set information about a user object (window station or desktop) */
 DECL_HANDLER(set_user_object_info)
 {